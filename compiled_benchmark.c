@@ -0,0 +1,104 @@
+#include "exact_compile.h"
+#include "compiled_pattern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks a matcher generated by exact_compile against exactmatch_stream_block, then times both on one text.
+    Build with make compiled-benchmark, which first writes compiled_pattern.h.
+    Usage: compiled_benchmark [length]
+*/
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+    Builds a text over the symbols of the pattern and one symbol outside it, with copies of the pattern and of a prefix of it.
+*/
+symbol *make_text(int n, symbol *sigma, int s_sigma) {
+    symbol *T = malloc(n * sizeof(symbol)), other = 0;
+    int i, k, m = COMPILED_PATTERN_M;
+    for (k = 0; k < s_sigma; k++) if (sigma[k] == other) other++, k = -1;
+    for (i = 0; i < n; i++) T[i] = (rand() % 50) ? sigma[rand() % s_sigma] : other;
+    for (i = rand() % 100; i + m < n; i += m + rand() % (4 * m)) {
+        memcpy(&T[i], compiled_pattern_pattern, m * sizeof(symbol));
+        if (rand() % 3 == 0) i += m / 2;
+        else if (rand() % 2) T[i + rand() % m] = other;
+    }
+    return T;
+}
+
+void compiled_test(int n) {
+    symbol sigma[COMPILED_PATTERN_M], *T;
+    int s_sigma = compile_classes((symbol*)compiled_pattern_pattern, COMPILED_PATTERN_M, sigma) - 1, i, l, location;
+    int *expected = malloc(n * sizeof(int)), *results = malloc(n * sizeof(int));
+    T = make_text(n, sigma, s_sigma);
+    exactmatch_state generic = exactmatch_build((symbol*)compiled_pattern_pattern, COMPILED_PATTERN_M, sigma, s_sigma, n, 0);
+    match_sink generic_sink = matchsink_array(expected), sink = matchsink_array(results);
+    assert(exactmatch_stream_block(&generic, T, n, &generic_sink) == n);
+    for (i = COMPILED_PATTERN_M - 1, location = 0; i < n; i++) if (memcmp(&T[i - COMPILED_PATTERN_M + 1], compiled_pattern_pattern, COMPILED_PATTERN_M * sizeof(symbol)) == 0) assert(expected[location++] == i);
+    assert(location == generic_sink.count);
+
+    compiled_pattern_state state;
+    compiled_pattern_init(&state);
+    for (i = 0; i < n; i += l) {
+        l = (rand() % 4) ? rand() % 300 : rand() % 10;
+        if (i + l > n) l = n - i;
+        assert(compiled_pattern_stream_block(&state, &T[i], l, &sink) == l);
+    }
+    assert(sink.count == generic_sink.count);
+    for (i = 0; i < sink.count; i++) assert(results[i] == expected[i]);
+
+    if (sink.count > 2) {
+        match_sink ring = matchsink_ring(2, NULL, NULL);
+        int consumed = 0, popped = 0;
+        compiled_pattern_init(&state);
+        while (consumed < n) {
+            consumed += compiled_pattern_stream_block(&state, &T[consumed], n - consumed, &ring);
+            while (ringsink_pop(&ring, &location)) assert(location == expected[popped++]);
+        }
+        assert(popped == sink.count);
+        matchsink_free(&ring);
+    }
+    exactmatch_free(&generic);
+    free(T);
+    free(expected);
+    free(results);
+}
+
+void compiled_benchmark(int n) {
+    symbol sigma[COMPILED_PATTERN_M], *T;
+    int s_sigma = compile_classes((symbol*)compiled_pattern_pattern, COMPILED_PATTERN_M, sigma) - 1, *results = malloc(n * sizeof(int));
+    T = make_text(n, sigma, s_sigma);
+    exactmatch_state generic = exactmatch_build((symbol*)compiled_pattern_pattern, COMPILED_PATTERN_M, sigma, s_sigma, n, 0);
+    compiled_pattern_state state;
+    match_sink generic_sink = matchsink_array(results), sink = matchsink_array(results);
+
+    double start = now();
+    exactmatch_stream_block(&generic, T, n, &generic_sink);
+    double generic_time = now() - start;
+    compiled_pattern_init(&state);
+    start = now();
+    compiled_pattern_stream_block(&state, T, n, &sink);
+    double compiled_time = now() - start;
+    assert(sink.count == generic_sink.count);
+
+    printf("m = %d, %d symbols, %d matches: exactmatch_stream_block %.1f ns/symbol, compiled %.1f ns/symbol (%.1fx)\n", COMPILED_PATTERN_M, n, sink.count, generic_time * 1e9 / n, compiled_time * 1e9 / n, generic_time / compiled_time);
+    exactmatch_free(&generic);
+    free(T);
+    free(results);
+}
+
+int main(int argc, char **argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1 << 24;
+    srand(7);
+    compiled_test(20000);
+    compiled_test(200000);
+    compiled_benchmark(n);
+    return 0;
+}
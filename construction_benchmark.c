@@ -0,0 +1,46 @@
+#include "exact_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+    Measures the latency of constructing short-lived fingerprinters and matchers.
+    Usage: construction_benchmark [repetitions]
+*/
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void fingerprinter_benchmark(unsigned int n, unsigned int alpha, int repetitions) {
+    int i;
+    double start = now();
+    for (i = 0; i < repetitions; i++) fingerprinter_free(fingerprinter_build(n, alpha));
+    printf("fingerprinter_build n=%u alpha=%u: %.2f us\n", n, alpha, (now() - start) * 1e6 / repetitions);
+}
+
+void exactmatch_benchmark(int m, unsigned int n, unsigned int alpha, int repetitions) {
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, *P = malloc(m * sizeof(symbol));
+    int i;
+    for (i = 0; i < m; i++) P[i] = sigma[rand() % 4];
+    double start = now();
+    for (i = 0; i < repetitions; i++) {
+        exactmatch_state state = exactmatch_build(P, m, sigma, 4, n, alpha);
+        exactmatch_free(&state);
+    }
+    printf("exactmatch_build m=%d n=%u alpha=%u: %.2f us\n", m, n, alpha, (now() - start) * 1e6 / repetitions);
+    free(P);
+}
+
+int main(int argc, char **argv) {
+    int repetitions = (argc > 1) ? atoi(argv[1]) : 1000;
+    srand(1);
+    fingerprinter_benchmark(1000, 0, repetitions);
+    fingerprinter_benchmark(1 << 20, 1, repetitions);
+    fingerprinter_benchmark(1U << 31, 2, repetitions);
+    exactmatch_benchmark(64, 1 << 20, 1, repetitions);
+    exactmatch_benchmark(1024, 1U << 31, 2, repetitions);
+    return 0;
+}
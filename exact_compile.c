@@ -0,0 +1,59 @@
+#include "exact_compile.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Compiles a pattern into <name>.h in the current directory, for compiled_benchmark.c or any program with a fixed pattern.
+    The pattern is read raw from a file, sizeof(symbol) bytes per symbol, or drawn at random over 'a' to 'd'.
+    Usage: exact_compile name (pattern file | --random m) [n] [alpha]
+*/
+
+symbol *read_pattern(char *path, int *m) {
+    FILE *in = fopen(path, "rb");
+    symbol *P;
+    long size;
+    if (!in) return NULL;
+    fseek(in, 0, SEEK_END);
+    size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    *m = size / sizeof(symbol);
+    P = malloc((*m + 1) * sizeof(symbol));
+    if (fread(P, sizeof(symbol), *m, in) != (size_t)*m) *m = 0;
+    fclose(in);
+    return P;
+}
+
+int main(int argc, char **argv) {
+    int m = 0, i, next = 3, n, alpha;
+    symbol *P = NULL;
+    char path[4096];
+    FILE *out;
+    if (argc < 3) {
+        printf("Usage: exact_compile name (pattern file | --random m) [n] [alpha]\n");
+        return 1;
+    }
+    if ((strcmp(argv[2], "--random") == 0) && (argc > 3)) {
+        m = atoi(argv[3]);
+        P = malloc(m * sizeof(symbol));
+        srand(m);
+        for (i = 0; i < m; i++) P[i] = 'a' + rand() % 4;
+        next = 4;
+    } else P = read_pattern(argv[2], &m);
+    n = (argc > next) ? atoi(argv[next]) : 1 << 30;
+    alpha = (argc > next + 1) ? atoi(argv[next + 1]) : 0;
+    if ((!P) || (m < 3)) {
+        printf("Error: the pattern needs at least 3 symbols\n");
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s.h", argv[1]);
+    out = fopen(path, "w");
+    if ((!out) || (!exact_compile(out, argv[1], P, m, n, alpha))) {
+        printf("Error: could not compile the pattern to %s\n", path);
+        return 1;
+    }
+    fclose(out);
+    printf("%s: %d symbols\n", path, m);
+    free(P);
+    return 0;
+}
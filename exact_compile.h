@@ -0,0 +1,313 @@
+/*
+    exact_compile.h
+    Compiles a fixed pattern into C source for a matcher specialised to it, for patterns that are known when the program is
+    built, such as signatures and protocol markers.
+    The generator builds an exactmatch_state for the pattern offline and writes out its shape: the length of the KMP
+    prefix, the size and fingerprint of every row and the length of the KMP suffix become constants, both KMP stages
+    become dense automata over the symbols of the pattern, and the round-robin over the rows is unrolled so that each row
+    is checked by straight-line code with its constants in place. Fingerprints are single words modulo the Mersenne prime
+    2^61 - 1, so the generated file needs neither GMP nor cmph.
+    The output is a header in the style of this library, to be included into one translation unit, with the same
+    block-feed signature as exactmatch_stream_block.
+*/
+
+#ifndef EXACT_COMPILE
+#define EXACT_COMPILE
+
+#include "exact_matching.h"
+#include <stdint.h>
+#include <ctype.h>
+
+#define COMPILE_PRIME ((1ULL << 61) - 1)
+#define COMPILE_PRIME_BITS 61
+#define COMPILE_MAX_TABLE (1 << 24)
+
+/*
+    compile_mul
+    Multiplies modulo 2^61 - 1.
+    Parameters:
+        uint64_t a - First factor, below 2^61 - 1
+        uint64_t b - Second factor, below 2^61 - 1
+    Returns uint64_t:
+        ab mod 2^61 - 1
+*/
+uint64_t compile_mul(uint64_t a, uint64_t b) {
+    unsigned __int128 t = (unsigned __int128)a * b;
+    uint64_t s = ((uint64_t)t & COMPILE_PRIME) + (uint64_t)(t >> COMPILE_PRIME_BITS);
+    return (s >= COMPILE_PRIME) ? s - COMPILE_PRIME : s;
+}
+
+/*
+    compile_value
+    The value a symbol is fingerprinted as.
+    Parameters:
+        symbol c - The symbol
+    Returns uint64_t:
+        symbol_value(c), as set_fingerprint reads it. Below 2^32, so already reduced modulo 2^61 - 1
+*/
+uint64_t compile_value(symbol c) {
+    return symbol_value(c);
+}
+
+/*
+    compile_classes
+    Numbers the distinct symbols of a pattern. Every other symbol falls in class 0, as it can never extend a match.
+    Parameters:
+        symbol *P       - The pattern
+        int    m        - Length of the pattern
+        symbol *members - At least m entries, set to the symbol of each class from 1 on
+    Returns int:
+        The number of classes, including class 0
+*/
+int compile_classes(symbol *P, int m, symbol *members) {
+    int i, k, classes = 1;
+    for (i = 0; i < m; i++) {
+        for (k = 1; (k < classes) && (members[k - 1] != P[i]); k++);
+        if (k == classes) members[classes++ - 1] = P[i];
+    }
+    return classes;
+}
+
+/*
+    compile_automaton
+    Builds the dense KMP automaton of a string over classes of symbols.
+    Parameters:
+        symbol *Q       - The string
+        int    M        - Length of the string
+        symbol *members - The symbol of each class from 1 on
+        int    classes  - The number of classes
+    Returns int*:
+        (M + 1) * classes entries, the number of symbols of Q matched after reading a symbol of class k in state s at
+        [s * classes + k]. State M is a match, and moves on as if from the longest border of Q.
+*/
+int *compile_automaton(symbol *Q, int M, symbol *members, int classes) {
+    int *delta = malloc((M + 1) * classes * sizeof(int)), *failure = malloc((M + 1) * sizeof(int)), s, k, b = 0;
+    failure[0] = 0;
+    if (M > 0) failure[1] = 0;
+    for (s = 1; s < M; s++) {
+        while ((b > 0) && (Q[s] != Q[b])) b = failure[b];
+        if (Q[s] == Q[b]) b++;
+        failure[s + 1] = b;
+    }
+    for (s = 0; s <= M; s++) {
+        delta[s * classes] = 0;
+        for (k = 1; k < classes; k++) {
+            if ((s < M) && (Q[s] == members[k - 1])) delta[s * classes + k] = s + 1;
+            else delta[s * classes + k] = (s == 0) ? 0 : delta[failure[s] * classes + k];
+        }
+    }
+    free(failure);
+    return delta;
+}
+
+/*
+    compile_table
+    Writes an array of integers as a constant.
+    Parameters:
+        FILE *out    - Destination
+        char *name   - Name of the matcher
+        char *suffix - Name of the table
+        int  *values - The values
+        int  l       - Number of values
+        int  max     - Largest value, which picks the element type
+*/
+void compile_table(FILE *out, char *name, char *suffix, int *values, int l, int max) {
+    int i;
+    fprintf(out, "const %s %s_%s[%d] = {", (max < 256) ? "uint8_t" : (max < 65536) ? "uint16_t" : "int32_t", name, suffix, l);
+    for (i = 0; i < l; i++) fprintf(out, "%s%d", (i == 0) ? "\n    " : (i % 24) ? ", " : ",\n    ", values[i]);
+    fprintf(out, "\n};\n\n");
+}
+
+/*
+    compile_row
+    Writes the straight-line step for one row: the fingerprint stage, then the automata and the check of exactmatch_step.
+    Parameters:
+        FILE     *out     - Destination
+        char     *name    - Name of the matcher
+        int      j        - The row, or -1 if the fingerprint stage is only the KMP prefix
+        int      rows     - Number of rows
+        int      size     - Size of row j
+        uint64_t finger   - Fingerprint of row j of the pattern
+        uint64_t r_k      - r^size
+        char     *upper   - Name of the matcher in upper case
+*/
+void compile_row(FILE *out, char *name, int j, int rows, int size, uint64_t finger, uint64_t r_k, char *upper) {
+    fprintf(out, "        case %d:\n", (j < 0) ? 0 : j);
+    fprintf(out, "            if (t == l) {\n                state->row = %d;\n                return l;\n            }\n", (j < 0) ? 0 : j);
+    fprintf(out, "            c = T[t++];\n            k = %s_class(c);\n            found = -1;\n", name);
+    if (j >= 0) {
+        fprintf(out, "            %s_extend(&state->past[%d], c, &state->past[%d]);\n", name, (j) ? j - 1 : rows - 1, j);
+        fprintf(out, "            if ((state->rows[%d].count > 0) && (i - state->rows[%d].location[0] >= %d)) {\n", j, j, size);
+        fprintf(out, "                location = state->rows[%d].location[0] + %d;\n", j, size);
+        fprintf(out, "                cur = &state->past[location %% %s_ROWS];\n", upper);
+        fprintf(out, "                %s_suffix(cur, &state->rows[%d].vo[0], &T_f);\n", name, j);
+        fprintf(out, "                if ((T_f.finger == %lluULL) && (T_f.r_k == %lluULL)) ", (unsigned long long)finger, (unsigned long long)r_k);
+        if (j == rows - 1) fprintf(out, "found = location;\n");
+        else fprintf(out, "%s_add(&state->rows[%d], cur, location);\n", name, j + 1);
+        fprintf(out, "                %s_shift(&state->rows[%d]);\n            }\n", name, j);
+        fprintf(out, "            state->prefix = %s_prefix[state->prefix * %s_CLASSES + k];\n", name, upper);
+        fprintf(out, "            if (state->prefix == %s_PREFIX) %s_add(&state->rows[0], &state->past[%d], i);\n", upper, name, j);
+    } else {
+        fprintf(out, "            state->prefix = %s_prefix[state->prefix * %s_CLASSES + k];\n", name, upper);
+        fprintf(out, "            if (state->prefix == %s_PREFIX) found = i;\n", upper);
+    }
+    fprintf(out, "            state->suffix = %s_suffix_automaton[state->suffix * %s_CLASSES + k];\n", name, upper);
+    fprintf(out, "            if ((state->suffix == %s_TAIL) && (i >= %s_M - 1) && ((state->buffer[i %% %s_TAIL] == i - %s_TAIL) || (found == i - %s_TAIL))) {\n", upper, upper, upper, upper, upper);
+    fprintf(out, "                if (found != -1) state->buffer[found %% %s_TAIL] = found;\n", upper);
+    fprintf(out, "                state->text_index = ++i;\n");
+    fprintf(out, "                if (matchsink_emit(sink, i - 1)) {\n                    state->row = %d;\n                    return t;\n                }\n", (j < 0) ? 0 : (j + 1) % rows);
+    fprintf(out, "            } else {\n");
+    fprintf(out, "                if (found != -1) state->buffer[found %% %s_TAIL] = found;\n", upper);
+    fprintf(out, "                state->text_index = ++i;\n            }\n");
+}
+
+/*
+    exact_compile
+    Writes a matcher specialised to one pattern.
+    Parameters:
+        FILE   *out    - Destination for the C source
+        char   *name   - Prefix of every name in the source, a C identifier
+        symbol *P      - The pattern
+        int    m       - Length of the pattern, at least 3
+        int    n       - Length of the longest text the matcher will be used on
+        int    alpha   - Desired level of accuracy
+    Returns int:
+        1 if the matcher was written
+        0 if its automata would be larger than COMPILE_MAX_TABLE entries, e.g. a long periodic pattern over many symbols
+    Notes:
+        The source defines <name>_state, <name>_init(state) and <name>_stream_block(state, T, l, sink), which behaves as
+        exactmatch_stream_block on an exactmatch_state for P. It also defines <name>_pattern and <NAME>_M.
+        The fingerprints use 2^61 - 1 rather than the prime fingerprinter_build would pick, with r drawn from the shared
+        random state. alpha is lowered, with a warning, until n^(2+alpha) fits below 2^61.
+        Characters that fail a period check are discarded silently rather than with the warning of add_occurance.
+*/
+int exact_compile(FILE *out, char *name, symbol *P, int m, int n, int alpha) {
+    symbol *members = malloc(m * sizeof(symbol));
+    int classes = compile_classes(P, m, members), i, j, k, rows, head, tail, *prefix, *suffix, size;
+    char *upper = malloc(strlen(name) + 1);
+    uint64_t r, r_inv, finger, r_k;
+    mpz_t bound, random, inverse;
+
+    while ((alpha > 0) && (bit_width(n) * (2 + alpha) > COMPILE_PRIME_BITS)) {
+        alpha--;
+        printf("Warning: n^(2+alpha) exceeds 2^%d, lowering alpha to %d\n", COMPILE_PRIME_BITS, alpha);
+    }
+    exactmatch_state state = exactmatch_build(P, m, members, classes - 1, n, alpha);
+    tail = state.lm;
+    head = state.fmatch.P_f.m;
+    rows = (state.fmatch.periodic) ? 0 : state.fmatch.lm;
+    if ((long)(head + tail + 2) * classes > COMPILE_MAX_TABLE) {
+        exactmatch_free(&state);
+        free(members);
+        free(upper);
+        return 0;
+    }
+
+    for (i = 0; name[i]; i++) upper[i] = toupper((unsigned char)name[i]);
+    upper[i] = 0;
+    mpz_init_set_ui(bound, COMPILE_PRIME - 1);
+    mpz_init(random);
+    mpz_init(inverse);
+    random_below(random, bound);
+    mpz_add_ui(random, random, 1);
+    mpz_set_ui(bound, COMPILE_PRIME);
+    mpz_invert(inverse, random, bound);
+    r = mpz_get_ui(random);
+    r_inv = mpz_get_ui(inverse);
+    mpz_clear(bound);
+    mpz_clear(random);
+    mpz_clear(inverse);
+
+    fprintf(out, "/*\n    %s.h\n    Matcher for one fixed pattern of %d symbols, generated by exact_compile. Do not edit.\n", name, m);
+    fprintf(out, "    KMP prefix of %d symbols, %d rows, KMP suffix of %d symbols, %d symbol classes.\n*/\n\n", head, rows, tail, classes);
+    fprintf(out, "#ifndef %s_MATCHER\n#define %s_MATCHER\n\n#include \"match_sink.h\"\n#include \"symbol.h\"\n#include <stdint.h>\n\n", upper, upper);
+    fprintf(out, "#if SYMBOL_WIDTH != %d\n#error \"%s.h was generated for SYMBOL_WIDTH %d\"\n#endif\n\n", SYMBOL_WIDTH, name, SYMBOL_WIDTH);
+    fprintf(out, "#define %s_M %d\n#define %s_PREFIX %d\n#define %s_ROWS %d\n#define %s_TAIL %d\n#define %s_CLASSES %d\n", upper, m, upper, head, upper, (rows) ? rows : 1, upper, tail, upper, classes);
+    fprintf(out, "#define %s_PRIME ((1ULL << 61) - 1)\n#define %s_R %lluULL\n#define %s_R_INV %lluULL\n\n", upper, upper, (unsigned long long)r, upper, (unsigned long long)r_inv);
+
+    fprintf(out, "const symbol %s_pattern[%d] = {", name, m);
+    for (i = 0; i < m; i++) fprintf(out, "%s%lld", (i == 0) ? "\n    " : (i % 24) ? ", " : ",\n    ", (long long)P[i]);
+    fprintf(out, "\n};\n\n");
+
+    prefix = compile_automaton(P, head, members, classes);
+    suffix = compile_automaton(&P[m - tail], tail, members, classes);
+    compile_table(out, name, "prefix", prefix, (head + 1) * classes, head);
+    compile_table(out, name, "suffix_automaton", suffix, (tail + 1) * classes, tail);
+    free(prefix);
+    free(suffix);
+
+#if SYMBOL_WIDTH == 8
+    int *class_of = calloc(256, sizeof(int));
+    for (k = 1; k < classes; k++) class_of[(unsigned char)members[k - 1]] = k;
+    compile_table(out, name, "classes", class_of, 256, classes);
+    free(class_of);
+    fprintf(out, "int %s_class(symbol c) {\n    return %s_classes[(unsigned char)c];\n}\n\n", name, name);
+#else
+    fprintf(out, "int %s_class(symbol c) {\n    switch (c) {\n", name);
+    for (k = 1; k < classes; k++) fprintf(out, "        case %lluU: return %d;\n", (unsigned long long)members[k - 1], k);
+    fprintf(out, "        default: return 0;\n    }\n}\n\n");
+#endif
+
+    fprintf(out, "/*\n    typedef struct %s_print\n    A fingerprint modulo 2^61 - 1.\n    Components:\n        uint64_t finger - The fingerprint itself\n", name);
+    fprintf(out, "        uint64_t r_k    - r^k, where k is the length of the string\n        uint64_t r_mk   - r^-k\n*/\n");
+    fprintf(out, "typedef struct {\n    uint64_t finger, r_k, r_mk;\n} %s_print;\n\n", name);
+    fprintf(out, "/*\n    typedef struct %s_row\n    A row of viable occurances, as pattern_row.\n*/\n", name);
+    fprintf(out, "typedef struct {\n    int period, count, location[2];\n    %s_print vo[2], period_f;\n} %s_row;\n\n", name, name);
+    fprintf(out, "/*\n    typedef struct %s_state\n    The state of the matcher, set up by %s_init and carried between blocks.\n*/\n", name, name);
+    fprintf(out, "typedef struct {\n    int text_index, row, prefix, suffix, buffer[%s_TAIL];\n    %s_print past[%s_ROWS];\n    %s_row rows[%s_ROWS];\n} %s_state;\n\n", upper, name, upper, name, upper, name);
+
+    fprintf(out, "uint64_t %s_mul(uint64_t a, uint64_t b) {\n    unsigned __int128 t = (unsigned __int128)a * b;\n", name);
+    fprintf(out, "    uint64_t s = ((uint64_t)t & %s_PRIME) + (uint64_t)(t >> 61);\n    return (s >= %s_PRIME) ? s - %s_PRIME : s;\n}\n\n", upper, upper, upper);
+    fprintf(out, "void %s_extend(%s_print *u, symbol c, %s_print *uc) {\n", name, name, name);
+    fprintf(out, "    uint64_t s = u->finger + %s_mul(u->r_k, symbol_value(c));\n", name);
+    fprintf(out, "    uc->finger = (s >= %s_PRIME) ? s - %s_PRIME : s;\n", upper, upper);
+    fprintf(out, "    uc->r_k = %s_mul(u->r_k, %s_R);\n    uc->r_mk = %s_mul(u->r_mk, %s_R_INV);\n}\n\n", name, upper, name, upper);
+    fprintf(out, "void %s_concat(%s_print *u, %s_print *v, %s_print *uv) {\n", name, name, name, name);
+    fprintf(out, "    uint64_t s = u->finger + %s_mul(v->finger, u->r_k);\n    uv->finger = (s >= %s_PRIME) ? s - %s_PRIME : s;\n", name, upper, upper);
+    fprintf(out, "    uv->r_k = %s_mul(u->r_k, v->r_k);\n    uv->r_mk = %s_mul(u->r_mk, v->r_mk);\n}\n\n", name, name);
+    fprintf(out, "void %s_suffix(%s_print *uv, %s_print *u, %s_print *v) {\n", name, name, name, name);
+    fprintf(out, "    v->finger = %s_mul((uv->finger >= u->finger) ? uv->finger - u->finger : uv->finger + %s_PRIME - u->finger, u->r_mk);\n", name, upper);
+    fprintf(out, "    v->r_k = %s_mul(uv->r_k, u->r_mk);\n    v->r_mk = %s_mul(uv->r_mk, u->r_k);\n}\n\n", name, name);
+    fprintf(out, "void %s_add(%s_row *row, %s_print *T_f, int location) {\n    %s_print gap;\n", name, name, name, name);
+    fprintf(out, "    if (row->count < 2) {\n        row->vo[row->count] = *T_f;\n        row->location[row->count++] = location;\n        return;\n    }\n");
+    fprintf(out, "    if (row->count == 2) {\n        row->period = row->location[1] - row->location[0];\n        %s_suffix(&row->vo[1], &row->vo[0], &row->period_f);\n    }\n", name);
+    fprintf(out, "    %s_suffix(T_f, &row->vo[1], &gap);\n", name);
+    fprintf(out, "    if ((location - row->location[1] == row->period) && (gap.finger == row->period_f.finger) && (gap.r_k == row->period_f.r_k)) {\n");
+    fprintf(out, "        row->vo[1] = *T_f;\n        row->location[1] = location;\n        row->count++;\n    }\n}\n\n");
+    fprintf(out, "void %s_shift(%s_row *row) {\n    if (row->count <= 2) {\n        row->vo[0] = row->vo[1];\n        row->location[0] = row->location[1];\n", name, name);
+    fprintf(out, "    } else {\n        %s_print next;\n        %s_concat(&row->vo[0], &row->period_f, &next);\n        row->vo[0] = next;\n", name, name);
+    fprintf(out, "        row->location[0] += row->period;\n    }\n    row->count--;\n}\n\n");
+
+    fprintf(out, "/*\n    %s_init\n    Sets up a matcher at the start of a text.\n    Parameters:\n        %s_state *state - The state to set\n*/\n", name, name);
+    fprintf(out, "void %s_init(%s_state *state) {\n    int j;\n    memset(state, 0, sizeof(%s_state));\n", name, name, name);
+    fprintf(out, "    for (j = 0; j < %s_TAIL; j++) state->buffer[j] = -1;\n", upper);
+    fprintf(out, "    for (j = 0; j < %s_ROWS; j++) state->past[j].r_k = state->past[j].r_mk = 1;\n}\n\n", upper);
+
+    fprintf(out, "/*\n    %s_stream_block\n    Performs exact matching on the next block of the text, as exactmatch_stream_block.\n", name);
+    fprintf(out, "    Parameters:\n        %s_state *state - The current state of the matcher\n        symbol *T - The next block of the text\n", name);
+    fprintf(out, "        int l - Length of the block\n        match_sink *sink - Destination for the location of each match\n");
+    fprintf(out, "    Returns int:\n        Number of characters of T consumed. Less than l only if the sink reported it was full.\n*/\n");
+    fprintf(out, "int %s_stream_block(%s_state *state, symbol *T, int l, match_sink *sink) {\n", name, name);
+    fprintf(out, "    int t = 0, i = state->text_index, k, found, location;\n    symbol c;\n    %s_print T_f, *cur;\n", name);
+    fprintf(out, "    (void)location;\n    (void)cur;\n    (void)T_f;\n    if (matchsink_full(sink)) return 0;\n    switch (state->row) {\n        while (1) {\n");
+    if (rows == 0) compile_row(out, name, -1, 1, 0, 0, 0, upper);
+    for (j = 0, i = head; j < rows; j++) {
+        size = state.fmatch.P_i[j].row_size;
+        finger = 0;
+        r_k = 1;
+        for (k = 0; k < size; k++) {
+            finger = (finger + compile_mul(r_k, compile_value(P[i + k]))) % COMPILE_PRIME;
+            r_k = compile_mul(r_k, r);
+        }
+        compile_row(out, name, j, rows, size, finger, r_k, upper);
+        i += size;
+    }
+    fprintf(out, "        }\n    }\n    return l;\n}\n\n#endif\n");
+
+    exactmatch_free(&state);
+    free(members);
+    free(upper);
+    return 1;
+}
+
+#endif
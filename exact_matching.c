@@ -11,60 +11,348 @@ int check_results(int* correct, int* result, int size) {
     return 1;
 }
 
-void stream_test(char *T, int n, char *P, int m, char *sigma, int s_sigma, int* correct, int num_correct) {
+void stream_check(exactmatch_state *state, symbol *T, int n, int* correct, int num_correct) {
     int i, counter = 0;
-    exactmatch_state state = exactmatch_build(P, m, sigma, s_sigma, n, 0);
     for (i = 0; i < n; i++) {
-        if ((counter < num_correct) && (i == correct[counter])) assert(exactmatch_stream(&state, T[i]) == correct[counter++]);
-        else assert(exactmatch_stream(&state, T[i]) == -1);
+        if ((counter < num_correct) && (i == correct[counter])) assert(exactmatch_stream(state, T[i]) == correct[counter++]);
+        else assert(exactmatch_stream(state, T[i]) == -1);
     }
+}
+
+void stream_test(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, int* correct, int num_correct) {
+    exactmatch_state state = exactmatch_build(P, m, sigma, s_sigma, n, 0);
+    stream_check(&state, T, n, correct, num_correct);
+    exactmatch_free(&state);
+}
+
+typedef struct {
+    symbol *P;
+    int offset, step;
+} piece_reader;
+
+int piece_read(symbol *buffer, int size, void *data) {
+    piece_reader *reader = data;
+    reader->step = reader->step % 7 + 1;
+    if (size > reader->step) size = reader->step;
+    memcpy(buffer, &reader->P[reader->offset], size * sizeof(symbol));
+    reader->offset += size;
+    return size;
+}
+
+/*
+    Builds the matcher from the pattern in pieces of varying size, from a file, and from a pipe for short patterns, and
+    checks it matches as exactmatch_build.
+*/
+void builder_test(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, int* correct, int num_correct) {
+    piece_reader reader = {P, 0, 0};
+    exactmatch_state state = exactmatch_build_stream(piece_read, &reader, m, sigma, s_sigma, n, 0);
+    assert(reader.offset == m);
+    stream_check(&state, T, n, correct, num_correct);
+    exactmatch_free(&state);
+
+    FILE *file = tmpfile();
+    fwrite(P, sizeof(symbol), m, file);
+    fflush(file);
+    lseek(fileno(file), 0, SEEK_SET);
+    state = exactmatch_build_fd(fileno(file), -1, sigma, s_sigma, n, 0);
+    fclose(file);
+    stream_check(&state, T, n, correct, num_correct);
+    exactmatch_free(&state);
+
+    int fds[2];
+    if (m * sizeof(symbol) > 4096) return;
+    assert(pipe(fds) == 0);
+    assert(write(fds[1], P, m * sizeof(symbol)) == (long)(m * sizeof(symbol)));
+    close(fds[1]);
+    state = exactmatch_build_fd(fds[0], -1, sigma, s_sigma, n, 0);
+    close(fds[0]);
+    stream_check(&state, T, n, correct, num_correct);
+    exactmatch_free(&state);
+}
+
+void sink_test(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, int alpha, int* correct, int num_correct) {
+    int i, offset = 0, location = 0, consumed = 0, false_positives;
+    int *results = malloc(n * sizeof(int));
+    match_sink array = matchsink_array(results);
+    assert(fingerprint_match_verified(T, n, P, m, sigma, s_sigma, &array, &false_positives) == num_correct);
+    assert(check_results(correct, results, num_correct) && (false_positives >= 0));
+
+    mp_limb_t tiny[2] = {3, 2};
+    fingerprinter printer = fingerprinter_load(tiny, 1);
+    array = matchsink_array(results);
+    assert(fingerprint_match_core(T, n, P, m, sigma, s_sigma, 0, 1, printer, &false_positives, &array) == num_correct);
+    assert(check_results(correct, results, num_correct));
+    fingerprinter_free(printer);
+    free(results);
+
+    match_sink varint = matchsink_varint();
+    assert(fingerprint_match_sink(T, n, P, m, sigma, s_sigma, alpha, &varint) == num_correct);
+    for (i = 0; varintsink_next(&varint, &offset, &location); i++) assert((i < num_correct) && (location == correct[i]));
+    assert(i == num_correct);
+    matchsink_free(&varint);
+
+    exactmatch_state state = exactmatch_build(P, m, sigma, s_sigma, n, alpha);
+    match_sink ring = matchsink_ring(2, NULL, NULL);
+    i = 0;
+    while (consumed < n) {
+        consumed += exactmatch_stream_block(&state, &T[consumed], n - consumed, &ring);
+        while (ringsink_pop(&ring, &location)) assert((i < num_correct) && (location == correct[i++]));
+    }
+    assert(i == num_correct);
+    matchsink_free(&ring);
+    exactmatch_free(&state);
 
+    state = exactmatch_build(P, m, sigma, s_sigma, n, alpha);
+    match_sink bitmap = matchsink_bitmap();
+    assert(exactmatch_stream_block(&state, T, n, &bitmap) == n);
+    for (i = 0; i < num_correct; i++) assert(bitmapsink_test(&bitmap, correct[i]));
+    assert(bitmap.count == num_correct);
+    matchsink_free(&bitmap);
     exactmatch_free(&state);
 }
 
+/*
+    Matches run-length encoded text with exactmatch_stream_rle and checks the matches against the expanded text.
+*/
+void run_test(symbol *P, int m, symbol *values, int *lengths, int runs) {
+    symbol sigma[3] = {'a', 'b', 'c'};
+    int i, j, n = 0, num_correct = 0, offset = 0, location = 0;
+    for (i = 0; i < runs; i++) n += lengths[i];
+    symbol *T = malloc(n * sizeof(symbol));
+    int *correct = malloc(n * sizeof(int));
+    for (i = 0, n = 0; i < runs; i++) for (j = 0; j < lengths[i]; j++) T[n++] = values[i];
+    for (i = m - 1; i < n; i++) if (memcmp(&T[i - m + 1], P, m * sizeof(symbol)) == 0) correct[num_correct++] = i;
+
+    exactmatch_state state = exactmatch_build(P, m, sigma, 3, n, 0);
+    match_sink sink = matchsink_varint();
+    assert(exactmatch_stream_rle(&state, values, lengths, runs, &sink) == n);
+    assert(state.text_index == n);
+    for (i = 0; varintsink_next(&sink, &offset, &location); i++) assert((i < num_correct) && (location == correct[i]));
+    assert(i == num_correct);
+    matchsink_free(&sink);
+    exactmatch_free(&state);
+    free(correct);
+    free(T);
+}
+
+typedef struct {
+    int *starts, *strides, *counts, size;
+} progression_list;
+
+void record_progression(int start, int stride, int count, void *data) {
+    progression_list *list = data;
+    list->starts[list->size] = start;
+    list->strides[list->size] = stride;
+    list->counts[list->size++] = count;
+}
+
+/*
+    Matches c^m against runs of c broken by other characters, and checks that each maximal run of matches arrives as one
+    progression, and as the same locations through a sink without progressions.
+*/
+void progression_test(int m) {
+    symbol sigma[3] = {'a', 'b', 'c'}, values[6] = {'a', 'b', 'a', 'c', 'a', 'a'}, *P = malloc(m * sizeof(symbol));
+    int lengths[6] = {1000000, 1, 3 * m, 1, m - 1, 50000}, i, j, n = 0, num_correct = 0, location = 0;
+    for (i = 0; i < m; i++) P[i] = 'a';
+    for (i = 0; i < 6; i++) n += lengths[i];
+    int *correct = malloc(n * sizeof(int)), *results = malloc(n * sizeof(int)), run = 0;
+    for (i = 0; i < 6; i++) {
+        for (j = 0; j < lengths[i]; j++, location++) {
+            run = (values[i] == 'a') ? run + 1 : 0;
+            if (run >= m) correct[num_correct++] = location;
+        }
+    }
+    progression_list list = {malloc(n * sizeof(int)), malloc(n * sizeof(int)), malloc(n * sizeof(int)), 0};
+
+    exactmatch_state state = exactmatch_build(P, m, sigma, 3, n, 0);
+    match_sink sink = matchsink_progression(record_progression, &list);
+    assert(exactmatch_stream_rle(&state, values, lengths, 6, &sink) == n);
+    assert(sink.count == num_correct);
+    matchsink_free(&sink);
+    assert(list.size == 3);
+    for (i = 0, j = 0; i < list.size; i++) {
+        for (location = 0; location < list.counts[i]; location++) assert(list.starts[i] + location * list.strides[i] == correct[j++]);
+    }
+    assert(j == num_correct);
+    exactmatch_free(&state);
+
+    state = exactmatch_build(P, m, sigma, 3, n, 0);
+    sink = matchsink_array(results);
+    assert(exactmatch_stream_rle(&state, values, lengths, 6, &sink) == n);
+    assert(sink.count == num_correct);
+    for (i = 0; i < num_correct; i++) assert(results[i] == correct[i]);
+    exactmatch_free(&state);
+
+    free(P);
+    free(correct);
+    free(results);
+    free(list.starts);
+    free(list.strides);
+    free(list.counts);
+}
+
+/*
+    Matches with a table folding case and whitespace, and checks the matches against a folded copy of the text.
+*/
+void fold_test(int n, int m) {
+    symbol sigma[7] = {'a', 'A', 'b', 'B', ' ', '\t', '\n'}, fold[FOLD_SIZE], *T = malloc(n * sizeof(symbol)), *P = malloc(m * sizeof(symbol));
+    symbol *T_folded = malloc(n * sizeof(symbol)), *P_folded = malloc(m * sizeof(symbol)), values[4];
+    int i, num_correct = 0, consumed, offset = 0, location = 0, lengths[4] = {100, 1, 3000, 50};
+    int *correct = malloc(n * sizeof(int)), *results = malloc(n * sizeof(int));
+    foldtable_identity(fold);
+    foldtable_case(fold);
+    foldtable_class(fold, " \t\n", ' ');
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 7];
+    memcpy(P, &T[n / 2], m * sizeof(symbol));
+    for (i = rand() % 100; i + m < n; i += m + rand() % (4 * m)) {
+        memcpy(&T[i], P, m * sizeof(symbol));
+        T[i + rand() % m] ^= 'a' ^ 'A';
+    }
+    for (i = 0; i < n; i++) T_folded[i] = fold_symbol(fold, T[i]);
+    for (i = 0; i < m; i++) P_folded[i] = fold_symbol(fold, P[i]);
+    for (i = m - 1; i < n; i++) if (memcmp(&T_folded[i - m + 1], P_folded, m * sizeof(symbol)) == 0) correct[num_correct++] = i;
+    assert(num_correct > 1);
+
+    exactmatch_state state = exactmatch_build_fold(P, m, sigma, 7, n, 0, fold);
+    stream_check(&state, T, n, correct, num_correct);
+    exactmatch_free(&state);
+
+    state = exactmatch_build_fold(P, m, sigma, 7, n, 0, fold);
+    match_sink sink = matchsink_array(results);
+    for (consumed = 0; consumed < n; consumed += exactmatch_stream_block(&state, &T[consumed], (n - consumed < 77) ? n - consumed : 77, &sink));
+    test_check(correct, num_correct, results, sink.count);
+    exactmatch_free(&state);
+
+    for (i = 0; i < m; i++) P[i] = 'A';
+    values[0] = 'B';
+    values[1] = 'a';
+    values[2] = 'A';
+    values[3] = ' ';
+    state = exactmatch_build_fold(P, m, sigma, 7, n, 0, fold);
+    sink = matchsink_varint();
+    assert(exactmatch_stream_rle(&state, values, lengths, 4, &sink) == 3151);
+    for (i = 0; varintsink_next(&sink, &offset, &location); i++) assert(location == 100 + m - 1 + i);
+    assert(i == 3001 - m + 1);
+    matchsink_free(&sink);
+    exactmatch_free(&state);
+    free(T);
+    free(P);
+    free(T_folded);
+    free(P_folded);
+    free(correct);
+    free(results);
+}
+
+/*
+    value_test
+    Matches over symbols base .. base + s_sigma - 1, which may lie above p, and checks matching against a naive scan.
+    At most 8 symbols.
+*/
+void value_test(uint32_t base, int s_sigma, int n, int m) {
+    symbol sigma[8], *T = malloc(n * sizeof(symbol)), *P = malloc(m * sizeof(symbol));
+    int i, num_correct = 0, *correct = malloc(n * sizeof(int));
+    for (i = 0; i < s_sigma; i++) sigma[i] = (symbol)(base + i);
+    for (i = 0; i < m; i++) P[i] = sigma[rand() % 3];
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 3];
+    for (i = rand() % m; i + m < n; i += m / 2 + rand() % (3 * m)) memcpy(&T[i], P, m * sizeof(symbol));
+    for (i = m - 1; i < n; i++) if (memcmp(&T[i - m + 1], P, m * sizeof(symbol)) == 0) correct[num_correct++] = i;
+    sink_test(T, n, P, m, sigma, s_sigma, 0, correct, num_correct);
+    free(T);
+    free(P);
+    free(correct);
+}
+
+/*
+    short_test
+    Builds short patterns whole, in pieces and from a file, where the KMP head covers all or most of the pattern.
+*/
+void short_test(int m, int n) {
+    symbol sigma[2] = {'a', 'b'}, *T = malloc(n * sizeof(symbol)), *P = malloc(m * sizeof(symbol));
+    int i, num_correct = 0, *correct = malloc(n * sizeof(int));
+    for (i = 0; i < m; i++) P[i] = sigma[rand() % 2];
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 2];
+    for (i = m - 1; i < n; i++) if (memcmp(&T[i - m + 1], P, m * sizeof(symbol)) == 0) correct[num_correct++] = i;
+    stream_test(T, n, P, m, sigma, 2, correct, num_correct);
+    builder_test(T, n, P, m, sigma, 2, correct, num_correct);
+    free(T);
+    free(P);
+    free(correct);
+}
+
+symbol *to_symbols(char *s, int l) {
+    symbol *result = malloc(l * sizeof(symbol));
+    int i;
+    for (i = 0; i < l; i++) result[i] = s[i];
+    return result;
+}
+
+void match_test(char *T_c, int n, char *P_c, int m, char *sigma_c, int s_sigma, int alpha, int *correct, int correct_len) {
+    symbol *T = to_symbols(T_c, n), *P = to_symbols(P_c, m), *sigma = to_symbols(sigma_c, s_sigma);
+    int *results = malloc(n * sizeof(int));
+    int results_len = fingerprint_match(T, n, P, m, sigma, s_sigma, alpha, results);
+    test_check(correct, correct_len, results, results_len);
+    stream_test(T, n, P, m, sigma, s_sigma, correct, correct_len);
+    builder_test(T, n, P, m, sigma, s_sigma, correct, correct_len);
+    sink_test(T, n, P, m, sigma, s_sigma, alpha, correct, correct_len);
+    free(results);
+    free(T);
+    free(P);
+    free(sigma);
+}
+
+#if SYMBOL_WIDTH > 8
+/*
+    token_test
+    Runs match_test over tokens whose low bytes collide ('a' and 'd' share a low byte), so matching must key on whole symbols.
+*/
+void token_test(char *T_c, int n, char *P_c, int m, int alpha, int *correct, int correct_len) {
+    symbol *T = to_symbols(T_c, n), *P = to_symbols(P_c, m), sigma[4] = {0x161, 0x162, 0x163, 0x261};
+    int i, *results = malloc(n * sizeof(int));
+    for (i = 0; i < n; i++) T[i] = (T[i] == 'd') ? 0x261 : 0x100 + T[i];
+    for (i = 0; i < m; i++) P[i] = (P[i] == 'd') ? 0x261 : 0x100 + P[i];
+    int results_len = fingerprint_match(T, n, P, m, sigma, 4, alpha, results);
+    test_check(correct, correct_len, results, results_len);
+    stream_test(T, n, P, m, sigma, 4, correct, correct_len);
+    free(results);
+    free(T);
+    free(P);
+}
+#endif
+
 int main(void) {
     char *T = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbbbbbbaaaaaaaaaabbbbbcccccaaaaa", *P = "aaaaabbbbbcccccaaaaa";
-    int i, *results = (int*)malloc(81 * sizeof(int)), alpha = 0, *correct = (int*)malloc(81 * sizeof(int)), correct_len;
+    int i, alpha = 0, *correct = (int*)malloc(81 * sizeof(int)), correct_len;
     correct[0] = 19; correct[1] = 59; correct[2] = 99;
     correct_len = 3;
-    int results_len = fingerprint_match(T, 100, P, 20, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 100, P, 20, "abcd", 4, correct, correct_len);
+    match_test(T, 100, P, 20, "abcd", 4, alpha, correct, correct_len);
 
     P = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccddddd";
     correct[0] = 39;
     correct_len = 1;
-    results_len = fingerprint_match(T, 100, P, 40, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 100, P, 40, "abcd", 4, correct, correct_len);
+    match_test(T, 100, P, 40, "abcd", 4, alpha, correct, correct_len);
 
     T = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbcccccaaaaaaaaaabbbbbcccccddddd";
     correct[0] = 39; correct[1] = 99;
     correct_len = 2;
-    results_len = fingerprint_match(T, 100, P, 40, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 100, P, 40, "abcd", 4, correct, correct_len);
+    match_test(T, 100, P, 40, "abcd", 4, alpha, correct, correct_len);
+#if SYMBOL_WIDTH > 8
+    token_test(T, 100, P, 40, alpha, correct, correct_len);
+#endif
 
     P = "aaaaabbbbbcccccaaaaaaaaaabbbbbcc";
     correct[0] = 31; correct[1] = 71; correct[2] = 91;
     correct_len = 3;
-    results_len = fingerprint_match(T, 100, P, 32, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 100, P, 32, "abcd", 4, correct, correct_len);
+    match_test(T, 100, P, 32, "abcd", 4, alpha, correct, correct_len);
 
     P = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaa";
     correct[0] = 63;
     correct_len = 1;
-    results_len = fingerprint_match(T, 100, P, 64, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 100, P, 64, "abcd", 4, correct, correct_len);
+    match_test(T, 100, P, 64, "abcd", 4, alpha, correct, correct_len);
 
     T = "aaaaaaabbbbbcccccaaaaaaaaaabbbaaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaa";
     correct[0] = 93;
     correct_len = 1;
-    results_len = fingerprint_match(T, 94, P, 64, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 94, P, 64, "abcd", 4, correct, correct_len);
+    match_test(T, 94, P, 64, "abcd", 4, alpha, correct, correct_len);
 
     T = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
     P = "aaaaaaaaaaaaaaaaaaaa";
@@ -72,41 +360,66 @@ int main(void) {
         correct[i] = i + 19;
     }
     correct_len = 81;
-    results_len = fingerprint_match(T, 100, P, 20, "a", 1, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 100, P, 20, "a", 1, correct, correct_len);
+    match_test(T, 100, P, 20, "a", 1, alpha, correct, correct_len);
 
     T = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
     P = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
     correct[0] = 63; correct[1] = 199;
     correct_len = 2;
-    results_len = fingerprint_match(T, 200, P, 64, "ab", 2, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 200, P, 64, "ab", 2, correct, correct_len);
+    match_test(T, 200, P, 64, "ab", 2, alpha, correct, correct_len);
 
     T = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabb";
     P = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabb";
-    results_len = fingerprint_match(T, 200, P, 64, "ab", 2, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 200, P, 64, "ab", 2, correct, correct_len);
+    match_test(T, 200, P, 64, "ab", 2, alpha, correct, correct_len);
 
     T = "aaaaaaabbbbbcccccaaaaaaaaaabbaaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaa";
     P = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaa";
     correct[0] = 92;
     correct_len = 1;
-    results_len = fingerprint_match(T, 93, P, 64, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 93, P, 64, "abcd", 4, correct, correct_len);
+    match_test(T, 93, P, 64, "abcd", 4, alpha, correct, correct_len);
 
     T = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbcccccaaaaaaaaaabbbbbcccccddddd";
     P = "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaaaaaaabbbbbcccccdddddaaaaabbbbbcccccaaaaa";
     correct[0] = 159;
     correct_len = 1;
-    results_len = fingerprint_match(T, 200, P, 160, "abcd", 4, alpha, results);
-    test_check(correct, correct_len, results, results_len);
-    stream_test(T, 200, P, 160, "abcd", 4, correct, correct_len);
+    match_test(T, 200, P, 160, "abcd", 4, alpha, correct, correct_len);
+
+    T = "ddddabababababababababababababababacabababababababababababababababac";
+    P = "abababababababababababababababac";
+    correct[0] = 35; correct[1] = 67;
+    correct_len = 2;
+    match_test(T, 68, P, 32, "abcd", 4, alpha, correct, correct_len);
+
+    T = "aaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbacccbaaccbaaccbaaccbaaccbaacacacccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbacccbaaccbaaccbaaccbaaccbaac";
+    P = "aaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbaaccbacccbaaccbaaccbaaccbaaccbaac";
+    correct[0] = 207;
+    correct_len = 1;
+    match_test(T, 208, P, 133, "abc", 3, alpha, correct, correct_len);
 
-    free(results);
     free(correct);
+
+    symbol run_P[3] = {'a', 'b', 'a'}, run_values[9] = {'c', 'a', 'b', 'a', 'c', 'a', 'b', 'a', 'a'};
+    int run_P_lengths[3] = {300, 1, 200}, run_lengths[9] = {5000, 300, 1, 200, 70000, 301, 1, 199, 9000};
+    symbol *run_pattern = malloc(501 * sizeof(symbol));
+    for (i = 0, correct_len = 0; i < 3; i++) while (run_P_lengths[i]--) run_pattern[correct_len++] = run_P[i];
+    run_test(run_pattern, 501, run_values, run_lengths, 9);
+    run_test(run_pattern, 100, run_values, run_lengths, 9);
+    run_test(&run_pattern[250], 200, run_values, run_lengths, 9);
+    free(run_pattern);
+
+    fold_test(5000, 40);
+    fold_test(5000, 300);
+    for (i = 0; i < 100; i++) short_test(1 + i % 8, 500);
+    for (i = 0; i < 20; i++) {
+        value_test(124, 7, 3000, 5 + rand() % 60);
+#if SYMBOL_WIDTH > 8
+        value_test(65529, 7, 3000, 5 + rand() % 60);
+        value_test(4000000000U, 7, 3000, 5 + rand() % 60);
+#endif
+    }
+    progression_test(3);
+    progression_test(20);
+    progression_test(300);
+    PERF_REPORT(stdout);
     return 0;
 }
@@ -9,9 +9,18 @@
 
 #include "karp_rabin.h"
 #include "kmp.h"
+#include "match_sink.h"
+#include "perf_counters.h"
+#include "fold_table.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define EXACTMATCH_CHUNK 4096
+#define EXACTMATCH_SNAPSHOT 162
 
 /*
     typedef struct viable_occurance
@@ -98,37 +107,98 @@ void add_occurance(fingerprinter printer, fingerprint T_f, int location, pattern
 }
 
 /*
-    fingerprint_match
-    Exact matching on the whole text and pattern using fingerprints.
+    verify_occurance
+    Checks a reported occurance against the text.
     Parameters:
-        char *T - Text
-        int n - Length of text
-        char *P - Pattern
-        int m - Length of pattern
-        char *sigma - Alphabet
-        int s_sigma - Size of alphabet
-        int *results - Matches
+        symbol *T       - Text
+        symbol *P       - Pattern
+        int    m        - Length of pattern
+        int    location - Index of the last character of the occurance
+    Returns int:
+        1 if T[location - m + 1 .. location] = P
+        0 otherwise
+*/
+int verify_occurance(symbol *T, symbol *P, int m, int location) {
+    return (location >= m - 1) && (memcmp(&T[location - m + 1], P, m * sizeof(symbol)) == 0);
+}
+
+/*
+    verify_promotion
+    Checks a viable occurance promoted out of a row against the text, before it is added to the next row.
+    Parameters:
+        symbol *T        - Text
+        symbol *P        - Pattern
+        int    half      - Size of the row it is promoted out of, which it has already been checked for
+        int    location  - Index of the last character of the occurance
+        int    *last     - The last occurance checked into the next row, or -1
+        int    *period   - A distance known to be a period of P[0 .. 2 * half - 1], or 0
+    Returns int:
+        1 if T[location - 2 * half + 1 .. location] = P[0 .. 2 * half - 1]
+        0 otherwise
+        last and period updated by reference.
+    Notes:
+        Occurances closer than half to the last one are checked only for the symbols since it, once their distance is
+        known to be a period, so each row reads each symbol of the text O(1) times.
+*/
+int verify_promotion(symbol *T, symbol *P, int half, int location, int *last, int *period) {
+    int d = location - *last;
+    if (d < half) {
+        if (d != *period) {
+            if (memcmp(P, &P[d], (2 * half - d) * sizeof(symbol))) return 0;
+            *period = d;
+        }
+        if (memcmp(&T[*last + 1], &P[2 * half - d], d * sizeof(symbol))) return 0;
+    } else if (memcmp(&T[location - half + 1], &P[half], half * sizeof(symbol))) return 0;
+    *last = location;
+    return 1;
+}
+
+/*
+    fingerprint_match_core
+    Exact matching on the whole text and pattern using fingerprints, passing each match to a sink.
+    Parameters:
+        symbol        *T               - Text
+        int           n                - Length of text
+        symbol        *P               - Pattern
+        int           m                - Length of pattern
+        symbol        *sigma           - Alphabet
+        int           s_sigma          - Size of alphabet
+        int           alpha            - Desired level of accuracy. Unused if verify is set or printer is given
+        int           verify           - 1 to use a word-sized prime and check every match against T, 0 otherwise
+        fingerprinter printer          - The printer to use, or NULL to build one for alpha or verify. Not freed
+        int           *false_positives - Number of fingerprint matches rejected by verification. May be NULL if verify is 0
+        match_sink    *sink            - Destination for the location of each match
     Returns int:
         Number of matches.
-        Location of matches returned by reference in results.
+        Locations of matches passed to sink in increasing order.
+    Notes:
+        Matching stops early if the sink reports that it is full.
+        If verify is set, every viable occurance is checked against T by verify_promotion before it enters a row, as well
+        as every match, so rows only ever hold true occurances and the output is exact whatever the prime.
+        When p is below 2^32, which it always is if verify is set, prefix fingerprints of T are kept a block at a time by
+        block_prefixes and only put together for the locations the rows read, instead of one concatenation per symbol.
 */
-int fingerprint_match(char *T, int n, char *P, int m, char *sigma, int s_sigma, int alpha, int *results) {
-    int lm = 0, f = 0, i = 0, j, matches = 0;
+int fingerprint_match_core(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, int alpha, int verify, fingerprinter printer, int *false_positives, match_sink *sink) {
+    int lm = 0, f = 0, i = 0, j, matches = 0, full = 0, location, own = !printer;
+    if (verify) *false_positives = 0;
     while ((1 << lm) <= m) lm++;
     while ((1 << f <= lm)) f++;
     lm -= f + 1;
-    kmp_state P_f = kmp_build(P, 1 << f, m, sigma, s_sigma);
+    kmp_state P_f = kmp_build(P, (1 << f < m) ? 1 << f : m, m, sigma, s_sigma);
     j = P_f.m;
     if (j == m) {
-        for (i = 0; i < n; i++) if (kmp_stream(&P_f, T[i], i) != -1) results[matches++] = i;
+        for (i = 0; (i < n) && (!full); i++) if (kmp_stream(&P_f, T[i], i) != -1) {
+            matches++;
+            full = matchsink_emit(sink, i);
+        }
         kmp_free(&P_f);
         return matches;
     }
 
-    fingerprinter printer = fingerprinter_build(n, alpha);
+    if (own) printer = (verify) ? fingerprinter_build_word(n) : fingerprinter_build(n, alpha);
     fingerprint T_f = init_fingerprint(), T_cur = init_fingerprint(), tmp = init_fingerprint();
-    pattern_row *P_i = malloc(lm * sizeof(pattern_row));
-    while (j << 2 < m) {
+    pattern_row *P_i = malloc((lm + 1) * sizeof(pattern_row));
+    while (j << 1 < m) {
         P_i[i].row_size = j;
         P_i[i].period = 0;
         P_i[i].count = 0;
@@ -157,46 +227,80 @@ int fingerprint_match(char *T, int n, char *P, int m, char *sigma, int s_sigma,
 
     P_i = realloc(P_i, lm * sizeof(pattern_row));
 
+    block_prefixes prefixes;
+    int blocks = blockprefix_build(printer, T, &prefixes);
     fingerprint *past_prints = malloc(lm * sizeof(fingerprint));
-    for (i = 0; i < lm; i++) past_prints[i] = init_fingerprint();
+    int *last = malloc(lm * sizeof(int)), *period = calloc(lm, sizeof(int));
+    for (i = 0; i < lm; i++) {
+        past_prints[i] = init_fingerprint();
+        last[i] = -1;
+    }
     j = 0;
 
-    for (i = 0; i < n; i++) {
-        set_fingerprint(printer, &T[i], 1, T_cur);
-        fingerprint_concat(printer, past_prints[(j) ? j - 1 : lm - 1], T_cur, tmp);
-        fingerprint_assign(tmp, past_prints[j]);
+    for (i = 0; (i < n) && (!full); i++) {
+        if (blocks) blockprefix_advance(&prefixes, i);
+        else {
+            set_fingerprint(printer, &T[i], 1, T_cur);
+            fingerprint_concat(printer, past_prints[(j) ? j - 1 : lm - 1], T_cur, tmp);
+            fingerprint_assign(tmp, past_prints[j]);
+        }
 
         if ((P_i[j].count > 0) && (i - P_i[j].VOs[0].location >= P_i[j].row_size)) {
-            fingerprint_assign(past_prints[(P_i[j].VOs[0].location + P_i[j].row_size) % lm], T_cur);
+            if (blocks) blockprefix_get(printer, &prefixes, P_i[j].VOs[0].location + P_i[j].row_size + 1, T_cur);
+            else fingerprint_assign(past_prints[(P_i[j].VOs[0].location + P_i[j].row_size) % lm], T_cur);
             fingerprint_suffix(printer, T_cur, P_i[j].VOs[0].T_f, T_f);
 
             if (fingerprint_equals(P_i[j].P, T_f)) {
-                if (j == lm - 1) results[matches++] = P_i[j].VOs[0].location + P_i[j].row_size;
-                else add_occurance(printer, T_cur, P_i[j].VOs[0].location + P_i[j].row_size, &P_i[j + 1], tmp);
+                if (j == lm - 1) {
+                    location = P_i[j].VOs[0].location + P_i[j].row_size;
+                    if ((!verify) || (verify_occurance(T, P, m, location))) {
+                        matches++;
+                        full = matchsink_emit(sink, location);
+                    } else (*false_positives)++;
+                } else {
+                    location = P_i[j].VOs[0].location + P_i[j].row_size;
+                    if ((!verify) || (verify_promotion(T, P, P_i[j].row_size, location, &last[j], &period[j]))) {
+                        add_occurance(printer, T_cur, location, &P_i[j + 1], tmp);
+                    } else (*false_positives)++;
+                }
             }
             shift_row(printer, &P_i[j], tmp);
         }
         if (kmp_stream(&P_f, T[i], i) != -1) {
-            add_occurance(printer, past_prints[j], i, &P_i[0], tmp);
+            if (blocks) {
+                blockprefix_get(printer, &prefixes, i + 1, T_cur);
+                add_occurance(printer, T_cur, i, &P_i[0], tmp);
+            } else add_occurance(printer, past_prints[j], i, &P_i[0], tmp);
         }
         if (++j == lm) j = 0;
     }
 
-    while (j < lm) {
-        if ((P_i[j].count > 0) && (i - P_i[j].VOs[0].location >= P_i[j].row_size)) {
-            fingerprint_assign(past_prints[(P_i[j].VOs[0].location + P_i[j].row_size) % lm], T_cur);
+    while ((j < lm) && (!full)) {
+        if ((P_i[j].count > 0) && (n - 1 - P_i[j].VOs[0].location >= P_i[j].row_size)) {
+            if (blocks) blockprefix_get(printer, &prefixes, P_i[j].VOs[0].location + P_i[j].row_size + 1, T_cur);
+            else fingerprint_assign(past_prints[(P_i[j].VOs[0].location + P_i[j].row_size) % lm], T_cur);
             fingerprint_suffix(printer, T_cur, P_i[j].VOs[0].T_f, T_f);
 
             if (fingerprint_equals(P_i[j].P, T_f)) {
-                if (j == lm - 1) results[matches++] = P_i[j].VOs[0].location + P_i[j].row_size;
-                else add_occurance(printer, T_cur, P_i[j].VOs[0].location + P_i[j].row_size, &P_i[j + 1], tmp);
+                if (j == lm - 1) {
+                    location = P_i[j].VOs[0].location + P_i[j].row_size;
+                    if ((!verify) || (verify_occurance(T, P, m, location))) {
+                        matches++;
+                        full = matchsink_emit(sink, location);
+                    } else (*false_positives)++;
+                } else {
+                    location = P_i[j].VOs[0].location + P_i[j].row_size;
+                    if ((!verify) || (verify_promotion(T, P, P_i[j].row_size, location, &last[j], &period[j]))) {
+                        add_occurance(printer, T_cur, location, &P_i[j + 1], tmp);
+                    } else (*false_positives)++;
+                }
             }
             shift_row(printer, &P_i[j], tmp);
         }
         j++;
     }
 
-    fingerprinter_free(printer);
+    if (own) fingerprinter_free(printer);
     fingerprint_free(T_f);
     fingerprint_free(T_cur);
     fingerprint_free(tmp);
@@ -205,13 +309,86 @@ int fingerprint_match(char *T, int n, char *P, int m, char *sigma, int s_sigma,
         fingerprint_free(P_i[i].period_f);
         fingerprint_free(P_i[i].VOs[0].T_f);
         fingerprint_free(P_i[i].VOs[1].T_f);
+        fingerprint_free(past_prints[i]);
     }
     free(P_i);
+    free(past_prints);
+    free(last);
+    free(period);
     kmp_free(&P_f);
 
     return matches;
 }
 
+/*
+    fingerprint_match_sink
+    Exact matching on the whole text and pattern using fingerprints, passing each match to a sink.
+    Parameters:
+        symbol     *T      - Text
+        int        n       - Length of text
+        symbol     *P      - Pattern
+        int        m       - Length of pattern
+        symbol     *sigma  - Alphabet
+        int        s_sigma - Size of alphabet
+        int        alpha   - Desired level of accuracy
+        match_sink *sink   - Destination for the location of each match
+    Returns int:
+        Number of matches.
+        Locations of matches passed to sink in increasing order.
+    Notes:
+        Matching stops early if the sink reports that it is full.
+*/
+int fingerprint_match_sink(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, int alpha, match_sink *sink) {
+    return fingerprint_match_core(T, n, P, m, sigma, s_sigma, alpha, 0, NULL, NULL, sink);
+}
+
+/*
+    fingerprint_match_verified
+    Las Vegas exact matching on the whole text and pattern using fingerprints, passing each match to a sink.
+    Parameters:
+        symbol     *T               - Text
+        int        n                - Length of text
+        symbol     *P               - Pattern
+        int        m                - Length of pattern
+        symbol     *sigma           - Alphabet
+        int        s_sigma          - Size of alphabet
+        match_sink *sink            - Destination for the location of each match
+        int        *false_positives - Number of fingerprint matches rejected by verification
+    Returns int:
+        Number of matches.
+        Locations of matches passed to sink in increasing order.
+        Number of rejected matches returned by reference in false_positives.
+    Notes:
+        Las Vegas: every viable occurance is checked against T before it enters a row, and every match before it is
+        reported, so the output is exact and only the running time depends on the fingerprints. This allows a prime that
+        fits in one machine word (fingerprinter_build_word), which keeps the arithmetic small.
+        The checks read each symbol of T O(log(m)) times in total, plus 2^(j+1) symbols for each collision in row j.
+*/
+int fingerprint_match_verified(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, match_sink *sink, int *false_positives) {
+    return fingerprint_match_core(T, n, P, m, sigma, s_sigma, 0, 1, NULL, false_positives, sink);
+}
+
+/*
+    fingerprint_match
+    Exact matching on the whole text and pattern using fingerprints.
+    Parameters:
+        symbol *T - Text
+        int n - Length of text
+        symbol *P - Pattern
+        int m - Length of pattern
+        symbol *sigma - Alphabet
+        int s_sigma - Size of alphabet
+        int alpha - Desired level of accuracy
+        int *results - Matches
+    Returns int:
+        Number of matches.
+        Location of matches returned by reference in results.
+*/
+int fingerprint_match(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma, int alpha, int *results) {
+    match_sink sink = matchsink_array(results);
+    return fingerprint_match_sink(T, n, P, m, sigma, s_sigma, alpha, &sink);
+}
+
 /*
     typedef struct fmatch_state
     Structure for the current state of the fingerprint matching algorithm.
@@ -226,6 +403,7 @@ int fingerprint_match(char *T, int n, char *P, int m, char *sigma, int s_sigma,
         fingerprint   tmp          - Temporary space
         fingerprint   *past_prints - The last lm fingerprints to occur
         pattern_row   *P_i         - Array of pattern components
+        int           *schedule    - For row j, the next row to check at 2j and the past print before its own at 2j + 1
 */
 typedef struct {
     int lm, row_index, periodic;
@@ -233,6 +411,7 @@ typedef struct {
     fingerprinter printer;
     fingerprint T_f, T_cur, tmp, *past_prints;
     pattern_row *P_i;
+    int *schedule;
 } fmatch_state;
 
 int fmatch_size(fmatch_state state) {
@@ -240,87 +419,146 @@ int fmatch_size(fmatch_state state) {
     if (!state.periodic) {
         result += fingerprinter_size(state.printer) + fingerprint_size(state.T_f) + fingerprint_size(state.T_cur) + fingerprint_size(state.tmp);
         int i;
+        result += sizeof(int*) + sizeof(int) * 2 * state.lm;
         for (i = 0; i < state.lm; i++) result += sizeof(fingerprint) * 5 + fingerprint_size(state.past_prints[i]) + sizeof(int) * 5 + fingerprint_size(state.P_i[i].P) + fingerprint_size(state.P_i[i].period_f) + fingerprint_size(state.P_i[i].VOs[0].T_f) + fingerprint_size(state.P_i[i].VOs[1].T_f);
     }
     return result;
 }
 
+/*
+    fmatch_rows
+    Sets up the rows of a fingerprint-matching state once the prefix handled by KMP is known.
+    Parameters:
+        fmatch_state *state - The state, with P_f built and lm an upper bound on the number of rows
+        int          m      - Length of the pattern
+        int          n      - Length of the text
+        int          alpha  - Desired level of accuracy
+    Returns void:
+        Parameter state modified by reference. Row i covers the pattern from 2^i * P_f.m up to the next row, or m for the
+        last row. The fingerprints of the rows are left empty.
+*/
+void fmatch_rows(fmatch_state *state, int m, int n, int alpha) {
+    int i = 0, j = state->P_f.m;
+    symbol zero = 0;
+    state->periodic = 0;
+    state->printer = fingerprinter_build(n, alpha);
+    state->T_f = init_fingerprint();
+    state->T_cur = init_fingerprint();
+    state->tmp = init_fingerprint();
+    state->P_i = malloc((state->lm + 1) * sizeof(pattern_row));
+
+    while (1) {
+        state->P_i[i].row_size = (j << 1 < m) ? j : m - j;
+        state->P_i[i].period = 0;
+        state->P_i[i].count = 0;
+        state->P_i[i].P = init_fingerprint();
+        state->P_i[i].period_f = init_fingerprint();
+        state->P_i[i].VOs[0].T_f = init_fingerprint();
+        state->P_i[i].VOs[0].location = 0;
+        state->P_i[i].VOs[1].T_f = init_fingerprint();
+        state->P_i[i].VOs[1].location = 0;
+        if (j << 1 >= m) break;
+        j <<= 1;
+        i++;
+    }
+
+    state->lm = i + 1;
+
+    state->P_i = realloc(state->P_i, state->lm * sizeof(pattern_row));
+
+    state->past_prints = malloc(state->lm * sizeof(fingerprint));
+    for (i = 0; i < state->lm; i++) state->past_prints[i] = init_fingerprint();
+    state->schedule = malloc(2 * state->lm * sizeof(int));
+    for (i = 0; i < state->lm; i++) {
+        state->schedule[i << 1] = (i + 1 == state->lm) ? 0 : i + 1;
+        state->schedule[(i << 1) + 1] = (i) ? i - 1 : state->lm - 1;
+    }
+    set_fingerprint(state->printer, &zero, 1, state->T_cur);
+    state->row_index = 0;
+}
+
+/*
+    fmatch_empty
+    Sets up fingerprint matching for an empty prefix, which ends at every index of the text. Patterns of at most two
+    characters leave nothing before the part exactmatch_state matches with KMP.
+    Parameters:
+        fmatch_state *state - The state to set
+*/
+void fmatch_empty(fmatch_state *state) {
+    kmp_state empty = {0};
+    state->P_f = empty;
+    state->periodic = 1;
+}
+
 /*
     fmatch_build
     Constructs a fingerprint-matching state.
     Parameters:
-        char *P      - The pattern
-        int  m       - Length of the pattern
-        char *sigma  - The alphabet
-        int  s_sigma - Size of the alphabet
-        int  n       - Length of the text
-        int  alpha   - Desired level of accuracy
+        symbol *P      - The pattern
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet
+        int    s_sigma - Size of the alphabet
+        int    n       - Length of the text
+        int    alpha   - Desired level of accuracy
     Returns fmatch_state:
         Initial state for fingerprint matching
 */
-fmatch_state fmatch_build(char *P, int m, char *sigma, int s_sigma, int n, int alpha) {
+fmatch_state fmatch_build(symbol *P, int m, symbol *sigma, int s_sigma, int n, int alpha) {
     fmatch_state state;
-    int f = 0, j;
+    int f = 0, i, j;
     state.lm = 0;
     while ((1 << state.lm) <= m) state.lm++;
     while ((1 << f <= state.lm)) f++;
     state.lm -= f + 1;
-    state.P_f = kmp_build(P, 1 << f, m, sigma, s_sigma);
+    if (m == 0) {
+        fmatch_empty(&state);
+        return state;
+    }
+    state.P_f = kmp_build(P, (1 << f < m) ? 1 << f : m, m, sigma, s_sigma);
     j = state.P_f.m;
     if (j == m) {
         state.periodic = 1;
         return state;
     }
 
-    state.periodic = 0;
-    state.printer = fingerprinter_build(n, alpha);
-    state.T_f = init_fingerprint();
-    state.T_cur = init_fingerprint();
-    state.tmp = init_fingerprint();
-    state.P_i = malloc(((state.lm) ? state.lm : 1) * sizeof(pattern_row));
-
-    int i = 0;
-    while (j << 2 < m) {
-        state.P_i[i].row_size = j;
-        state.P_i[i].period = 0;
-        state.P_i[i].count = 0;
-        state.P_i[i].P = init_fingerprint();
-        set_fingerprint(state.printer, &P[j], j, state.P_i[i].P);
-        state.P_i[i].period_f = init_fingerprint();
-        state.P_i[i].VOs[0].T_f = init_fingerprint();
-        state.P_i[i].VOs[0].location = 0;
-        state.P_i[i].VOs[1].T_f = init_fingerprint();
-        state.P_i[i].VOs[1].location = 0;
-        j <<= 1;
-        i++;
+    fmatch_rows(&state, m, n, alpha);
+    for (i = 0; i < state.lm; i++) {
+        set_fingerprint(state.printer, &P[j], state.P_i[i].row_size, state.P_i[i].P);
+        j += state.P_i[i].row_size;
     }
-    state.P_i[i].period = 0;
-    state.P_i[i].count = 0;
-    state.P_i[i].P = init_fingerprint();
-    set_fingerprint(state.printer, &P[j], m - j, state.P_i[i].P);
-    state.P_i[i].period_f = init_fingerprint();
-    state.P_i[i].VOs[0].T_f = init_fingerprint();
-    state.P_i[i].VOs[0].location = 0;
-    state.P_i[i].VOs[1].T_f = init_fingerprint();
-    state.P_i[i].VOs[1].location = 0;
-    state.P_i[i].row_size = m - j;
-
-    state.lm = i + 1;
-
-    state.P_i = realloc(state.P_i, state.lm * sizeof(pattern_row));
-
-    state.past_prints = malloc(state.lm * sizeof(fingerprint));
-    for (i = 0; i < state.lm; i++) state.past_prints[i] = init_fingerprint();
-    state.row_index = 0;
     return state;
 }
 
+/*
+    fmatch_service
+    Checks the oldest viable occurance of a row once the text has passed the end of the row's portion of the pattern.
+    Parameters:
+        fmatch_state *state - The current state of the algorithm
+        pattern_row  *row   - The row, P_i[j], holding a viable occurance at least row_size characters back
+        int          j      - Index of the row
+    Returns int:
+        Index of the match if the row is the last and the occurance extends to a match.
+        -1 otherwise
+        Parameter state modified by reference: the occurance is passed to the next row if it extends, and removed.
+*/
+int fmatch_service(fmatch_state *state, pattern_row *row, int j) {
+    int result = -1, location = row->VOs[0].location + row->row_size;
+    fingerprint prefix = state->past_prints[location % state->lm];
+    fingerprint_suffix(state->printer, prefix, row->VOs[0].T_f, state->T_f);
+    if (fingerprint_equals(row->P, state->T_f)) {
+        if (j == state->lm - 1) result = location;
+        else add_occurance(state->printer, prefix, location, row + 1, state->tmp);
+    }
+    shift_row(state->printer, row, state->tmp);
+    return result;
+}
+
 /*
     fmatch_stream
     Performs next round of fingerprint matching.
     Parameters:
         fmatch_state *state - The current state of the algorithm
-        char T_i - The next character of the text
+        symbol T_i - The next character of the text
         int i - The index of the text
     Returns int:
         Index of latest match if one was found in this round.
@@ -328,34 +566,33 @@ fmatch_state fmatch_build(char *P, int m, char *sigma, int s_sigma, int n, int a
         Parameter state modified by reference to the next state of the algorithm.
     Notes:
         Matches may be found up to log_2(m) rounds after index was entered.
+        Each round extends one past print by T_i and checks one row, in the order fixed by the schedule. The new past print
+        is written to the spare fingerprint tmp, which then takes the old one's place, and T_cur keeps the powers of r of a
+        single character so only its symbol changes. Rows with an occurance due are handled by fmatch_service.
 */
-int fmatch_stream(fmatch_state *state, char T_i, int i) {
+int fmatch_stream(fmatch_state *state, symbol T_i, int i) {
     int result = -1;
+    PERF_BEGIN(start);
     if (state->periodic) {
-        result = kmp_stream(&state->P_f, T_i, i);
+        result = (state->P_f.m) ? kmp_stream(&state->P_f, T_i, i) : i;
+        PERF_END(PERF_KMP_PREFIX, start, 1);
     } else {
-        int j = state->row_index, lm = state->lm;
-        fingerprinter printer = state->printer;
-        fingerprint T_f = state->T_f, T_cur = state->T_cur, tmp = state->tmp, *past_prints = state->past_prints;
-        pattern_row P_j = state->P_i[j];
-        set_fingerprint(printer, &T_i, 1, T_cur);
-        fingerprint_concat(printer, past_prints[(j) ? j - 1 : lm - 1], T_cur, tmp);
-        fingerprint_assign(tmp, past_prints[j]);
-
-        if ((P_j.count > 0) && (i - P_j.VOs[0].location >= P_j.row_size)) {
-            fingerprint_assign(past_prints[(P_j.VOs[0].location + P_j.row_size) % lm], T_cur);
-            fingerprint_suffix(printer, T_cur, P_j.VOs[0].T_f, T_f);
-
-            if (fingerprint_equals(P_j.P, T_f)) {
-                if (j == lm - 1) result = P_j.VOs[0].location + P_j.row_size;
-                else add_occurance(printer, T_cur, P_j.VOs[0].location + P_j.row_size, &state->P_i[j + 1], tmp);
-            }
-            shift_row(printer, &state->P_i[j], tmp);
-        }
+        int j = state->row_index, *schedule = &state->schedule[j << 1];
+        fingerprint *past_prints = state->past_prints, print = state->tmp;
+        pattern_row *row = &state->P_i[j];
+        fingerprint_set_symbol(state->printer, T_i, state->T_cur);
+        fingerprint_concat(state->printer, past_prints[schedule[1]], state->T_cur, print);
+        state->tmp = past_prints[j];
+        past_prints[j] = print;
+
+        if ((row->count > 0) && (i - row->VOs[0].location >= row->row_size)) result = fmatch_service(state, row, j);
+        PERF_END(PERF_ROWS, start, 1);
+        PERF_RESTART(start);
         if (kmp_stream(&state->P_f, T_i, i) != -1) {
-            add_occurance(printer, past_prints[j], i, &state->P_i[0], tmp);
+            add_occurance(state->printer, print, i, state->P_i, state->tmp);
         }
-        if (++state->row_index == lm) state->row_index = 0;
+        PERF_END(PERF_KMP_PREFIX, start, 1);
+        state->row_index = schedule[0];
     }
     return result;
 }
@@ -381,8 +618,11 @@ void fmatch_free(fmatch_state *state) {
         fingerprint_free(state->P_i[i].period_f);
         fingerprint_free(state->P_i[i].VOs[0].T_f);
         fingerprint_free(state->P_i[i].VOs[1].T_f);
+        fingerprint_free(state->past_prints[i]);
     }
     free(state->P_i);
+    free(state->past_prints);
+    free(state->schedule);
 }
 
 /*
@@ -395,57 +635,333 @@ void fmatch_free(fmatch_state *state) {
         int          m          - Length of the pattern
         int          lm         - log_2(m)
         int          *buffer    - The past 2*log_2(m) results of the fingerprint matching
+        symbol       *fold      - FOLD_SIZE entries folding each character before it is matched, NULL if none
 */
 typedef struct {
     fmatch_state fmatch;
     kmp_state kmp;
     int text_index, m, lm, *buffer;
+    symbol *fold;
 } exactmatch_state;
 
 int exactmatch_size(exactmatch_state state) {
-    return sizeof(int) * (3 + state.lm) + kmp_size(state.kmp) + fmatch_size(state.fmatch) + sizeof(int*);
+    return sizeof(int) * (3 + state.lm) + kmp_size(state.kmp) + fmatch_size(state.fmatch) + sizeof(int*) + sizeof(symbol*) + ((state.fold) ? FOLD_SIZE * sizeof(symbol) : 0);
 }
 
 /*
     exactmatch_build
     Constructs an exact matching algorithm.
     Parameters:
-        char *P      - The pattern
-        int  m       - Length of the pattern
-        char *sigma  - The alphabet
-        int  s_sigma - The size of the alphabet
-        int  n       - The length of the text
-        int  alpha   - The level of accuracy desired
+        symbol *P      - The pattern
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet
+        int    s_sigma - The size of the alphabet
+        int    n       - The length of the text
+        int    alpha   - The level of accuracy desired
     Returns exactmatch_state:
         The initial state for the algorithm with pattern P.
 */
-exactmatch_state exactmatch_build(char *P, int m, char *sigma, int s_sigma, int n, int alpha) {
+exactmatch_state exactmatch_build(symbol *P, int m, symbol *sigma, int s_sigma, int n, int alpha) {
+    PERF_BEGIN(start);
     exactmatch_state state;
     state.m = m - 1;
-    int lm = 0;
+    int i, lm = 0;
     while ((1 << lm) <= m) lm++;
     state.fmatch = fmatch_build(P, m - lm, sigma, s_sigma, n, alpha);
     state.kmp = kmp_build(&P[m - lm], lm, lm, sigma, s_sigma);
     state.lm = lm;
     state.buffer = malloc(lm * sizeof(int));
+    for (i = 0; i < lm; i++) state.buffer[i] = -1;
     state.text_index = 0;
+    state.fold = NULL;
+    PERF_END(PERF_BUILD, start, m);
     return state;
 }
 
 /*
-    exactmatch_stream
-    Performs the next round of exact matching.
+    exactmatch_build_fold
+    Constructs an exact matching algorithm that folds the pattern and the text through a table, e.g. to ignore case.
     Parameters:
-        exactmatch_state *state - The current state of the algorithm
-        char             T_i    - The next character of the text
+        symbol *P      - The pattern
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet, before folding
+        int    s_sigma - The size of the alphabet
+        int    n       - The length of the text
+        int    alpha   - The level of accuracy desired
+        symbol *fold   - FOLD_SIZE entries, see fold_table.h. Copied, so the caller may free it
+    Returns exactmatch_state:
+        The initial state for the algorithm with the folded pattern. Matches are reported at the same indices as in the
+        original text.
+    Notes:
+        The KMP tables and row fingerprints are built from the folded pattern and alphabet, and exactmatch_stream folds
+        each character with one table lookup, so the text is read once and never copied.
+*/
+exactmatch_state exactmatch_build_fold(symbol *P, int m, symbol *sigma, int s_sigma, int n, int alpha, symbol *fold) {
+    symbol *folded_P = malloc(m * sizeof(symbol)), *folded_sigma = malloc(s_sigma * sizeof(symbol));
+    int i;
+    for (i = 0; i < m; i++) folded_P[i] = fold_symbol(fold, P[i]);
+    s_sigma = foldtable_alphabet(fold, sigma, s_sigma, folded_sigma);
+    exactmatch_state state = exactmatch_build(folded_P, m, folded_sigma, s_sigma, n, alpha);
+    state.fold = malloc(FOLD_SIZE * sizeof(symbol));
+    memcpy(state.fold, fold, FOLD_SIZE * sizeof(symbol));
+    free(folded_P);
+    free(folded_sigma);
+    return state;
+}
+
+/*
+    typedef struct exactmatch_builder
+    Structure for an exact matching algorithm under construction, fed the pattern in order and in pieces of any size.
+    Components:
+        exactmatch_state state    - The algorithm built so far
+        kmp_builder      prefix   - KMP for the start of the pattern, while it is still periodic
+        symbol           *head    - The first head_len characters of the pattern
+        int              head_len - Number of characters KMP needs before it can start
+        int              m_f      - Length of the part of the pattern handled by fingerprints
+        int              index    - Number of characters of the pattern read
+        int              stage    - 0 while reading head, 1 while extending prefix, 2 while reading rows
+        int              row      - Current row of the fingerprint matching
+        int              row_end  - Index of the pattern at the end of the current row
+        fingerprint      piece    - Fingerprint of the current piece of a row
+        symbol           *tail    - The last log_2(m) characters of the pattern
+        symbol           *sigma   - The alphabet
+        int              s_sigma  - The size of the alphabet
+        int              n        - The length of the text
+        int              alpha    - The level of accuracy desired
+*/
+typedef struct {
+    exactmatch_state state;
+    kmp_builder prefix;
+    symbol *head, *tail, *sigma;
+    int head_len, m_f, index, stage, row, row_end, s_sigma, n, alpha;
+    fingerprint piece;
+} exactmatch_builder;
+
+/*
+    exactmatch_builder_init
+    Starts constructing an exact matching algorithm for a pattern of known length.
+    Parameters:
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet
+        int    s_sigma - The size of the alphabet
+        int    n       - The length of the text
+        int    alpha   - The level of accuracy desired
+    Returns exactmatch_builder:
+        The builder, ready for exactmatch_builder_feed
+    Notes:
+        Memory held by the builder is O(log(m)) symbols and fingerprints, whatever the length of the pattern.
+*/
+exactmatch_builder exactmatch_builder_init(int m, symbol *sigma, int s_sigma, int n, int alpha) {
+    exactmatch_builder builder;
+    int f = 0, lm = 0;
+    builder.state.m = m - 1;
+    while ((1 << lm) <= m) lm++;
+    builder.state.lm = lm;
+    builder.m_f = m - lm;
+
+    builder.state.fmatch.lm = 0;
+    while ((1 << builder.state.fmatch.lm) <= builder.m_f) builder.state.fmatch.lm++;
+    while ((1 << f <= builder.state.fmatch.lm)) f++;
+    builder.state.fmatch.lm -= f + 1;
+    builder.head_len = (1 << f < builder.m_f) ? 1 << f : builder.m_f;
+
+    builder.head = calloc(builder.head_len, sizeof(symbol));
+    builder.tail = calloc(lm, sizeof(symbol));
+    builder.sigma = sigma;
+    builder.s_sigma = s_sigma;
+    builder.n = n;
+    builder.alpha = alpha;
+    builder.index = 0;
+    builder.stage = 0;
+    builder.piece = init_fingerprint();
+    return builder;
+}
+
+/*
+    exactmatch_builder_prefix
+    Finishes the KMP prefix and moves on to the rows of the fingerprint matching.
+    Parameters:
+        exactmatch_builder *builder - The builder
+*/
+void exactmatch_builder_prefix(exactmatch_builder *builder) {
+    fmatch_state *fmatch = &builder->state.fmatch;
+    fmatch->P_f = kmpbuilder_finish(&builder->prefix);
+    builder->stage = 2;
+    builder->row = 0;
+    if (fmatch->P_f.m >= builder->m_f) {
+        fmatch->periodic = 1;
+        builder->row_end = builder->m_f;
+        return;
+    }
+    fmatch_rows(fmatch, builder->m_f, builder->n, builder->alpha);
+    builder->row_end = fmatch->P_f.m + fmatch->P_i[0].row_size;
+}
+
+/*
+    exactmatch_builder_feed
+    Passes the next piece of the pattern to a builder.
+    Parameters:
+        exactmatch_builder *builder - The builder
+        symbol             *P       - The next piece of the pattern
+        int                l        - Length of the piece
+    Returns void:
+        Parameter builder modified by reference. P is not referenced after returning.
+    Notes:
+        Rows are fingerprinted a piece at a time with set_fingerprint and joined with fingerprint_concat.
+*/
+void exactmatch_builder_feed(exactmatch_builder *builder, symbol *P, int l) {
+    fmatch_state *fmatch = &builder->state.fmatch;
+    int k = 0, size;
+    while (k < l) {
+        if (builder->stage == 1) {
+            if (kmpbuilder_extend(&builder->prefix, P[k])) {
+                builder->index++;
+                k++;
+            } else exactmatch_builder_prefix(builder);
+        } else if ((builder->stage == 2) && (builder->index < builder->m_f)) {
+            size = builder->row_end - builder->index;
+            if (size > l - k) size = l - k;
+            set_fingerprint(fmatch->printer, &P[k], size, builder->piece);
+            fingerprint_concat(fmatch->printer, fmatch->P_i[builder->row].P, builder->piece, fmatch->tmp);
+            fingerprint_assign(fmatch->tmp, fmatch->P_i[builder->row].P);
+            builder->index += size;
+            k += size;
+            if ((builder->index == builder->row_end) && (builder->row + 1 < fmatch->lm)) builder->row_end += fmatch->P_i[++builder->row].row_size;
+        } else {
+            if (builder->index < builder->head_len) builder->head[builder->index] = P[k];
+            if (builder->index >= builder->m_f) builder->tail[builder->index - builder->m_f] = P[k];
+            builder->index++;
+            k++;
+            if (builder->index == builder->head_len) {
+                builder->prefix = kmpbuilder_init(builder->head, builder->head_len, builder->m_f, builder->sigma, builder->s_sigma);
+                builder->stage = 1;
+            }
+        }
+    }
+}
+
+/*
+    exactmatch_builder_finish
+    Completes the construction of an exact matching algorithm.
+    Parameters:
+        exactmatch_builder *builder - The builder, after the whole pattern has been fed. Freed
+    Returns exactmatch_state:
+        The initial state for the algorithm, identical to exactmatch_build on the whole pattern.
+*/
+exactmatch_state exactmatch_builder_finish(exactmatch_builder *builder) {
+    int i;
+    if ((builder->stage == 0) && (builder->m_f == 0)) {
+        fmatch_empty(&builder->state.fmatch);
+        builder->stage = 2;
+    } else if (builder->stage == 0) {
+        builder->prefix = kmpbuilder_init(builder->head, builder->head_len, builder->m_f, builder->sigma, builder->s_sigma);
+        builder->stage = 1;
+    }
+    if (builder->stage == 1) exactmatch_builder_prefix(builder);
+    builder->state.kmp = kmp_build(builder->tail, builder->state.lm, builder->state.lm, builder->sigma, builder->s_sigma);
+    builder->state.buffer = malloc(builder->state.lm * sizeof(int));
+    for (i = 0; i < builder->state.lm; i++) builder->state.buffer[i] = -1;
+    builder->state.text_index = 0;
+    builder->state.fold = NULL;
+    free(builder->head);
+    free(builder->tail);
+    fingerprint_free(builder->piece);
+    return builder->state;
+}
+
+/*
+    exactmatch_build_stream
+    Constructs an exact matching algorithm from a pattern read in pieces, without holding the whole pattern in memory.
+    Parameters:
+        int    (*read_chunk)(symbol*, int, void*) - Fills a buffer with up to size characters of the pattern. Returns the number
+                                                    read, 0 at the end of the pattern
+        void   *data    - Passed through to read
+        int    m        - Length of the pattern
+        symbol *sigma   - The alphabet
+        int    s_sigma  - The size of the alphabet
+        int    n        - The length of the text
+        int    alpha    - The level of accuracy desired
+    Returns exactmatch_state:
+        The initial state for the algorithm. Reading stops after m characters.
+*/
+exactmatch_state exactmatch_build_stream(int (*read_chunk)(symbol *buffer, int size, void *data), void *data, int m, symbol *sigma, int s_sigma, int n, int alpha) {
+    PERF_BEGIN(start);
+    exactmatch_builder builder = exactmatch_builder_init(m, sigma, s_sigma, n, alpha);
+    symbol *buffer = malloc(EXACTMATCH_CHUNK * sizeof(symbol));
+    int read_len, fed = 0;
+    while (fed < m) {
+        read_len = read_chunk(buffer, (m - fed < EXACTMATCH_CHUNK) ? m - fed : EXACTMATCH_CHUNK, data);
+        if (read_len <= 0) break;
+        exactmatch_builder_feed(&builder, buffer, read_len);
+        fed += read_len;
+    }
+    free(buffer);
+    exactmatch_state state = exactmatch_builder_finish(&builder);
+    PERF_END(PERF_BUILD, start, m);
+    return state;
+}
+
+int fd_read(symbol *buffer, int size, void *data) {
+    int fd = *(int*)data;
+    size_t total = 0, bytes = size * sizeof(symbol);
+    ssize_t result;
+    while (total < bytes) {
+        result = read(fd, ((char*)buffer) + total, bytes - total);
+        if (result <= 0) break;
+        total += result;
+    }
+    return total / sizeof(symbol);
+}
+
+/*
+    exactmatch_build_fd
+    Constructs an exact matching algorithm from a pattern read from a file descriptor.
+    Parameters:
+        int    fd      - The file descriptor, holding the pattern as raw symbols
+        int    m       - Length of the pattern. If negative, taken from the size of fd if it is a regular file, and
+                         otherwise fd is read to its end, holding the whole pattern in memory
+        symbol *sigma  - The alphabet
+        int    s_sigma - The size of the alphabet
+        int    n       - The length of the text
+        int    alpha   - The level of accuracy desired
+    Returns exactmatch_state:
+        The initial state for the algorithm.
+*/
+exactmatch_state exactmatch_build_fd(int fd, int m, symbol *sigma, int s_sigma, int n, int alpha) {
+    if (m < 0) {
+        struct stat info;
+        if ((fstat(fd, &info) == -1) || (!S_ISREG(info.st_mode))) {
+            int size = EXACTMATCH_CHUNK, read_len;
+            symbol *P = malloc(size * sizeof(symbol));
+            m = 0;
+            while ((read_len = fd_read(&P[m], size - m, &fd)) > 0) {
+                m += read_len;
+                if (m == size) P = realloc(P, (size <<= 1) * sizeof(symbol));
+            }
+            exactmatch_state state = exactmatch_build(P, m, sigma, s_sigma, n, alpha);
+            free(P);
+            return state;
+        }
+        m = info.st_size / sizeof(symbol);
+    }
+    return exactmatch_build_stream(fd_read, &fd, m, sigma, s_sigma, n, alpha);
+}
+
+/*
+    exactmatch_step
+    Performs the next round of exact matching, reporting whether the fingerprint stage produced a result.
+    Parameters:
+        exactmatch_state *state    - The current state of the algorithm
+        symbol           T_i       - The next character of the text
+        int              *reported - Set to 1 if fmatch_stream returned a result, 0 otherwise
     Returns int:
-        i if there is a match at index T[i]
-        -1 otherwise
-        Parameter state modified by reference to the next state of the algorithm.
+        As exactmatch_stream.
 */
-int exactmatch_stream(exactmatch_state *state, char T_i) {
+int exactmatch_step(exactmatch_state *state, symbol T_i, int *reported) {
     int result = -1, kmp_result, fmatch_result, i = state->text_index;
+    PERF_BEGIN(start);
     kmp_result = kmp_stream(&state->kmp, T_i, i);
+    PERF_END(PERF_KMP_SUFFIX, start, 1);
     fmatch_result = fmatch_stream(&state->fmatch, T_i, i);
 
     if (i >= state->m) {
@@ -454,10 +970,341 @@ int exactmatch_stream(exactmatch_state *state, char T_i) {
     }
     if (fmatch_result != -1) state->buffer[fmatch_result % state->lm] = fmatch_result;
     state->text_index++;
+    *reported = (fmatch_result != -1);
 
     return result;
 }
 
+/*
+    exactmatch_stream
+    Performs the next round of exact matching.
+    Parameters:
+        exactmatch_state *state - The current state of the algorithm
+        symbol           T_i    - The next character of the text
+    Returns int:
+        i if there is a match at index T[i]
+        -1 otherwise
+        Parameter state modified by reference to the next state of the algorithm.
+*/
+int exactmatch_stream(exactmatch_state *state, symbol T_i) {
+    int reported;
+    if (state->fold) T_i = fold_symbol(state->fold, T_i);
+    return exactmatch_step(state, T_i, &reported);
+}
+
+/*
+    exactmatch_stream_block
+    Performs exact matching on the next block of the text.
+    Parameters:
+        exactmatch_state *state - The current state of the algorithm
+        symbol           *T     - The next block of the text
+        int              l      - Length of the block
+        match_sink       *sink  - Destination for the location of each match
+    Returns int:
+        Number of characters of T consumed. Less than l only if the sink reported it was full.
+        Parameter state modified by reference to the next state of the algorithm.
+    Notes:
+        Once the sink has room again, resume with the remaining characters of T.
+*/
+int exactmatch_stream_block(exactmatch_state *state, symbol *T, int l, match_sink *sink) {
+    int i, result;
+    if (matchsink_full(sink)) return 0;
+    PERF_BEGIN(start);
+    for (i = 0; i < l; i++) {
+        result = exactmatch_stream(state, T[i]);
+        if ((result != -1) && (matchsink_emit(sink, result))) {
+            i++;
+            break;
+        }
+    }
+    PERF_END(PERF_BLOCK, start, i);
+    return i;
+}
+
+/*
+    exactmatch_steady
+    Checks whether the fingerprint stage of an algorithm holds no viable occurances.
+    Parameters:
+        fmatch_state *state - The fingerprint stage
+    Returns int:
+        1 if every row is empty
+        0 otherwise
+*/
+int exactmatch_steady(fmatch_state *state) {
+    int j;
+    if (state->periodic) return 1;
+    for (j = 0; j < state->lm; j++) if (state->P_i[j].count > 0) return 0;
+    return 1;
+}
+
+/*
+    exactmatch_snapshot
+    Records the positions held by an algorithm, relative to an offset.
+    Parameters:
+        exactmatch_state *state    - The algorithm
+        int              *snapshot - EXACTMATCH_SNAPSHOT ints to write
+        int              shift     - Subtracted from every location recorded
+    Returns int:
+        The number of ints written
+    Notes:
+        Holds the KMP indices and, for each row, its count, period and viable occurance locations, then the result
+        buffer. Within a run of one character every fingerprint is fixed by these, so two snapshots that agree once one
+        is shifted mean the algorithm is in the same state a shift apart.
+*/
+int exactmatch_snapshot(exactmatch_state *state, int *snapshot, int shift) {
+    fmatch_state *fmatch = &state->fmatch;
+    pattern_row *row;
+    int j, size = 0;
+    snapshot[size++] = state->kmp.i;
+    snapshot[size++] = fmatch->P_f.i;
+    if (!fmatch->periodic) {
+        for (j = 0; j < fmatch->lm; j++) {
+            row = &fmatch->P_i[j];
+            snapshot[size++] = row->count;
+            snapshot[size++] = row->period;
+            snapshot[size++] = (row->count > 0) ? row->VOs[0].location - shift : 0;
+            snapshot[size++] = (row->count > 1) ? row->VOs[1].location - shift : 0;
+        }
+    }
+    for (j = 0; j < state->lm; j++) snapshot[size++] = state->buffer[j] - shift;
+    return size;
+}
+
+/*
+    exactmatch_advance
+    Moves an algorithm forward through a run of one character without reading it.
+    Parameters:
+        exactmatch_state *state - The algorithm, in a state that repeats with period dividing delta within the run
+        symbol           c      - The character, already folded
+        int              delta  - Number of characters to skip, a multiple of the number of rows and of lm
+    Returns void:
+        Parameter state modified by reference to the state after c^delta.
+*/
+void exactmatch_advance(exactmatch_state *state, symbol c, int delta) {
+    fmatch_state *fmatch = &state->fmatch;
+    pattern_row *row;
+    int j, v;
+    if (!fmatch->periodic) {
+        set_fingerprint(fmatch->printer, &c, 1, fmatch->T_cur);
+        fingerprint_repeat(fmatch->printer, fmatch->T_cur, delta, fmatch->T_f);
+        for (j = 0; j < fmatch->lm; j++) {
+            fingerprint_concat(fmatch->printer, fmatch->past_prints[j], fmatch->T_f, fmatch->tmp);
+            fingerprint_assign(fmatch->tmp, fmatch->past_prints[j]);
+            row = &fmatch->P_i[j];
+            for (v = 0; (v < 2) && (v < row->count); v++) {
+                fingerprint_concat(fmatch->printer, row->VOs[v].T_f, fmatch->T_f, fmatch->tmp);
+                fingerprint_assign(fmatch->tmp, row->VOs[v].T_f);
+                row->VOs[v].location += delta;
+            }
+        }
+    }
+    for (j = 0; j < state->lm; j++) state->buffer[j] += delta;
+    state->text_index += delta;
+}
+
+/*
+    exactmatch_stream_run
+    Performs exact matching on a run of one character.
+    Parameters:
+        exactmatch_state *state - The current state of the algorithm
+        symbol           c      - The character
+        int              k      - Length of the run
+        match_sink       *sink  - Destination for the location of each match
+    Returns int:
+        Number of characters of the run consumed. Less than k only if the sink reported it was full.
+        Parameter state modified by reference to the state after c^k.
+    Notes:
+        Characters are streamed one at a time until both KMP stages are fixed on c, the rows hold no viable occurances and
+        no fingerprint result is pending. From then on nothing can change but the text index and the prefix fingerprints,
+        so the bulk of the run is skipped by extending every past print by the fingerprint of c^delta, built in
+        O(log(delta)) concatenations. The cost is O(m + log(k)) rather than O(k) unless the run holds matches.
+        A run of c matches at every location once the pattern c^m fits. Then, if the sink takes progressions or is never
+        full, the state is snapshotted and compared a cycle later, lcm(rows, lm) characters; if only the locations have
+        moved, the rest of the run is skipped as above, moving each viable occurance and buffered result along with it, and
+        its matches are passed on as one progression with matchsink_emit_progression. This is only tried when the period
+        of the KMP suffix is 1, as it must be for the pattern to end in a run.
+*/
+int exactmatch_stream_run(exactmatch_state *state, symbol c, int k, match_sink *sink) {
+    fmatch_state *fmatch = &state->fmatch;
+    int i, j, result, reported, delta, fmatch_i, kmp_i, quiet = 0, skipped = 0, since = -1, taken;
+    int warm = state->m + 1 + (state->lm << 1) + ((fmatch->periodic) ? 0 : fmatch->lm);
+    int rows = (fmatch->periodic) ? 1 : fmatch->lm, cycle = rows;
+    int progress = ((sink->progression) || (!sink->full)) && (state->kmp.period_len == 1);
+    int snapshot[EXACTMATCH_SNAPSHOT], current[EXACTMATCH_SNAPSHOT];
+    while (cycle % state->lm) cycle += rows;
+    if (matchsink_full(sink)) return 0;
+    if (state->fold) c = fold_symbol(state->fold, c);
+    for (i = 0; i < k; i++) {
+        fmatch_i = fmatch->P_f.i;
+        kmp_i = state->kmp.i;
+        result = exactmatch_step(state, c, &reported);
+        quiet = (reported) ? 0 : quiet + 1;
+        if ((result != -1) && (matchsink_emit(sink, result))) return i + 1;
+
+        if ((!skipped) && (i + 1 >= warm) && (quiet >= state->lm) && (fmatch->P_f.i == fmatch_i) && (state->kmp.i == kmp_i) && (exactmatch_steady(fmatch))) {
+            skipped = 1;
+            delta = ((k - i - 1) / rows) * rows;
+            if (delta == 0) continue;
+            if (!fmatch->periodic) {
+                set_fingerprint(fmatch->printer, &c, 1, fmatch->T_cur);
+                fingerprint_repeat(fmatch->printer, fmatch->T_cur, delta, fmatch->T_f);
+                for (j = 0; j < fmatch->lm; j++) {
+                    fingerprint_concat(fmatch->printer, fmatch->past_prints[j], fmatch->T_f, fmatch->tmp);
+                    fingerprint_assign(fmatch->tmp, fmatch->past_prints[j]);
+                }
+            }
+            state->text_index += delta;
+            i += delta;
+        }
+
+        if ((progress) && (!skipped) && (i + 1 >= warm)) {
+            if ((result == -1) || (fmatch->P_f.i != fmatch_i) || (state->kmp.i != kmp_i)) since = -1;
+            else if (since == -1) {
+                exactmatch_snapshot(state, snapshot, 0);
+                since = 0;
+            } else if (++since == cycle) {
+                since = -1;
+                if (memcmp(snapshot, current, exactmatch_snapshot(state, current, cycle) * sizeof(int)) != 0) continue;
+                skipped = 1;
+                delta = ((k - i - 1) / cycle) * cycle;
+                if (delta == 0) continue;
+                result = state->text_index;
+                exactmatch_advance(state, c, delta);
+                i += delta;
+                if (matchsink_emit_progression(sink, result, 1, delta, &taken)) return i + 1;
+            }
+        }
+    }
+    return k;
+}
+
+/*
+    exactmatch_stream_rle
+    Performs exact matching on run-length encoded text.
+    Parameters:
+        exactmatch_state *state   - The current state of the algorithm
+        symbol           *values  - The character of each run
+        int              *lengths - The length of each run
+        int              runs     - Number of runs
+        match_sink       *sink    - Destination for the location of each match
+    Returns int:
+        Number of characters consumed. Less than the total length only if the sink reported it was full.
+        Parameter state modified by reference to the next state of the algorithm.
+*/
+int exactmatch_stream_rle(exactmatch_state *state, symbol *values, int *lengths, int runs, match_sink *sink) {
+    int i, consumed, total = 0;
+    for (i = 0; i < runs; i++) {
+        consumed = exactmatch_stream_run(state, values[i], lengths[i], sink);
+        total += consumed;
+        if (consumed < lengths[i]) break;
+    }
+    return total;
+}
+
+/*
+    exactmatch_cursor_size
+    Returns the number of bytes exactmatch_save writes.
+    Parameters:
+        exactmatch_state *state - The algorithm
+    Returns int:
+        The size of a cursor, a multiple of sizeof(mp_limb_t)
+    Notes:
+        A cursor holds only what changes as the text is read: the text index, the KMP indices, the result buffer and, for
+        each row, its viable occurances and past print. The pattern, the KMP tables and the fingerprinter stay in the state,
+        so one state can serve many texts by loading and saving their cursors around each block.
+*/
+int exactmatch_cursor_size(exactmatch_state *state) {
+    fmatch_state *fmatch = &state->fmatch;
+    int ints = 4 + state->lm, limbs = 0;
+    if (!fmatch->periodic) {
+        ints += fmatch->lm << 2;
+        limbs = 3 * fingerprint_limbs(fmatch->printer) * (fmatch->lm << 2);
+    }
+    return (limbs + (ints * sizeof(int) + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t)) * sizeof(mp_limb_t);
+}
+
+/*
+    exactmatch_save
+    Writes the position of an algorithm in its text to a cursor.
+    Parameters:
+        exactmatch_state *state  - The algorithm
+        void             *cursor - exactmatch_cursor_size(state) bytes, aligned for mp_limb_t
+    Returns void:
+        Parameter cursor modified by reference.
+*/
+void exactmatch_save(exactmatch_state *state, void *cursor) {
+    fmatch_state *fmatch = &state->fmatch;
+    mp_limb_t *limbs = cursor;
+    int i, *ints, step;
+    if (!fmatch->periodic) {
+        step = 3 * fingerprint_limbs(fmatch->printer);
+        for (i = 0; i < fmatch->lm; i++) {
+            fingerprint_save(fmatch->printer, fmatch->past_prints[i], limbs);
+            fingerprint_save(fmatch->printer, fmatch->P_i[i].period_f, &limbs[step]);
+            fingerprint_save(fmatch->printer, fmatch->P_i[i].VOs[0].T_f, &limbs[step << 1]);
+            fingerprint_save(fmatch->printer, fmatch->P_i[i].VOs[1].T_f, &limbs[3 * step]);
+            limbs += step << 2;
+        }
+    }
+    ints = (int*)limbs;
+    ints[0] = state->text_index;
+    ints[1] = state->kmp.i;
+    ints[2] = fmatch->P_f.i;
+    ints[3] = (fmatch->periodic) ? 0 : fmatch->row_index;
+    memcpy(&ints[4], state->buffer, state->lm * sizeof(int));
+    ints += 4 + state->lm;
+    if (!fmatch->periodic) {
+        for (i = 0; i < fmatch->lm; i++) {
+            ints[0] = fmatch->P_i[i].period;
+            ints[1] = fmatch->P_i[i].count;
+            ints[2] = fmatch->P_i[i].VOs[0].location;
+            ints[3] = fmatch->P_i[i].VOs[1].location;
+            ints += 4;
+        }
+    }
+}
+
+/*
+    exactmatch_load
+    Moves an algorithm to the position saved in a cursor.
+    Parameters:
+        exactmatch_state *state  - The algorithm, built from the same pattern and fingerprinter as the one saved
+        void             *cursor - A cursor written by exactmatch_save
+    Returns void:
+        Parameter state modified by reference to the saved position.
+*/
+void exactmatch_load(exactmatch_state *state, void *cursor) {
+    fmatch_state *fmatch = &state->fmatch;
+    mp_limb_t *limbs = cursor;
+    int i, *ints, step;
+    if (!fmatch->periodic) {
+        step = 3 * fingerprint_limbs(fmatch->printer);
+        for (i = 0; i < fmatch->lm; i++) {
+            fingerprint_load(fmatch->printer, limbs, fmatch->past_prints[i]);
+            fingerprint_load(fmatch->printer, &limbs[step], fmatch->P_i[i].period_f);
+            fingerprint_load(fmatch->printer, &limbs[step << 1], fmatch->P_i[i].VOs[0].T_f);
+            fingerprint_load(fmatch->printer, &limbs[3 * step], fmatch->P_i[i].VOs[1].T_f);
+            limbs += step << 2;
+        }
+    }
+    ints = (int*)limbs;
+    state->text_index = ints[0];
+    state->kmp.i = ints[1];
+    fmatch->P_f.i = ints[2];
+    if (!fmatch->periodic) fmatch->row_index = ints[3];
+    memcpy(state->buffer, &ints[4], state->lm * sizeof(int));
+    ints += 4 + state->lm;
+    if (!fmatch->periodic) {
+        for (i = 0; i < fmatch->lm; i++) {
+            fmatch->P_i[i].period = ints[0];
+            fmatch->P_i[i].count = ints[1];
+            fmatch->P_i[i].VOs[0].location = ints[2];
+            fmatch->P_i[i].VOs[1].location = ints[3];
+            ints += 4;
+        }
+    }
+}
+
 /*
     exactmatch_free
     Frees an exact matching state from memory.
@@ -468,6 +1315,7 @@ void exactmatch_free(exactmatch_state *state) {
     fmatch_free(&state->fmatch);
     kmp_free(&state->kmp);
     free(state->buffer);
+    free(state->fold);
 }
 
 #endif
@@ -0,0 +1,135 @@
+#include "fingerprint_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks queries on an index against a naive search, then times repeated queries on a larger text.
+    Usage: fingerprint_index [length] [block] [queries]
+*/
+
+#define INDEX_PATH "fingerprint_index.tmp"
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+    Writes an index of T in pieces of random length, as if it were streamed from disk, and opens it.
+*/
+fp_index write_index(symbol *T, int n, fingerprinter printer, int block) {
+    fpindex_writer writer = fpindex_writer_open(INDEX_PATH, printer, block);
+    int fed = 0, l;
+    while (fed < n) {
+        l = 1 + rand() % (3 * block + 10);
+        if (fed + l > n) l = n - fed;
+        fpindex_writer_feed(&writer, &T[fed], l);
+        fed += l;
+    }
+    assert(fpindex_writer_close(&writer));
+    return fpindex_open(INDEX_PATH);
+}
+
+void query_test(fp_index *index, symbol *T, int n, symbol *P, int m) {
+    int i, count = 0, *correct = malloc(n * sizeof(int)), *results = malloc(n * sizeof(int));
+    long candidates;
+    match_sink sink = matchsink_array(results);
+    for (i = m - 1; i < n; i++) if (memcmp(&T[i - m + 1], P, m * sizeof(symbol)) == 0) correct[count++] = i;
+    candidates = fpindex_query(index, T, P, m, &sink);
+    assert(sink.count == count);
+    for (i = 0; i < count; i++) assert(results[i] == correct[i]);
+    if (m >= 2 * index->header->block - 1) assert(candidates >= count);
+    else assert(candidates == 0);
+
+    if (count > 1) {
+        int location;
+        match_sink ring = matchsink_ring(2, NULL, NULL);
+        fpindex_query(index, T, P, m, &ring);
+        assert(ring.count == 2);
+        assert(ringsink_pop(&ring, &location) && (location == correct[0]));
+        assert(ringsink_pop(&ring, &location) && (location == correct[1]));
+        matchsink_free(&ring);
+    }
+    free(correct);
+    free(results);
+}
+
+void index_test(int block, int periodic) {
+    int n = 30000, i, lengths[5] = {2 * block - 1, 2 * block + 7, 5 * block, 300, 12};
+    symbol sigma[2] = {'a', 'b'}, *T = malloc(n * sizeof(symbol)), *P = malloc(n * sizeof(symbol));
+    fingerprinter printer = fingerprinter_build(n, 0);
+    for (i = 0; i < n; i++) T[i] = (periodic) ? sigma[(i % 7) / 5] : sigma[rand() % 2];
+    if (periodic) for (i = 0; i < 20; i++) T[rand() % n] = 'b';
+    fp_index index = write_index(T, n, printer, block);
+    assert(index.map && (index.header->length == n) && (index.header->samples == n / block + 1));
+
+    for (i = 0; i < 5; i++) {
+        int m = lengths[i], start = rand() % (n - m), j;
+        memcpy(P, &T[start], m * sizeof(symbol));
+        for (j = rand() % 200; j + m < n; j += m + rand() % (10 * m)) memcpy(&T[j], P, m * sizeof(symbol));
+        fpindex_close(&index);
+        index = write_index(T, n, printer, block);
+        query_test(&index, T, n, P, m);
+        P[m / 2] = (P[m / 2] == 'a') ? 'b' : 'a';
+        query_test(&index, T, n, P, m);
+    }
+    fpindex_close(&index);
+    fingerprinter_free(printer);
+    free(T);
+    free(P);
+}
+
+/*
+    Indexes a random text, then compares queries on the index with memmem over the whole text.
+*/
+void query_benchmark(int n, int block, int queries) {
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, *T = malloc(n * sizeof(symbol)), **P = malloc(queries * sizeof(symbol*));
+    int i, j, m = 4 * block, *results = malloc(n / m * sizeof(int)), found = 0, scanned = 0;
+    long candidates = 0;
+    fingerprinter printer = fingerprinter_build(n, 0);
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 4];
+    for (j = 0; j < queries; j++) {
+        P[j] = malloc(m * sizeof(symbol));
+        for (i = 0; i < m; i++) P[j][i] = sigma[rand() % 4];
+        for (i = 0; i < 10; i++) memcpy(&T[rand() % (n - m)], P[j], m * sizeof(symbol));
+    }
+
+    double start = now();
+    fp_index index = write_index(T, n, printer, block);
+    double build = now() - start;
+    start = now();
+    for (j = 0; j < queries; j++) {
+        match_sink sink = matchsink_array(results);
+        candidates += fpindex_query(&index, T, P[j], m, &sink);
+        found += sink.count;
+    }
+    double query = now() - start;
+    start = now();
+    for (j = 0; j < queries; j++) for (i = 0; (i = memmem_next(T, n, P[j], m, i)) != -1; i++) scanned++;
+    double scan = now() - start;
+    assert(found == scanned);
+
+    printf("%d symbols, B = %d, m = %d: index %.1f MB (%.1f%% of the text), written in %.3f s\n", n, block, m, fpindex_size(&index) / 1e6, 100.0 * fpindex_size(&index) / (n * sizeof(symbol)), build);
+    printf("%d queries: %.3f ms each from the index (%.1f candidates), %.3f ms each with memmem, %d matches\n", queries, query * 1e3 / queries, (double)candidates / queries, scan * 1e3 / queries, found);
+    fpindex_close(&index);
+    fingerprinter_free(printer);
+    for (j = 0; j < queries; j++) free(P[j]);
+    free(P);
+    free(T);
+    free(results);
+}
+
+int main(int argc, char **argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1 << 24, block = (argc > 2) ? atoi(argv[2]) : 256, queries = (argc > 3) ? atoi(argv[3]) : 20;
+    srand(5);
+    index_test(1, 0);
+    index_test(16, 0);
+    index_test(64, 0);
+    index_test(16, 1);
+    query_benchmark(n, block, queries);
+    remove(INDEX_PATH);
+    return 0;
+}
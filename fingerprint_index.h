@@ -0,0 +1,391 @@
+/*
+    fingerprint_index.h
+    Persistent index of sampled prefix fingerprints of a stored text, for running many patterns over the same text.
+    The fingerprint of T[0, jB) is saved for every j under one fingerprinter, whose prime and random number are saved with
+    them. The index is written in one streaming pass and read back with mmap, so opening it costs nothing.
+    A pattern of length m >= 2B - 1 holds a whole sampled block at some offset o < B in every occurance. Its windows
+    P[o, o + B) are put in a table, each block of the text is looked up there, and each hit is checked by fingerprinting the
+    candidate from the samples and at most 2(B - 1) symbols of the text. Shorter patterns are searched for directly.
+    File layout, in limbs after the header:
+        fpindex_header - Sizes of the index
+        p, r           - The fingerprinter, limbs each
+        samples        - 3 * limbs per sample, as written by fingerprint_save
+*/
+
+#ifndef FINGERPRINT_INDEX
+#define FINGERPRINT_INDEX
+
+#include "planner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FPINDEX_MAGIC "FPINDEX1"
+
+/*
+    typedef struct fpindex_header
+    Structure at the start of an index file.
+    Components:
+        char magic[]      - FPINDEX_MAGIC
+        char backend[]    - KARP_RABIN_BACKEND of the writer, as the backends save fingerprints differently
+        int  symbol_width - SYMBOL_WIDTH of the writer
+        int  block        - Distance B between samples, in symbols
+        int  limbs        - Number of limbs of p
+        int  reserved     - Zero
+        long length       - Length of the text
+        long samples      - Number of samples, length / B + 1
+*/
+typedef struct {
+    char magic[8], backend[8];
+    int symbol_width, block, limbs, reserved;
+    long length, samples;
+} fpindex_header;
+
+/*
+    typedef struct fpindex_writer
+    Structure for writing an index while the text streams past.
+    Components:
+        FILE          *out     - The index file
+        fingerprinter printer  - The printer, owned by the caller
+        int           block    - Distance between samples
+        int           buffered - Number of symbols of the current block held in buffer
+        long          length   - Number of symbols fed so far
+        long          samples  - Number of samples written so far
+        symbol        *buffer  - The current partial block
+        fingerprint   prefix   - Fingerprint of the text up to the last sample
+        fingerprint   chunk    - Fingerprint of the last block
+        fingerprint   tmp      - Scratch fingerprint
+        mp_limb_t     *saved   - Room for one saved sample
+*/
+typedef struct {
+    FILE *out;
+    fingerprinter printer;
+    int block, buffered;
+    long length, samples;
+    symbol *buffer;
+    fingerprint prefix, chunk, tmp;
+    mp_limb_t *saved;
+} fpindex_writer;
+
+/*
+    typedef struct fp_index
+    Structure for an open index.
+    Components:
+        fpindex_header *header    - The header, in the mapping
+        mp_limb_t      *samples   - The samples, in the mapping
+        fingerprinter  printer    - The printer the index was written with
+        void           *map       - The mapping, NULL if the index could not be opened
+        size_t         map_size   - Size of the mapping in bytes
+*/
+typedef struct {
+    fpindex_header *header;
+    mp_limb_t *samples;
+    fingerprinter printer;
+    void *map;
+    size_t map_size;
+} fp_index;
+
+/*
+    fpindex_writer_open
+    Starts writing an index.
+    Parameters:
+        char          *path    - Where to write the index
+        fingerprinter printer  - The printer to fingerprint with, which must outlive the writer
+        int           block    - Distance B between samples. Queries need m >= 2B - 1, and the index takes
+                                 3 * limbs / B limbs per symbol
+    Returns fpindex_writer:
+        The writer, with out NULL if the file could not be created
+*/
+fpindex_writer fpindex_writer_open(char *path, fingerprinter printer, int block) {
+    fpindex_writer writer;
+    fpindex_header header;
+    int l = fingerprint_limbs(printer);
+    mp_limb_t *limbs = malloc(2 * l * sizeof(mp_limb_t));
+    writer.out = fopen(path, "wb");
+    writer.printer = printer;
+    writer.block = block;
+    writer.buffered = 0;
+    writer.length = 0;
+    writer.samples = 1;
+    writer.buffer = malloc(block * sizeof(symbol));
+    writer.prefix = init_fingerprint();
+    writer.chunk = init_fingerprint();
+    writer.tmp = init_fingerprint();
+    writer.saved = malloc(3 * l * sizeof(mp_limb_t));
+    if (!writer.out) {
+        printf("Warning: could not create index %s\n", path);
+        free(limbs);
+        return writer;
+    }
+
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, writer.out);
+    fingerprinter_save(printer, limbs);
+    fwrite(limbs, sizeof(mp_limb_t), 2 * l, writer.out);
+    fingerprint_save(printer, writer.prefix, writer.saved);
+    fwrite(writer.saved, sizeof(mp_limb_t), 3 * l, writer.out);
+    free(limbs);
+    return writer;
+}
+
+/*
+    fpindex_writer_sample
+    Extends the prefix by a whole block and writes the next sample.
+    Parameters:
+        fpindex_writer *writer - The writer
+        symbol         *T      - The block, of length writer->block
+*/
+void fpindex_writer_sample(fpindex_writer *writer, symbol *T) {
+    set_fingerprint(writer->printer, T, writer->block, writer->chunk);
+    fingerprint_concat(writer->printer, writer->prefix, writer->chunk, writer->tmp);
+    fingerprint_assign(writer->tmp, writer->prefix);
+    fingerprint_save(writer->printer, writer->prefix, writer->saved);
+    fwrite(writer->saved, sizeof(mp_limb_t), 3 * fingerprint_limbs(writer->printer), writer->out);
+    writer->samples++;
+}
+
+/*
+    fpindex_writer_feed
+    Adds the next part of the text to an index.
+    Parameters:
+        fpindex_writer *writer - The writer
+        symbol         *T      - The next part of the text
+        int            l       - Its length
+*/
+void fpindex_writer_feed(fpindex_writer *writer, symbol *T, int l) {
+    int i = 0, k, block = writer->block;
+    if (!writer->out) return;
+    writer->length += l;
+    if (writer->buffered > 0) {
+        k = (l < block - writer->buffered) ? l : block - writer->buffered;
+        memcpy(&writer->buffer[writer->buffered], T, k * sizeof(symbol));
+        writer->buffered += k;
+        i = k;
+        if (writer->buffered < block) return;
+        fpindex_writer_sample(writer, writer->buffer);
+        writer->buffered = 0;
+    }
+    for (; i + block <= l; i += block) fpindex_writer_sample(writer, &T[i]);
+    memcpy(writer->buffer, &T[i], (l - i) * sizeof(symbol));
+    writer->buffered = l - i;
+}
+
+/*
+    fpindex_writer_close
+    Finishes an index and frees the writer.
+    Parameters:
+        fpindex_writer *writer - The writer
+    Returns int:
+        1 if the index was written
+        0 otherwise
+*/
+int fpindex_writer_close(fpindex_writer *writer) {
+    fpindex_header header;
+    int written = 0;
+    if (writer->out) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FPINDEX_MAGIC, 8);
+        strncpy(header.backend, KARP_RABIN_BACKEND, 8);
+        header.symbol_width = SYMBOL_WIDTH;
+        header.block = writer->block;
+        header.limbs = fingerprint_limbs(writer->printer);
+        header.length = writer->length;
+        header.samples = writer->samples;
+        written = (fseek(writer->out, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, writer->out) == 1);
+        written = (fclose(writer->out) == 0) && written;
+    }
+    free(writer->buffer);
+    fingerprint_free(writer->prefix);
+    fingerprint_free(writer->chunk);
+    fingerprint_free(writer->tmp);
+    free(writer->saved);
+    return written;
+}
+
+/*
+    fpindex_open
+    Maps an index into memory.
+    Parameters:
+        char *path - The index file
+    Returns fp_index:
+        The index, with map NULL if the file is missing, truncated, or was written with another backend or symbol width
+*/
+fp_index fpindex_open(char *path) {
+    fp_index index = {NULL, NULL, NULL, NULL, 0};
+    struct stat st;
+    fpindex_header *header;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        printf("Warning: could not open index %s\n", path);
+        return index;
+    }
+    if ((fstat(fd, &st) == -1) || (st.st_size < (long)sizeof(fpindex_header))) {
+        printf("Warning: %s is not an index\n", path);
+        close(fd);
+        return index;
+    }
+    index.map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (index.map == MAP_FAILED) {
+        printf("Warning: could not map index %s\n", path);
+        index.map = NULL;
+        return index;
+    }
+    index.map_size = st.st_size;
+    header = index.map;
+    if ((memcmp(header->magic, FPINDEX_MAGIC, 8) != 0) || (strncmp(header->backend, KARP_RABIN_BACKEND, 8) != 0) ||
+        (header->symbol_width != SYMBOL_WIDTH) || (header->block < 1) || (header->limbs < 1) ||
+        (st.st_size != (long)(sizeof(fpindex_header) + (2 + 3 * header->samples) * header->limbs * sizeof(mp_limb_t)))) {
+        printf("Warning: %s is not an index for this build (%s backend, %d-bit symbols)\n", path, KARP_RABIN_BACKEND, SYMBOL_WIDTH);
+        munmap(index.map, index.map_size);
+        index.map = NULL;
+        return index;
+    }
+    index.header = header;
+    index.printer = fingerprinter_load((mp_limb_t*)(header + 1), header->limbs);
+    index.samples = (mp_limb_t*)(header + 1) + 2 * header->limbs;
+    return index;
+}
+
+/*
+    fpindex_size
+    Returns the number of bytes an index takes, mapped and on the heap.
+    Parameters:
+        fp_index *index - The index
+    Returns long:
+        The size of the index in bytes
+*/
+long fpindex_size(fp_index *index) {
+    return index->map_size + fingerprinter_size(index->printer) + sizeof(fp_index);
+}
+
+/*
+    fpindex_sample
+    Reads the fingerprint of T[0, jB).
+    Parameters:
+        fp_index    *index - The index
+        long        j      - The sample, 0 <= j < samples
+        fingerprint f      - The fingerprint to set
+*/
+void fpindex_sample(fp_index *index, long j, fingerprint f) {
+    fingerprint_load(index->printer, &index->samples[j * 3 * index->header->limbs], f);
+}
+
+/*
+    fpindex_query
+    Finds every occurance of a pattern in the indexed text.
+    Parameters:
+        fp_index   *index - The index
+        symbol     *T     - The text the index was written from, at least header->length symbols, e.g. mapped from disk
+        symbol     *P     - The pattern
+        int        m      - Length of the pattern
+        match_sink *sink  - Destination for the location of each match, in increasing order
+    Returns long:
+        Number of candidates checked by fingerprint. 0 if m < 2B - 1, in which case T was searched with memmem
+    Notes:
+        Reads n / B + 1 samples and, per candidate, at most 2(B - 1) symbols of T. Matches are only as certain as the
+        fingerprinter the index was written with; errors are one-sided, as with exactmatch_state.
+        Stops early if the sink reports it is full.
+        Positions in the text are longs, but sinks take int locations, so matches must end below INT_MAX.
+*/
+long fpindex_query(fp_index *index, symbol *T, symbol *P, int m, match_sink *sink) {
+    int B = index->header->block, o, i, size, hits;
+    long n = index->header->length, s, e, j, k, candidates = 0;
+    fingerprinter printer = index->printer;
+    if (matchsink_full(sink)) return 0;
+    if (m > n) return 0;
+    if (m < 2 * B - 1) {
+        for (s = 0; (s = memmem_next(T, n, P, m, s)) != -1; s++) if (matchsink_emit(sink, s + m - 1)) break;
+        return 0;
+    }
+
+    fingerprint P_f = init_fingerprint(), window = init_fingerprint(), c = init_fingerprint(), tmp = init_fingerprint();
+    fingerprint left = init_fingerprint(), right = init_fingerprint(), found = init_fingerprint();
+    for (size = 1; size < 2 * B; size <<= 1);
+    unsigned long *keys = malloc(size * sizeof(unsigned long));
+    int *offsets = malloc(size * sizeof(int)), *matched = malloc(B * sizeof(int));
+    for (i = 0; i < size; i++) offsets[i] = -1;
+
+    set_fingerprint(printer, P, B, window);
+    for (o = 0; o < B; o++) {
+        if (o > 0) {
+            set_fingerprint(printer, &P[o + B - 1], 1, c);
+            fingerprint_concat(printer, window, c, tmp);
+            set_fingerprint(printer, &P[o - 1], 1, c);
+            fingerprint_suffix(printer, tmp, c, window);
+        }
+        for (i = fingerprint_hash(window) & (size - 1); offsets[i] != -1; i = (i + 1) & (size - 1));
+        keys[i] = fingerprint_hash(window);
+        offsets[i] = o;
+    }
+    set_fingerprint(printer, P, m, P_f);
+
+    fpindex_sample(index, 0, right);
+    for (j = 0; j + 1 < index->header->samples; j++) {
+        fingerprint_assign(right, left);
+        fpindex_sample(index, j + 1, right);
+        if (j * B - (B - 1) + m > n) break;
+        fingerprint_suffix(printer, right, left, window);
+        unsigned long key = fingerprint_hash(window);
+        for (hits = 0, i = key & (size - 1); offsets[i] != -1; i = (i + 1) & (size - 1)) {
+            if (keys[i] != key) continue;
+            for (o = hits++; (o > 0) && (matched[o - 1] < offsets[i]); o--) matched[o] = matched[o - 1];
+            matched[o] = offsets[i];
+        }
+
+        for (i = 0; i < hits; i++) {
+            s = j * B - matched[i];
+            e = s + m;
+            if ((s < 0) || (e > n)) continue;
+            candidates++;
+            k = e / B;
+            fpindex_sample(index, k, tmp);
+            fingerprint_suffix(printer, tmp, left, found);
+            if (matched[i] > 0) {
+                set_fingerprint(printer, &T[s], matched[i], c);
+                fingerprint_concat(printer, c, found, tmp);
+                fingerprint_assign(tmp, found);
+            }
+            if (e > k * B) {
+                set_fingerprint(printer, &T[k * B], e - k * B, c);
+                fingerprint_concat(printer, found, c, tmp);
+                fingerprint_assign(tmp, found);
+            }
+            if (fingerprint_equals(found, P_f) && matchsink_emit(sink, e - 1)) {
+                j = index->header->samples;
+                break;
+            }
+        }
+    }
+
+    fingerprint_free(P_f);
+    fingerprint_free(window);
+    fingerprint_free(c);
+    fingerprint_free(tmp);
+    fingerprint_free(left);
+    fingerprint_free(right);
+    fingerprint_free(found);
+    free(keys);
+    free(offsets);
+    free(matched);
+    return candidates;
+}
+
+/*
+    fpindex_close
+    Unmaps an index.
+    Parameters:
+        fp_index *index - The index to close
+*/
+void fpindex_close(fp_index *index) {
+    if (!index->map) return;
+    munmap(index->map, index->map_size);
+    fingerprinter_free(index->printer);
+    index->map = NULL;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "flow_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks a flow table against one matcher per flow, then replays a synthetic packet trace through it.
+    Usage: flow_table [flows] [packets] [budget in MB]
+*/
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void interleave_test(symbol *P, int m, int num_flows, int length) {
+    symbol sigma[2] = {'a', 'b'}, **T = malloc(num_flows * sizeof(symbol*));
+    int i, j, l, *fed = calloc(num_flows, sizeof(int)), *expected = malloc(length * sizeof(int));
+    int **found = malloc(num_flows * sizeof(int*)), *num_found = calloc(num_flows, sizeof(int)), remaining = num_flows;
+    flow_table table = flowtable_build(P, m, sigma, 2, length, 0, 1L << 30);
+    for (j = 0; j < num_flows; j++) {
+        T[j] = malloc(length * sizeof(symbol));
+        found[j] = malloc(length * sizeof(int));
+        for (i = 0; i < length; i++) T[j][i] = sigma[rand() % 2];
+        for (i = rand() % 100; i + m < length; i += m + rand() % 300) memcpy(&T[j][i], P, m * sizeof(symbol));
+    }
+
+    while (remaining) {
+        j = rand() % num_flows;
+        if (fed[j] == length) continue;
+        l = 1 + rand() % 200;
+        if (fed[j] + l > length) l = length - fed[j];
+        match_sink sink = matchsink_array(&found[j][num_found[j]]);
+        assert(flowtable_stream(&table, 1000003UL * j, &T[j][fed[j]], l, &sink) == l);
+        num_found[j] += sink.count;
+        fed[j] += l;
+        if (fed[j] == length) {
+            remaining--;
+            if (j & 1) assert(flowtable_close(&table, 1000003UL * j));
+        }
+    }
+    assert(table.evictions == 0);
+    assert(table.flows == num_flows - num_flows / 2);
+
+    for (j = 0; j < num_flows; j++) {
+        exactmatch_state state = exactmatch_build(P, m, sigma, 2, length, 0);
+        match_sink sink = matchsink_array(expected);
+        exactmatch_stream_block(&state, T[j], length, &sink);
+        assert(sink.count == num_found[j]);
+        for (i = 0; i < sink.count; i++) assert(expected[i] == found[j][i]);
+        assert(verify_occurance(T[j], P, m, expected[0]));
+        exactmatch_free(&state);
+        free(T[j]);
+        free(found[j]);
+    }
+    flowtable_free(&table);
+    free(T);
+    free(found);
+    free(num_found);
+    free(fed);
+    free(expected);
+}
+
+void eviction_test(symbol *P, int m) {
+    symbol sigma[2] = {'a', 'b'};
+    int results[4];
+    flow_table table = flowtable_build(P, m, sigma, 2, 1000, 0, 1);
+    match_sink sink = matchsink_array(results);
+    assert(table.capacity == 1);
+
+    flowtable_stream(&table, 1, P, m / 2, &sink);
+    flowtable_stream(&table, 2, P, m - 1, &sink);
+    flowtable_stream(&table, 1, &P[m / 2], m - m / 2, &sink);
+    assert(sink.count == 0);
+    assert(table.evictions == 2);
+
+    flowtable_stream(&table, 1, P, m, &sink);
+    assert((sink.count == 1) && (results[0] == (m - m / 2) + m - 1));
+    assert(flowtable_close(&table, 1) && !flowtable_close(&table, 1));
+    flowtable_stream(&table, 2, P, m, &sink);
+    assert((sink.count == 2) && (results[1] == m - 1));
+    assert((table.evictions == 2) && (table.flows == 1));
+    flowtable_free(&table);
+}
+
+void replay_benchmark(int num_flows, int packets, long budget) {
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, P[64];
+    int i, payload_length = 1 << 20, *lengths = malloc(packets * sizeof(int)), *offsets = malloc(packets * sizeof(int));
+    int *results = malloc(1500 * sizeof(int));
+    unsigned long *ids = malloc(packets * sizeof(unsigned long));
+    symbol *payload = malloc(payload_length * sizeof(symbol));
+    long bytes = 0, matches = 0;
+    double u;
+    for (i = 0; i < 64; i++) P[i] = sigma[rand() % 4];
+    for (i = 0; i < payload_length; i++) payload[i] = sigma[rand() % 4];
+    for (i = rand() % 1000; i + 64 < payload_length; i += 64 + rand() % 20000) memcpy(&payload[i], P, 64 * sizeof(symbol));
+    for (i = 0; i < packets; i++) {
+        u = (double)rand() / RAND_MAX;
+        ids[i] = flow_hash((unsigned long)(u * u * num_flows));
+        lengths[i] = (rand() % 4) ? 64 + rand() % 512 : 1460;
+        offsets[i] = rand() % (payload_length - lengths[i]);
+        bytes += lengths[i];
+    }
+
+    flow_table table = flowtable_build(P, 64, sigma, 4, 1 << 30, 0, budget);
+    double start = now();
+    for (i = 0; i < packets; i++) {
+        match_sink sink = matchsink_array(results);
+        flowtable_stream(&table, ids[i], &payload[offsets[i]], lengths[i], &sink);
+        matches += sink.count;
+    }
+    double seconds = now() - start;
+    printf("%d flows, %d packets: %.1f kpackets/s, %.1f MB/s, %ld matches\n", num_flows, packets, packets / seconds / 1e3, bytes / seconds / 1e6, matches);
+    printf("cursor %d bytes (matcher %d bytes), %d live flows, %ld evictions, %.1f MB of %.1f MB budget\n", table.cursor_size, exactmatch_size(table.matcher), table.flows, table.evictions, flowtable_memory(&table) / 1e6, budget / 1e6);
+    flowtable_free(&table);
+    free(ids);
+    free(lengths);
+    free(offsets);
+    free(payload);
+    free(results);
+}
+
+int main(int argc, char **argv) {
+    int num_flows = (argc > 1) ? atoi(argv[1]) : 100000, packets = (argc > 2) ? atoi(argv[2]) : 20000;
+    long budget = ((argc > 3) ? atol(argv[3]) : 64) << 20;
+    symbol P[300];
+    int i;
+    srand(3);
+    for (i = 0; i < 300; i++) P[i] = 'a' + rand() % 2;
+    interleave_test(P, 40, 30, 5000);
+    interleave_test(P, 300, 10, 8000);
+    interleave_test(P, 5, 10, 2000);
+    for (i = 0; i < 20; i++) P[i] = 'a';
+    interleave_test(P, 20, 10, 2000);
+    for (i = 0; i < 300; i++) P[i] = 'a' + rand() % 2;
+    eviction_test(P, 30);
+    eviction_test(P, 100);
+    replay_benchmark(num_flows, packets, budget);
+    return 0;
+}
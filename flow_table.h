@@ -0,0 +1,298 @@
+/*
+    flow_table.h
+    Exact matching of one pattern across many concurrent streams, such as the flows of a packet capture, in bounded memory.
+    A single exactmatch_state holds the pattern, and each flow keeps only a cursor (see exactmatch_save) in a fixed-size slot.
+    Slots are carved from slabs allocated on demand and found by an open-addressing table keyed by flow id. Once the memory
+    budget is spent, the least recently fed flow is evicted and its matching restarts from scratch if it returns.
+*/
+
+#ifndef FLOW_TABLE
+#define FLOW_TABLE
+
+#include "exact_matching.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FLOW_SLAB_SLOTS 4096
+
+/*
+    typedef struct flow_slot
+    Header of a slot, followed in the slab by the flow's cursor.
+    Components:
+        unsigned long id   - The flow id
+        int           prev - Slot fed more recently, -1 if none. Unused while the slot is free
+        int           next - Slot fed less recently, -1 if none. Next free slot while the slot is free
+*/
+typedef struct {
+    unsigned long id;
+    int prev, next;
+} flow_slot;
+
+/*
+    typedef struct flow_table
+    Structure for the matchers of many flows.
+    Components:
+        exactmatch_state matcher     - The algorithm, loaded with the cursor of one flow at a time
+        int              loaded      - Slot whose cursor is in matcher, -1 if none
+        int              cursor_size - Size of a cursor in bytes
+        int              slot_size   - Size of a slot in bytes, header included
+        int              capacity    - Most slots the budget allows
+        int              used        - Slots handed out from the slabs so far
+        int              flows       - Number of live flows
+        int              head        - Most recently fed slot, -1 if none
+        int              tail        - Least recently fed slot, -1 if none
+        int              free_slots  - First slot freed by flowtable_close, -1 if none
+        int              table_mask  - Size of table - 1
+        int              *table      - Open-addressing table of slots, -1 if empty
+        char             **slabs     - Slabs of FLOW_SLAB_SLOTS slots, the last cut to capacity, allocated as needed
+        char             *initial    - Cursor of a flow that has seen no text
+        long             evictions   - Number of flows evicted to stay within budget
+*/
+typedef struct {
+    exactmatch_state matcher;
+    int loaded, cursor_size, slot_size, capacity, used, flows, head, tail, free_slots, table_mask, *table;
+    char **slabs, *initial;
+    long evictions;
+} flow_table;
+
+flow_slot *flowtable_slot(flow_table *table, int slot) {
+    return (flow_slot*)(table->slabs[slot / FLOW_SLAB_SLOTS] + (long)(slot % FLOW_SLAB_SLOTS) * table->slot_size);
+}
+
+void *flowtable_cursor(flow_table *table, int slot) {
+    return (char*)flowtable_slot(table, slot) + ((sizeof(flow_slot) + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t)) * sizeof(mp_limb_t);
+}
+
+long flowtable_slab_size(flow_table *table, int slab) {
+    int slots = table->capacity - slab * FLOW_SLAB_SLOTS;
+    return (long)((slots < FLOW_SLAB_SLOTS) ? slots : FLOW_SLAB_SLOTS) * table->slot_size;
+}
+
+unsigned long flow_hash(unsigned long id) {
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdUL;
+    id ^= id >> 33;
+    id *= 0xc4ceb9fe1a85ec53UL;
+    return id ^ (id >> 33);
+}
+
+/*
+    flowtable_build
+    Constructs a flow table.
+    Parameters:
+        symbol *P      - The pattern
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet
+        int    s_sigma - The size of the alphabet
+        int    n       - The longest any one flow may be
+        int    alpha   - The level of accuracy desired
+        long   budget  - Bytes to spend on flows
+    Returns flow_table:
+        A table with no flows
+    Notes:
+        The budget covers the slots and the table that finds them, not the pattern. At least one flow is always allowed.
+*/
+flow_table flowtable_build(symbol *P, int m, symbol *sigma, int s_sigma, int n, int alpha, long budget) {
+    flow_table table;
+    int i, size = 2;
+    table.matcher = exactmatch_build(P, m, sigma, s_sigma, n, alpha);
+    table.cursor_size = exactmatch_cursor_size(&table.matcher);
+    table.slot_size = ((sizeof(flow_slot) + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t)) * sizeof(mp_limb_t) + table.cursor_size;
+    table.initial = malloc(table.cursor_size);
+    exactmatch_save(&table.matcher, table.initial);
+    table.loaded = -1;
+
+    table.capacity = budget / (table.slot_size + (sizeof(int) << 2));
+    if (table.capacity < 1) table.capacity = 1;
+    while (size < table.capacity << 1) size <<= 1;
+    table.table_mask = size - 1;
+    table.table = malloc(size * sizeof(int));
+    for (i = 0; i < size; i++) table.table[i] = -1;
+    table.slabs = calloc((table.capacity + FLOW_SLAB_SLOTS - 1) / FLOW_SLAB_SLOTS, sizeof(char*));
+
+    table.used = 0;
+    table.flows = 0;
+    table.head = -1;
+    table.tail = -1;
+    table.free_slots = -1;
+    table.evictions = 0;
+    return table;
+}
+
+/*
+    flowtable_find
+    Looks up the position of a flow in the table.
+    Parameters:
+        flow_table    *table - The table
+        unsigned long id     - The flow id
+    Returns int:
+        Index of table holding the flow's slot, or of the empty entry where it would go
+*/
+int flowtable_find(flow_table *table, unsigned long id) {
+    int position = flow_hash(id) & table->table_mask;
+    while ((table->table[position] != -1) && (flowtable_slot(table, table->table[position])->id != id)) position = (position + 1) & table->table_mask;
+    return position;
+}
+
+void flowtable_unlink(flow_table *table, int slot) {
+    flow_slot *s = flowtable_slot(table, slot);
+    if (s->prev != -1) flowtable_slot(table, s->prev)->next = s->next;
+    else table->head = s->next;
+    if (s->next != -1) flowtable_slot(table, s->next)->prev = s->prev;
+    else table->tail = s->prev;
+}
+
+void flowtable_push(flow_table *table, int slot) {
+    flow_slot *s = flowtable_slot(table, slot);
+    s->prev = -1;
+    s->next = table->head;
+    if (table->head != -1) flowtable_slot(table, table->head)->prev = slot;
+    else table->tail = slot;
+    table->head = slot;
+}
+
+/*
+    flowtable_remove
+    Removes a slot from the table and the recency list.
+    Parameters:
+        flow_table *table    - The table
+        int        position  - Index of table holding the slot
+    Notes:
+        Entries after the hole are shifted back so that lookups never need tombstones.
+*/
+void flowtable_remove(flow_table *table, int position) {
+    int slot = table->table[position], next = position, home;
+    flowtable_unlink(table, slot);
+    if (table->loaded == slot) table->loaded = -1;
+    table->flows--;
+    while (1) {
+        table->table[position] = -1;
+        do {
+            next = (next + 1) & table->table_mask;
+            if (table->table[next] == -1) return;
+            home = flow_hash(flowtable_slot(table, table->table[next])->id) & table->table_mask;
+        } while (((next - home) & table->table_mask) < ((next - position) & table->table_mask));
+        table->table[position] = table->table[next];
+        position = next;
+    }
+}
+
+/*
+    flowtable_get
+    Finds the slot of a flow, starting the flow if it is new.
+    Parameters:
+        flow_table    *table - The table
+        unsigned long id     - The flow id
+    Returns int:
+        The flow's slot, now the most recently fed
+    Notes:
+        A new flow takes a slot freed by flowtable_close, then an unused slot within budget, and otherwise the slot of the
+        least recently fed flow, which is evicted.
+*/
+int flowtable_get(flow_table *table, unsigned long id) {
+    int position = flowtable_find(table, id), slot = table->table[position];
+    flow_slot *s;
+    if (slot != -1) {
+        if (table->head != slot) {
+            flowtable_unlink(table, slot);
+            flowtable_push(table, slot);
+        }
+        return slot;
+    }
+
+    if (table->free_slots != -1) {
+        slot = table->free_slots;
+        table->free_slots = flowtable_slot(table, slot)->next;
+    } else if (table->used < table->capacity) {
+        slot = table->used++;
+        if (!table->slabs[slot / FLOW_SLAB_SLOTS]) table->slabs[slot / FLOW_SLAB_SLOTS] = aligned_alloc(sizeof(mp_limb_t), flowtable_slab_size(table, slot / FLOW_SLAB_SLOTS));
+    } else {
+        slot = table->tail;
+        flowtable_remove(table, flowtable_find(table, flowtable_slot(table, slot)->id));
+        table->evictions++;
+        position = flowtable_find(table, id);
+    }
+
+    s = flowtable_slot(table, slot);
+    s->id = id;
+    memcpy(flowtable_cursor(table, slot), table->initial, table->cursor_size);
+    table->table[position] = slot;
+    flowtable_push(table, slot);
+    table->flows++;
+    return slot;
+}
+
+/*
+    flowtable_stream
+    Performs exact matching on the next packet of a flow.
+    Parameters:
+        flow_table    *table - The table
+        unsigned long id     - The flow id
+        symbol        *T     - The payload of the packet
+        int           l      - Length of the payload
+        match_sink    *sink  - Destination for the location of each match, counted from the start of the flow
+    Returns int:
+        Number of characters of T consumed. Less than l only if the sink reported it was full.
+    Notes:
+        The flow's cursor is loaded unless it is already in the matcher, and saved again after the block.
+*/
+int flowtable_stream(flow_table *table, unsigned long id, symbol *T, int l, match_sink *sink) {
+    int slot = flowtable_get(table, id), consumed;
+    void *cursor = flowtable_cursor(table, slot);
+    if (table->loaded != slot) exactmatch_load(&table->matcher, cursor);
+    table->loaded = slot;
+    consumed = exactmatch_stream_block(&table->matcher, T, l, sink);
+    exactmatch_save(&table->matcher, cursor);
+    return consumed;
+}
+
+/*
+    flowtable_close
+    Ends a flow, such as on a TCP FIN, freeing its slot for the next new flow.
+    Parameters:
+        flow_table    *table - The table
+        unsigned long id     - The flow id
+    Returns int:
+        1 if the flow was live
+        0 otherwise
+*/
+int flowtable_close(flow_table *table, unsigned long id) {
+    int position = flowtable_find(table, id), slot = table->table[position];
+    if (slot == -1) return 0;
+    flowtable_remove(table, position);
+    flowtable_slot(table, slot)->next = table->free_slots;
+    table->free_slots = slot;
+    return 1;
+}
+
+/*
+    flowtable_memory
+    Returns the memory a flow table has allocated.
+    Parameters:
+        flow_table *table - The table
+    Returns long:
+        Bytes allocated for slabs, the table, the initial cursor and the matcher
+*/
+long flowtable_memory(flow_table *table) {
+    long result = (table->table_mask + 1) * sizeof(int) + table->cursor_size + exactmatch_size(table->matcher);
+    int i;
+    for (i = 0; i < (table->used + FLOW_SLAB_SLOTS - 1) / FLOW_SLAB_SLOTS; i++) result += flowtable_slab_size(table, i);
+    return result;
+}
+
+/*
+    flowtable_free
+    Frees a flow table from memory.
+    Parameters:
+        flow_table *table - The table to free
+*/
+void flowtable_free(flow_table *table) {
+    int i;
+    for (i = 0; i < (table->capacity + FLOW_SLAB_SLOTS - 1) / FLOW_SLAB_SLOTS; i++) free(table->slabs[i]);
+    free(table->slabs);
+    free(table->table);
+    free(table->initial);
+    exactmatch_free(&table->matcher);
+}
+
+#endif
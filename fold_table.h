@@ -0,0 +1,89 @@
+/*
+    fold_table.h
+    Tables mapping each byte value to the symbol it should match as, for case-insensitive or byte-class matching.
+    Pass a table to exactmatch_build_fold and the pattern is folded once at build time and each character of the text as it
+    is streamed, so the text never needs a folded copy. A table has FOLD_SIZE entries. With wider symbols only values
+    below FOLD_SIZE are folded and the rest match as they are.
+*/
+
+#ifndef FOLD_TABLE
+#define FOLD_TABLE
+
+#include "symbol.h"
+
+#define FOLD_SIZE 256
+
+/*
+    foldtable_identity
+    Sets a table that folds nothing.
+    Parameters:
+        symbol *fold - FOLD_SIZE entries to set
+*/
+void foldtable_identity(symbol *fold) {
+    int i;
+    for (i = 0; i < FOLD_SIZE; i++) fold[i] = i;
+}
+
+/*
+    foldtable_case
+    Folds ASCII upper case letters to lower case in a table.
+    Parameters:
+        symbol *fold - The table to change
+*/
+void foldtable_case(symbol *fold) {
+    int i;
+    for (i = 'A'; i <= 'Z'; i++) fold[i] = fold[i - 'A' + 'a'];
+}
+
+/*
+    foldtable_class
+    Folds every member of a class of bytes to one symbol in a table, e.g. all whitespace to ' ' or all digits to '0'.
+    Parameters:
+        symbol *fold    - The table to change
+        char   *members - The bytes of the class, terminated by a zero byte
+        symbol to       - The symbol they all match as
+*/
+void foldtable_class(symbol *fold, char *members, symbol to) {
+    for (; *members; members++) fold[(unsigned char)*members] = to;
+}
+
+/*
+    fold_symbol
+    Folds one symbol.
+    Parameters:
+        symbol *fold - The table
+        symbol c     - The symbol
+    Returns symbol:
+        The symbol c matches as
+*/
+symbol fold_symbol(symbol *fold, symbol c) {
+#if SYMBOL_WIDTH == 8
+    return fold[(unsigned char)c];
+#else
+    return (c < FOLD_SIZE) ? fold[c] : c;
+#endif
+}
+
+/*
+    foldtable_alphabet
+    Folds an alphabet, dropping symbols that fold together.
+    Parameters:
+        symbol *fold    - The table
+        symbol *sigma   - The alphabet
+        int    s_sigma  - The size of the alphabet
+        symbol *folded  - s_sigma entries to set to the folded alphabet
+    Returns int:
+        The size of the folded alphabet
+*/
+int foldtable_alphabet(symbol *fold, symbol *sigma, int s_sigma, symbol *folded) {
+    int i, j, size = 0;
+    symbol c;
+    for (i = 0; i < s_sigma; i++) {
+        c = fold_symbol(fold, sigma[i]);
+        for (j = 0; (j < size) && (folded[j] != c); j++);
+        if (j == size) folded[size++] = c;
+    }
+    return size;
+}
+
+#endif
@@ -1,10 +1,123 @@
 #include "hash_lookup.h"
+#include "kmp.h"
+#include "microbench.h"
 #include <assert.h>
 
-int main(void) {
-    char **keys = malloc(10 * sizeof(char*));
+/*
+    Checks hash_lookup, then benchmarks it and the KMP stages built on it.
+    Usage: hash_lookup [--json] [--quick] [--reps N]
+*/
+
+/*
+    typedef struct lookup_bench
+    Operands for benchmarking hash_lookup.
+    Components:
+        symbol      **keys   - Pointers to the keys
+        int         *values  - The values
+        int         num      - Number of keys
+        hash_lookup lookup   - A dictionary of the keys
+        symbol      *queries - Keys to search for, half of them absent where the alphabet allows
+*/
+typedef struct {
+    symbol **keys, *queries;
+    int *values, num;
+    hash_lookup lookup;
+} lookup_bench;
+
+#define LOOKUP_QUERIES 1024
+
+void build_op(void *data, long count) {
+    lookup_bench *b = data;
+    hash_lookup lookup;
+    while (count--) {
+        lookup = hashlookup_build(b->keys, b->values, b->num);
+        hashlookup_free(&lookup);
+    }
+}
+
+void search_op(void *data, long count) {
+    lookup_bench *b = data;
+    volatile int sum = 0;
+    long i;
+    for (i = 0; i < count; i++) sum += hashlookup_search(b->lookup, b->queries[i & (LOOKUP_QUERIES - 1)]);
+}
+
+/*
+    Benchmarks building and searching a dictionary of num keys.
+*/
+void lookup_benchmark(microbench *bench, int num) {
+    lookup_bench b = {malloc(num * sizeof(symbol*)), malloc(LOOKUP_QUERIES * sizeof(symbol)), malloc(num * sizeof(int)), num};
     int i;
-    for (i = 0; i < 10; i++) keys[i] = malloc(sizeof(char));
+    for (i = 0; i < num; i++) {
+        b.keys[i] = malloc(sizeof(symbol));
+        b.keys[i][0] = (symbol)(i * 167);
+        b.values[i] = i;
+    }
+    for (i = 0; i < LOOKUP_QUERIES; i++) b.queries[i] = (i & 1) ? (symbol)(rand() % num * 167) : (symbol)rand();
+    b.lookup = hashlookup_build(b.keys, b.values, num);
+    microbench_run(bench, "cmph", "hashlookup_build", num, build_op, &b);
+    microbench_run(bench, "cmph", "hashlookup_search", num, search_op, &b);
+    hashlookup_free(&b.lookup);
+    for (i = 0; i < num; i++) free(b.keys[i]);
+    free(b.keys);
+    free(b.values);
+    free(b.queries);
+}
+
+/*
+    typedef struct kmp_bench
+    Operands for benchmarking KMP.
+    Components:
+        symbol    *P     - The pattern
+        int       m      - Length of the pattern
+        symbol    *T     - A text of KMP_TEXT characters
+        kmp_state state  - KMP for P
+*/
+typedef struct {
+    symbol *P, *T;
+    int m;
+    kmp_state state;
+} kmp_bench;
+
+#define KMP_TEXT 65536
+symbol kmp_sigma[4] = {'a', 'b', 'c', 'd'};
+
+void kmp_build_op(void *data, long count) {
+    kmp_bench *b = data;
+    kmp_state state;
+    while (count--) {
+        state = kmp_build(b->P, b->m, b->m, kmp_sigma, 4);
+        kmp_free(&state);
+    }
+}
+
+void kmp_stream_op(void *data, long count) {
+    kmp_bench *b = data;
+    volatile int found = 0;
+    long i;
+    for (i = 0; i < count; i++) found += (kmp_stream(&b->state, b->T[i & (KMP_TEXT - 1)], i) != -1);
+}
+
+/*
+    Benchmarks building KMP for a pattern of length m and streaming text through it. A periodic pattern repeats abca.
+*/
+void kmp_benchmark(microbench *bench, int m, int periodic) {
+    kmp_bench b = {malloc(m * sizeof(symbol)), malloc(KMP_TEXT * sizeof(symbol)), m};
+    int i;
+    for (i = 0; i < m; i++) b.P[i] = (periodic) ? "abca"[i & 3] : kmp_sigma[rand() % 4];
+    for (i = 0; i < KMP_TEXT; i++) b.T[i] = (periodic) ? "abca"[i & 3] : kmp_sigma[rand() % 4];
+    b.state = kmp_build(b.P, m, m, kmp_sigma, 4);
+    microbench_run(bench, "cmph", (periodic) ? "kmp_build/periodic" : "kmp_build", m, kmp_build_op, &b);
+    microbench_run(bench, "cmph", (periodic) ? "kmp_stream/periodic" : "kmp_stream", m, kmp_stream_op, &b);
+    kmp_free(&b.state);
+    free(b.P);
+    free(b.T);
+}
+
+void lookup_test() {
+    symbol **keys = malloc(10 * sizeof(symbol*));
+    int i;
+    for (i = 0; i < 10; i++) keys[i] = malloc(sizeof(symbol));
     keys[0][0] = 'a'; keys[1][0] = 'b'; keys[2][0] = 'X'; keys[3][0] = 'Y'; keys[4][0] = '0';
     keys[5][0] = '1'; keys[6][0] = '?'; keys[7][0] = '$'; keys[8][0] = '~'; keys[9][0] = '@';
 
@@ -40,5 +153,29 @@ int main(void) {
     assert(hashlookup_search(lookup, 'Z') == -1);
     hashlookup_free(&lookup);
 
+#if SYMBOL_WIDTH > 8
+    keys[0][0] = 0x161; keys[1][0] = 0x261; keys[2][0] = 0x61; keys[3][0] = 0xff61;
+    lookup = hashlookup_build(keys, values, 4);
+    for (i = 0; i < 4; i++) assert(hashlookup_search(lookup, keys[i][0]) == values[i]);
+    assert(hashlookup_search(lookup, 0x361) == -1);
+    hashlookup_free(&lookup);
+#endif
+
+    for (i = 0; i < 10; i++) free(keys[i]);
+    free(keys);
+    free(values);
+}
+
+int main(int argc, char **argv) {
+    microbench bench = microbench_init(argc, argv, "hash_lookup");
+    int nums[5] = {2, 4, 16, 64, 256}, lengths[3] = {16, 256, 4096}, i;
+    lookup_test();
+
+    srand(1);
+    for (i = 0; i < 5; i++) lookup_benchmark(&bench, nums[i]);
+    for (i = 0; i < 3; i++) {
+        kmp_benchmark(&bench, lengths[i], 0);
+        kmp_benchmark(&bench, lengths[i], 1);
+    }
     return 0;
 }
\ No newline at end of file
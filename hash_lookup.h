@@ -7,6 +7,7 @@
 #ifndef HASH_LOOKUP
 #define HASH_LOOKUP
 
+#include "symbol.h"
 #include <cmph.h>
 #include <stdlib.h>
 
@@ -16,56 +17,59 @@
     Components:
         cmph_t *hash   - The hash function
         int    *values - The values
-        char   *keys   - The keys
+        symbol *keys   - The keys
         int    num     - The number of items
 */
 typedef struct {
     cmph_t *hash;
     int *values, num;
-    char *keys;
+    symbol *keys;
 } hash_lookup;
 
 int hashlookup_size(hash_lookup lookup) {
-    int result = sizeof(int) + sizeof(cmph_t*) + sizeof(int*) + sizeof(char*);
-    if (lookup.num == 1) return result + sizeof(int) + sizeof(char);
-    else return result + (sizeof(int) + sizeof(char)) * lookup.num + (2.07 * lookup.num / 8);
+    int result = sizeof(int) + sizeof(cmph_t*) + sizeof(int*) + sizeof(symbol*);
+    if (lookup.num == 1) return result + sizeof(int) + sizeof(symbol);
+    else return result + (sizeof(int) + sizeof(symbol)) * lookup.num + (2.07 * lookup.num / 8);
 }
 
 /*
     hashlookup_build
     Constructs a hash_lookup object.
     Components:
-        char **keys - A list of the keys as strings 1 character long
-        int *values - A list of the values for each key
-        int num - The number of key-value pairs
+        symbol **keys - A list of pointers to the keys
+        int *values   - A list of the values for each key
+        int num       - The number of key-value pairs
     Returns hash_lookup:
         The constructed dictionary
+    Notes:
+        Keys are hashed as whole symbols of sizeof(symbol) bytes.
 */
-hash_lookup hashlookup_build(char **keys, int *values, int num) {
+hash_lookup hashlookup_build(symbol **keys, int *values, int num) {
     hash_lookup lookup;
     lookup.num = num;
 
     if (num > 1) {
-        cmph_io_adapter_t *source = cmph_io_vector_adapter(keys, num);
+        int i;
+        symbol *key_list = malloc(num * sizeof(symbol));
+        for (i = 0; i < num; i++) key_list[i] = keys[i][0];
+        cmph_io_adapter_t *source = cmph_io_struct_vector_adapter(key_list, sizeof(symbol), 0, sizeof(symbol), num);
         cmph_config_t *config = cmph_config_new(source);
         cmph_config_set_algo(config, CMPH_CHD);
         lookup.hash = cmph_new(config);
         cmph_config_destroy(config);
-        cmph_io_vector_adapter_destroy(source);
-        lookup.keys = malloc(num * sizeof(char));
+        cmph_io_struct_vector_adapter_destroy(source);
+        lookup.keys = malloc(num * sizeof(symbol));
         lookup.values = malloc(num * sizeof(int));
 
-        int i;
         unsigned int id;
-        char *key;
         for (i = 0; i < num; i++) {
-            key = keys[i];
-            id = cmph_search(lookup.hash, key, 1);
-            lookup.keys[id] = keys[i][0];
+            id = cmph_search(lookup.hash, (char*)&key_list[i], sizeof(symbol));
+            lookup.keys[id] = key_list[i];
             lookup.values[id] = values[i];
         }
+        free(key_list);
     } else if (num == 1) {
-        lookup.keys = malloc(sizeof(char));
+        lookup.keys = malloc(sizeof(symbol));
         lookup.keys[0] = keys[0][0];
         lookup.values = malloc(sizeof(int));
         lookup.values[0] = values[0];
@@ -79,15 +83,15 @@ hash_lookup hashlookup_build(char **keys, int *values, int num) {
     Searches the dictionary for the corresponding value to a key.
     Parameters:
         hash_lookup lookup - The dictionary to search
-        char        key    - The key to search for
+        symbol      key    - The key to search for
     Returns int:
         values[lookup.hash(key)] if key \in keys
         -1 otherwise
 */
-int hashlookup_search(hash_lookup lookup, char key) {
+int hashlookup_search(hash_lookup lookup, symbol key) {
     if (lookup.num == 0) return -1;
     if (lookup.num == 1) return (key == lookup.keys[0]) ? lookup.values[0] : -1;
-    int id = cmph_search(lookup.hash, &key, 1);
+    int id = cmph_search(lookup.hash, (char*)&key, sizeof(symbol));
     return ((id < lookup.num) && (key == lookup.keys[id])) ? lookup.values[id] : -1;
 }
 
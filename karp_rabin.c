@@ -1,29 +1,37 @@
 #include "karp_rabin.h"
+#include "microbench.h"
 #include <gmp.h>
 #include <stdio.h>
 #include <assert.h>
+#include <pthread.h>
 
-int main(void) {
-    int n = 100, m = 20;
-    fingerprinter printer = fingerprinter_build(n, 0);
-    gmp_printf("p = %Zd\n", printer->p);
-    gmp_printf("r = %Zd\n", printer->r);
+/*
+    Checks fingerprint arithmetic and the prime table, then benchmarks each fingerprint operation.
+    Usage: karp_rabin [--json] [--quick] [--reps N]
+*/
 
-    fingerprint print = init_fingerprint();
-    set_fingerprint(printer, "aaaaabbbbbcccccaaaaa", m, print);
+symbol *to_symbols(char *s, int l) {
+    symbol *result = malloc(l * sizeof(symbol));
+    int i;
+    for (i = 0; i < l; i++) result[i] = s[i];
+    return result;
+}
 
-    gmp_printf("uv finger = %Zd\n", print->finger);
-    gmp_printf("uv r_k = %Zd\n", print->r_k);
-    gmp_printf("uv r_mk = %Zd\n", print->r_mk);
+void fingerprint_test(unsigned int n, unsigned int alpha) {
+    int m = 20;
+    fingerprinter printer = fingerprinter_build(n, alpha);
+    symbol *T = to_symbols("aaaaabbbbbcccccaaaaa", m);
+    fingerprint print = init_fingerprint();
+    set_fingerprint(printer, T, m, print);
 
     fingerprint prefix = init_fingerprint();
-    set_fingerprint(printer, "aaaaa", 5, prefix);
+    set_fingerprint(printer, T, 5, prefix);
 
     fingerprint v = init_fingerprint();
     fingerprint_suffix(printer, print, prefix, v);
 
     fingerprint suffix = init_fingerprint();
-    set_fingerprint(printer, "bbbbbcccccaaaaa", 15, suffix);
+    set_fingerprint(printer, &T[5], 15, suffix);
     assert(fingerprint_equals(v, suffix));
 
     fingerprint u = init_fingerprint();
@@ -54,6 +62,256 @@ int main(void) {
     fingerprint_free(v);
     fingerprint_free(uv);
     fingerprint_free(empty);
+    fingerprinter_free(printer);
+    free(T);
+}
+
+/*
+    Checks every entry of prime_offsets against mpz_nextprime.
+*/
+void prime_test() {
+    mpz_t p, q;
+    unsigned int k;
+    mpz_init(p);
+    mpz_init(q);
+    for (k = 0; k < PRIME_OFFSETS; k++) {
+        prime_above_power(p, k);
+        mpz_set_ui(q, 0);
+        mpz_setbit(q, k);
+        mpz_nextprime(q, q);
+        assert(mpz_equals(p, q));
+    }
+    mpz_clear(p);
+    mpz_clear(q);
+}
+
+/*
+    Checks prefixes put together from blocks against set_fingerprint, for every symbol value a text can hold.
+*/
+void block_test(fingerprinter printer) {
+    int n = 300, i, k;
+    symbol *T = malloc(n * sizeof(symbol));
+    fingerprint expected = init_fingerprint(), print = init_fingerprint();
+    block_prefixes prefixes;
+    for (i = 0; i < n; i++) T[i] = (i < 256) ? (symbol)(i * 0x01010101U) : (symbol)((unsigned)rand() * 2654435761U);
+    assert(blockprefix_build(printer, T, &prefixes));
+    for (i = 0; i < n; i++) {
+        blockprefix_advance(&prefixes, i);
+        k = i + 1 - rand() % ((i < BLOCK_PRINT) ? i + 1 : BLOCK_PRINT);
+        set_fingerprint(printer, T, k, expected);
+        blockprefix_get(printer, &prefixes, k, print);
+        assert(fingerprint_equals(print, expected));
+        set_fingerprint(printer, T, i + 1, expected);
+        blockprefix_get(printer, &prefixes, i + 1, print);
+        assert(fingerprint_equals(print, expected));
+    }
+    fingerprint_free(expected);
+    fingerprint_free(print);
+    fingerprinter_free(printer);
+    free(T);
+}
+
+/*
+    Checks that symbols are fingerprinted by their unsigned value mod p, for chars of 128 or more and for wider symbols at
+    and above p, both by set_fingerprint and by fingerprint_set_symbol, and that fingerprints of such strings still split
+    and join.
+*/
+void symbol_test(fingerprinter printer) {
+    uint32_t p = mpz_get_ui(printer->p), values[13] = {0, 1, 126, 127, 128, 129, 132, 255, p - 1, p, p + 1, 2 * p + 3, UINT32_MAX - 7};
+    symbol T[13], c, d;
+    fingerprint print = init_fingerprint(), reduced = init_fingerprint(), u = init_fingerprint(), v = init_fingerprint(), uv = init_fingerprint();
+    int i, k;
+    for (i = 0; i < 13; i++) {
+        T[i] = c = (symbol)values[i];
+        d = (symbol)(symbol_value(c) % p);
+        set_fingerprint(printer, &c, 1, print);
+        set_fingerprint(printer, &d, 1, reduced);
+        assert(fingerprint_equals(print, reduced));
+        set_fingerprint(printer, T, 1, u);
+        fingerprint_set_symbol(printer, c, u);
+        assert(fingerprint_equals(u, print));
+    }
+    set_fingerprint(printer, T, 13, print);
+    for (k = 1; k < 13; k++) {
+        set_fingerprint(printer, T, k, u);
+        set_fingerprint(printer, &T[k], 13 - k, v);
+        fingerprint_concat(printer, u, v, uv);
+        assert(fingerprint_equals(uv, print));
+        fingerprint_suffix(printer, print, u, uv);
+        assert(fingerprint_equals(uv, v));
+    }
+    fingerprint_free(print);
+    fingerprint_free(reduced);
+    fingerprint_free(u);
+    fingerprint_free(v);
+    fingerprint_free(uv);
+    fingerprinter_free(printer);
+}
+
+/*
+    Builds fingerprinters from several threads at once, before anything else has seeded karp_rabin_random, recording
+    each r below 2^40, so that racing seeds or draws show up as repeated values, or as reports under -fsanitize=thread.
+*/
+#define THREAD_TEST_THREADS 8
+#define THREAD_TEST_BUILDS 200
+
+void *thread_test_run(void *arg) {
+    unsigned long *r = arg;
+    fingerprinter printer;
+    int i;
+    for (i = 0; i < THREAD_TEST_BUILDS; i++) {
+        printer = fingerprinter_build(1 << 20, 0);
+        assert(mpz_cmp(printer->r, printer->p) < 0);
+        r[i] = mpz_get_ui(printer->r);
+        fingerprinter_free(printer);
+    }
+    return NULL;
+}
+
+int compare_ul(const void *a, const void *b) {
+    unsigned long x = *(const unsigned long*)a, y = *(const unsigned long*)b;
+    return (x > y) - (x < y);
+}
+
+void thread_test() {
+    pthread_t threads[THREAD_TEST_THREADS];
+    unsigned long *r = malloc(THREAD_TEST_THREADS * THREAD_TEST_BUILDS * sizeof(unsigned long));
+    int t, i;
+    for (t = 0; t < THREAD_TEST_THREADS; t++) pthread_create(&threads[t], NULL, thread_test_run, &r[t * THREAD_TEST_BUILDS]);
+    for (t = 0; t < THREAD_TEST_THREADS; t++) pthread_join(threads[t], NULL);
+    qsort(r, THREAD_TEST_THREADS * THREAD_TEST_BUILDS, sizeof(unsigned long), compare_ul);
+    for (i = 1; i < THREAD_TEST_THREADS * THREAD_TEST_BUILDS; i++) assert(r[i] != r[i - 1]);
+    free(r);
+}
+
+/*
+    typedef struct fingerprint_bench
+    Operands for benchmarking the fingerprint operations.
+    Components:
+        fingerprinter printer - The printer in use
+        symbol        *T      - A random string
+        int           l       - Length of the string set_fingerprint hashes
+        fingerprint   u, v    - Fingerprints of T[0 .. 19] and T[20 .. 49]
+        fingerprint   uv      - Fingerprint of T[0 .. 49]
+        fingerprint   copy    - A second fingerprint of T[0 .. 49]
+        fingerprint   result  - Destination of every operation
+*/
+typedef struct {
+    fingerprinter printer;
+    symbol *T;
+    int l;
+    fingerprint u, v, uv, copy, result;
+} fingerprint_bench;
+
+void set_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    while (count--) set_fingerprint(b->printer, b->T, b->l, b->result);
+}
+
+void concat_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    while (count--) fingerprint_concat(b->printer, b->u, b->v, b->result);
+}
+
+void suffix_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    while (count--) fingerprint_suffix(b->printer, b->uv, b->u, b->result);
+}
+
+void prefix_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    while (count--) fingerprint_prefix(b->printer, b->uv, b->v, b->result);
+}
+
+void equals_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    volatile int equal = 0;
+    while (count--) equal += fingerprint_equals(b->uv, b->copy);
+    assert(equal > 0);
+}
+
+/*
+    Fingerprints every prefix of T one symbol at a time, as fingerprint_match did before block_prefixes.
+*/
+void symbol_prefixes_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    int i;
+    while (count--) {
+        set_fingerprint(b->printer, b->T, 1, b->result);
+        for (i = 1; i < b->l; i++) {
+            set_fingerprint(b->printer, &b->T[i], 1, b->v);
+            fingerprint_concat(b->printer, b->result, b->v, b->u);
+            fingerprint_assign(b->u, b->result);
+        }
+    }
+}
+
+void block_prefixes_op(void *data, long count) {
+    fingerprint_bench *b = data;
+    block_prefixes prefixes;
+    int i;
+    while (count--) {
+        blockprefix_build(b->printer, b->T, &prefixes);
+        for (i = 0; i < b->l; i++) blockprefix_advance(&prefixes, i);
+        blockprefix_get(b->printer, &prefixes, b->l, b->result);
+    }
+}
+
+/*
+    Benchmarks each fingerprint operation on one fingerprinter, named by the backend and the width of its prime.
+*/
+void fingerprint_benchmark(microbench *bench, fingerprinter printer) {
+    char backend[64];
+    int lengths[3] = {1, 64, 1024}, i;
+    block_prefixes prefixes;
+    fingerprint_bench b = {printer, malloc(1024 * sizeof(symbol)), 0, init_fingerprint(), init_fingerprint(), init_fingerprint(), init_fingerprint(), init_fingerprint()};
+    for (i = 0; i < 1024; i++) b.T[i] = 'a' + rand() % 26;
+    set_fingerprint(printer, b.T, 20, b.u);
+    set_fingerprint(printer, &b.T[20], 30, b.v);
+    set_fingerprint(printer, b.T, 50, b.uv);
+    set_fingerprint(printer, b.T, 50, b.copy);
+    snprintf(backend, sizeof(backend), "%s/%d-bit", KARP_RABIN_BACKEND, (int)mpz_sizeinbase(printer->p, 2));
+
+    for (i = 0; i < 3; i++) {
+        b.l = lengths[i];
+        microbench_run(bench, backend, "set_fingerprint", b.l, set_op, &b);
+    }
+    microbench_run(bench, backend, "fingerprint_concat", 50, concat_op, &b);
+    microbench_run(bench, backend, "fingerprint_suffix", 50, suffix_op, &b);
+    microbench_run(bench, backend, "fingerprint_prefix", 50, prefix_op, &b);
+    microbench_run(bench, backend, "fingerprint_equals", 50, equals_op, &b);
+    b.l = 1024;
+    microbench_run(bench, backend, "symbol_prefixes", b.l, symbol_prefixes_op, &b);
+    if (blockprefix_build(printer, b.T, &prefixes)) {
+        set_fingerprint(printer, b.T, b.l, b.copy);
+        microbench_run(bench, backend, "block_prefixes", b.l, block_prefixes_op, &b);
+        assert(fingerprint_equals(b.result, b.copy));
+    }
+
+    fingerprint_free(b.u);
+    fingerprint_free(b.v);
+    fingerprint_free(b.uv);
+    fingerprint_free(b.copy);
+    fingerprint_free(b.result);
+    free(b.T);
+    fingerprinter_free(printer);
+}
+
+int main(int argc, char **argv) {
+    microbench bench = microbench_init(argc, argv, "karp_rabin");
+    thread_test();
+    prime_test();
+    fingerprint_test(100, 0);
+    fingerprint_test(1U << 30, 4);
+    block_test(fingerprinter_build_word(1 << 20));
+    block_test(fingerprinter_build(1 << 10, 0));
+    symbol_test(fingerprinter_build(16, 0));
+    symbol_test(fingerprinter_build_word(1 << 20));
 
+    srand(1);
+    fingerprint_benchmark(&bench, fingerprinter_build_word(1 << 20));
+    fingerprint_benchmark(&bench, fingerprinter_build(1 << 20, 0));
+    fingerprint_benchmark(&bench, fingerprinter_build(1U << 31, 2));
+    fingerprint_benchmark(&bench, fingerprinter_build(1U << 30, 4));
     return 0;
-}
\ No newline at end of file
+}
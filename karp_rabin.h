@@ -1,16 +1,18 @@
 /*
     karp_rabin.h
     Library for Karp-Rabin fingerprints.
-    Utilises the GNU Multile Precision Arithmetic library (https://gmplib.org/) and dev/urandom.
+    Utilises the GNU Multile Precision Arithmetic library (https://gmplib.org/) and getrandom().
+    Compile with -DKARP_RABIN_FIXED for the fixed-limb Montgomery backend in karp_rabin_fixed.h.
 */
 
 #ifndef KARP_RABIN
 #define KARP_RABIN
 
+#include "symbol.h"
 #include <gmp.h>
-#include <fcntl.h>
-#include <unistd.h>
+#include <sys/random.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 /*
     mpz_equals
@@ -43,6 +45,120 @@ inline int compare(mpz_t x, mpz_t y) {
     else return mpn_cmp(x->_mp_d, y->_mp_d, x->_mp_size);
 }
 
+/*
+    prime_offsets
+    prime_offsets[k] = nextprime(2^k) - 2^k, for 0 <= k < PRIME_OFFSETS.
+*/
+#define PRIME_OFFSETS 257
+const unsigned short prime_offsets[PRIME_OFFSETS] = {
+    1, 1, 1, 3, 1, 5, 3, 3, 1, 9, 7, 5, 3, 17, 27, 3,
+    1, 29, 3, 21, 7, 17, 15, 9, 43, 35, 15, 29, 3, 11, 3, 11,
+    15, 17, 25, 53, 31, 9, 7, 23, 15, 27, 15, 29, 7, 59, 15, 5,
+    21, 69, 55, 21, 21, 5, 159, 3, 81, 9, 69, 131, 33, 15, 135, 29,
+    13, 131, 9, 3, 33, 29, 25, 11, 15, 29, 37, 33, 15, 11, 7, 23,
+    13, 17, 9, 75, 3, 171, 27, 39, 7, 29, 133, 59, 25, 105, 129, 9,
+    61, 105, 7, 255, 277, 81, 267, 81, 111, 39, 99, 39, 33, 147, 27, 51,
+    25, 281, 43, 71, 33, 29, 25, 9, 451, 41, 277, 165, 67, 27, 7, 29,
+    51, 17, 169, 39, 67, 27, 27, 33, 85, 155, 87, 155, 37, 5, 217, 5,
+    175, 27, 85, 51, 91, 69, 147, 45, 253, 95, 27, 15, 45, 69, 97, 299,
+    7, 107, 19, 21, 117, 141, 85, 83, 87, 147, 49, 129, 105, 77, 7, 9,
+    427, 75, 87, 309, 15, 165, 49, 215, 27, 159, 205, 303, 57, 35, 129, 5,
+    133, 65, 27, 35, 21, 107, 15, 101, 235, 351, 67, 15, 7, 581, 33, 203,
+    375, 47, 33, 71, 57, 75, 7, 251, 423, 129, 163, 185, 217, 81, 49, 189,
+    735, 119, 735, 483, 3, 249, 67, 105, 357, 431, 43, 81, 25, 249, 67, 29,
+    115, 261, 69, 59, 133, 315, 337, 63, 81, 119, 25, 65, 421, 39, 79, 95,
+    297
+};
+
+/*
+    prime_above_power
+    Finds the first prime above a power of two.
+    Parameters:
+        mpz_t        p    - The number to set
+        unsigned int bits - The exponent k
+    Returns void:
+        Parameter p modified by reference to the first prime above 2^k.
+    Notes:
+        Read from prime_offsets where possible. Larger exponents fall back to mpz_nextprime.
+*/
+void prime_above_power(mpz_t p, unsigned int bits) {
+    mpz_set_ui(p, 0);
+    mpz_setbit(p, bits);
+    if (bits < PRIME_OFFSETS) mpz_add_ui(p, p, prime_offsets[bits]);
+    else mpz_nextprime(p, p);
+}
+
+/*
+    bit_width
+    Number of bits needed to bound a problem size by a power of two.
+    Parameters:
+        unsigned int n - The problem size
+    Returns unsigned int:
+        The least b >= 1 such that n <= 2^b
+*/
+unsigned int bit_width(unsigned int n) {
+    unsigned int b = 1;
+    while ((b < 32) && ((1UL << b) < n)) b++;
+    return b;
+}
+
+/*
+    karp_rabin_random
+    Random state shared by every fingerprinter. Seeded with 256 bits from getrandom() on first use.
+    Notes:
+        Seeded once under karp_rabin_seeded and drawn from under karp_rabin_lock, so fingerprinters, and so matchers,
+        can be built from any number of threads at once.
+*/
+gmp_randstate_t karp_rabin_random;
+pthread_once_t karp_rabin_seeded = PTHREAD_ONCE_INIT;
+pthread_mutex_t karp_rabin_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+    karp_rabin_seed
+    Seeds karp_rabin_random. Run once, through pthread_once, by the first call to random_below.
+    Returns void:
+        karp_rabin_random initialised with a Mersenne Twister seeded from getrandom()
+*/
+void karp_rabin_seed(void) {
+    unsigned char seed_bytes[32];
+    size_t seed_len = 0;
+    ssize_t result;
+    mpz_t seed;
+    while (seed_len < sizeof seed_bytes) {
+        result = getrandom(seed_bytes + seed_len, (sizeof seed_bytes) - seed_len, 0);
+        if (result > 0) seed_len += result;
+    }
+    mpz_init(seed);
+    mpz_import(seed, sizeof seed_bytes, 1, 1, 0, 0, seed_bytes);
+    gmp_randinit_mt(karp_rabin_random);
+    gmp_randseed(karp_rabin_random, seed);
+    mpz_clear(seed);
+}
+
+/*
+    random_below
+    Chooses a random MP-Integer below a bound from the shared random state.
+    Parameters:
+        mpz_t r     - The number to set
+        mpz_t bound - Exclusive upper bound
+    Returns void:
+        Parameter r modified by reference such that 0 <= r < bound.
+    Notes:
+        Thread-safe. Concurrent calls wait for each other's draw, which is short next to building a matcher.
+*/
+void random_below(mpz_t r, mpz_t bound) {
+    pthread_once(&karp_rabin_seeded, karp_rabin_seed);
+    pthread_mutex_lock(&karp_rabin_lock);
+    mpz_urandomm(r, karp_rabin_random, bound);
+    pthread_mutex_unlock(&karp_rabin_lock);
+}
+
+#ifdef KARP_RABIN_FIXED
+#include "karp_rabin_fixed.h"
+#else
+
+#define KARP_RABIN_BACKEND "mpz"
+
 /*
     typedef struct fingerprinter_t *fingerprinter
     Structure to hold numbers for computing fingerprints.
@@ -58,6 +174,18 @@ int fingerprinter_size(fingerprinter printer) {
     return sizeof(mp_limb_t) * (printer->p->_mp_size + printer->r->_mp_size) + sizeof(mpz_t) * 2;
 }
 
+/*
+    fingerprinter_randomise
+    Chooses a new random r for a fingerprinter with its prime already set.
+    Parameters:
+        fingerprinter printer - The printer to change
+    Returns void:
+        Parameter printer modified by reference with r such that 0 <= r < p.
+*/
+void fingerprinter_randomise(fingerprinter printer) {
+    random_below(printer->r, printer->p);
+}
+
 /*
     fingerprinter_build
     Constructs a fingerprint for a problem size and accuracy.
@@ -67,30 +195,44 @@ int fingerprinter_size(fingerprinter printer) {
     Returns fingerprinter:
         The constructed fingerprint
     Notes:
-        Primality is tested using a probabilistic algorithm. For practical purposes it is adequate.
+        p is the first prime above 2^(b(2+alpha)), where n <= 2^b, read from prime_offsets rather than searched for.
         Chances of a collision are at most 1/n^(1+alpha).
 */
 fingerprinter fingerprinter_build(unsigned int n, unsigned int alpha) {
     fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
 
-    mpz_init_set_ui(printer->p, n);
-    mpz_pow_ui(printer->p, printer->p, 2 + alpha);
-    mpz_nextprime(printer->p, printer->p);
+    mpz_init(printer->p);
+    prime_above_power(printer->p, bit_width(n) * (2 + alpha));
 
-    gmp_randstate_t state;
-    unsigned long seed;
-    size_t seed_len = 0;
-    int f = open("/dev/urandom", O_RDONLY);
-    while (seed_len < sizeof seed) {
-        size_t result = read(f, ((char*)&seed) + seed_len, (sizeof seed) - seed_len);
-        seed_len += result;
-    }
-    close(f);
-    gmp_randinit_mt(state);
-    gmp_randseed_ui(state, seed);
+    mpz_init(printer->r);
+    fingerprinter_randomise(printer);
+
+    return printer;
+}
+
+/*
+    fingerprinter_build_word
+    Constructs a fingerprinter whose prime fits in a single machine word.
+    Parameters:
+        unsigned int n - Size of the text
+    Returns fingerprinter:
+        The constructed fingerprint
+    Notes:
+        p is the first prime above max(n, 2^31), so fingerprints fit in one limb and, for n < 2^32 - 4, products of two fit in 64 bits.
+        Chances of a collision are around 1/p per comparison, far weaker than fingerprinter_build.
+        Only intended for callers that verify matches against the text, such as fingerprint_match_verified.
+*/
+fingerprinter fingerprinter_build_word(unsigned int n) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+
+    mpz_init(printer->p);
+    if (n > (1U << 31)) {
+        mpz_set_ui(printer->p, n);
+        mpz_nextprime(printer->p, printer->p);
+    } else prime_above_power(printer->p, 31);
 
     mpz_init(printer->r);
-    mpz_urandomm(printer->r, state, printer->p);
+    fingerprinter_randomise(printer);
 
     return printer;
 }
@@ -107,6 +249,41 @@ void fingerprinter_free(fingerprinter printer) {
     free(printer);
 }
 
+/*
+    fingerprinter_save
+    Writes the prime and random number of a fingerprinter to flat memory.
+    Parameters:
+        fingerprinter printer - The printer to save
+        mp_limb_t     *limbs  - 2 * fingerprint_limbs(printer) limbs to write to
+    Returns void:
+        Parameter limbs modified by reference to p then r, each zero-padded to the width of p.
+*/
+void fingerprinter_save(fingerprinter printer, mp_limb_t *limbs) {
+    int i, l = mpz_size(printer->p);
+    for (i = 0; i < l; i++) {
+        limbs[i] = mpz_getlimbn(printer->p, i);
+        limbs[i + l] = mpz_getlimbn(printer->r, i);
+    }
+}
+
+/*
+    fingerprinter_load
+    Reconstructs a fingerprinter written by fingerprinter_save, so that fingerprints from another run can be compared.
+    Parameters:
+        mp_limb_t *limbs - The saved limbs
+        int       l      - The number of limbs of p
+    Returns fingerprinter:
+        The fingerprinter
+*/
+fingerprinter fingerprinter_load(mp_limb_t *limbs, int l) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+    mpz_init(printer->p);
+    mpz_import(printer->p, l, -1, sizeof(mp_limb_t), 0, 0, limbs);
+    mpz_init(printer->r);
+    mpz_import(printer->r, l, -1, sizeof(mp_limb_t), 0, 0, &limbs[l]);
+    return printer;
+}
+
 /*
     typedef struct fingerprint_t *fingerprint
     Structure to hold fingerprints.
@@ -143,21 +320,26 @@ fingerprint init_fingerprint() {
     Sets a fingerprint to a given string.
     Parameters:
         fingerprinter printer - The printer to use
-        char          *T      - The text string
+        symbol        *T      - The text string
         unsigned      int l   - The length of the string
         fingerprint   print   - The fingerprint to change
     Returns void:
         Parameter print modified by reference to new fingerprint.
+    Notes:
+        Each symbol is hashed as a whole, so wider symbols are never split into bytes.
+        Symbols are read by symbol_value and reduced mod p, which may be smaller than the largest symbol.
 */
-void set_fingerprint(fingerprinter printer, char *T, unsigned int l, fingerprint print) {
+void set_fingerprint(fingerprinter printer, symbol *T, unsigned int l, fingerprint print) {
     mpz_set_ui(print->r_k, 1);
     int i;
 
-    mpz_set_ui(print->finger, T[0]);
+    mpz_set_ui(print->finger, symbol_value(T[0]));
+    mpz_mod(print->finger, print->finger, printer->p);
 
     for (i = 1; i < l; i++) {
         mpz_mul(print->r_k, print->r_k, printer->r);
-        mpz_addmul_ui(print->finger, print->r_k, T[i]);
+        mpz_mod(print->r_k, print->r_k, printer->p);
+        mpz_addmul_ui(print->finger, print->r_k, symbol_value(T[i]));
         mpz_mod(print->finger, print->finger, printer->p);
     }
     mpz_mul(print->r_k, print->r_k, printer->r);
@@ -166,6 +348,22 @@ void set_fingerprint(fingerprinter printer, char *T, unsigned int l, fingerprint
     mpz_invert(print->r_mk, print->r_k, printer->p);
 }
 
+/*
+    fingerprint_set_symbol
+    Changes the symbol of a fingerprint of one symbol.
+    Parameters:
+        fingerprinter printer - The printer to use
+        symbol        T_i     - The new symbol
+        fingerprint   print   - A fingerprint set by set_fingerprint to a string of length 1
+    Returns void:
+        Parameter print modified by reference to the fingerprint of T_i. Powers of r are shared by every string of length
+        1 and are left as they are, so this costs no multiplications.
+*/
+void fingerprint_set_symbol(fingerprinter printer, symbol T_i, fingerprint print) {
+    mpz_set_ui(print->finger, symbol_value(T_i));
+    mpz_mod(print->finger, print->finger, printer->p);
+}
+
 /*
     fingerprint_assign
     Copies a value between fingerprints.
@@ -195,7 +393,8 @@ void fingerprint_assign(fingerprint from, fingerprint to) {
 void fingerprint_suffix(fingerprinter printer, fingerprint uv, fingerprint u, fingerprint v) {
     mpz_mul(v->r_k, uv->r_k, u->r_mk);
     mpz_mod(v->r_k, v->r_k, printer->p);
-    mpz_invert(v->r_mk, v->r_k, printer->p);
+    mpz_mul(v->r_mk, uv->r_mk, u->r_k);
+    mpz_mod(v->r_mk, v->r_mk, printer->p);
 
     mpz_sub(v->finger, uv->finger, u->finger);
     if (mpz_cmp_si(v->finger, 0) < 0) mpz_add(v->finger, v->finger, printer->p);
@@ -217,7 +416,8 @@ void fingerprint_suffix(fingerprinter printer, fingerprint uv, fingerprint u, fi
 void fingerprint_prefix(fingerprinter printer, fingerprint uv, fingerprint v, fingerprint u) {
     mpz_mul(u->r_k, uv->r_k, v->r_mk);
     mpz_mod(u->r_k, u->r_k, printer->p);
-    mpz_invert(u->r_mk, u->r_k, printer->p);
+    mpz_mul(u->r_mk, uv->r_mk, v->r_k);
+    mpz_mod(u->r_mk, u->r_mk, printer->p);
 
     mpz_mul(u->finger, v->finger, u->r_k);
     mpz_mod(u->finger, u->finger, printer->p);
@@ -239,7 +439,8 @@ void fingerprint_prefix(fingerprinter printer, fingerprint uv, fingerprint v, fi
 void fingerprint_concat(fingerprinter printer, fingerprint u, fingerprint v, fingerprint uv) {
     mpz_mul(uv->r_k, u->r_k, v->r_k);
     mpz_mod(uv->r_k, uv->r_k, printer->p);
-    mpz_invert(uv->r_mk, uv->r_k, printer->p);
+    mpz_mul(uv->r_mk, u->r_mk, v->r_mk);
+    mpz_mod(uv->r_mk, uv->r_mk, printer->p);
 
     mpz_mul(uv->finger, v->finger, u->r_k);
     mpz_mod(uv->finger, uv->finger, printer->p);
@@ -261,6 +462,87 @@ int fingerprint_equals(fingerprint T_f, fingerprint P_f) {
     return (mpz_equals(T_f->r_k, P_f->r_k) && mpz_equals(T_f->r_mk, P_f->r_mk) && mpz_equals(T_f->finger, P_f->finger));
 }
 
+/*
+    fingerprint_hash
+    Hashes a fingerprint for use as a table key.
+    Parameters:
+        fingerprint f - The fingerprint
+    Returns unsigned long:
+        The low limb of the fingerprint. Equal fingerprints have equal hashes.
+*/
+unsigned long fingerprint_hash(fingerprint f) {
+    return mpz_getlimbn(f->finger, 0);
+}
+
+/*
+    fingerprint_limbs
+    Returns the number of limbs fingerprint_save writes for each of the three values of a fingerprint.
+    Parameters:
+        fingerprinter printer - The printer in use
+    Returns int:
+        The number of limbs of p
+*/
+int fingerprint_limbs(fingerprinter printer) {
+    return mpz_size(printer->p);
+}
+
+/*
+    fingerprint_save
+    Writes a fingerprint to flat memory.
+    Parameters:
+        fingerprinter printer - The printer in use
+        fingerprint   f       - The fingerprint to save
+        mp_limb_t     *limbs  - 3 * fingerprint_limbs(printer) limbs to write to
+    Returns void:
+        Parameter limbs modified by reference to finger, r^k and r^-k, each zero-padded to the width of p.
+*/
+void fingerprint_save(fingerprinter printer, fingerprint f, mp_limb_t *limbs) {
+    int i, l = mpz_size(printer->p);
+    for (i = 0; i < l; i++) {
+        limbs[i] = mpz_getlimbn(f->finger, i);
+        limbs[i + l] = mpz_getlimbn(f->r_k, i);
+        limbs[i + (l << 1)] = mpz_getlimbn(f->r_mk, i);
+    }
+}
+
+/*
+    fingerprint_load
+    Reads a fingerprint written by fingerprint_save.
+    Parameters:
+        fingerprinter printer - The printer in use
+        mp_limb_t     *limbs  - The saved limbs
+        fingerprint   f       - The fingerprint to set
+    Returns void:
+        Parameter f modified by reference to the saved fingerprint.
+*/
+void fingerprint_load(fingerprinter printer, mp_limb_t *limbs, fingerprint f) {
+    int l = mpz_size(printer->p);
+    mpn_copyi(mpz_limbs_write(f->finger, l), limbs, l);
+    mpz_limbs_finish(f->finger, l);
+    mpn_copyi(mpz_limbs_write(f->r_k, l), &limbs[l], l);
+    mpz_limbs_finish(f->r_k, l);
+    mpn_copyi(mpz_limbs_write(f->r_mk, l), &limbs[l << 1], l);
+    mpz_limbs_finish(f->r_mk, l);
+}
+
+/*
+    fingerprint_set_words
+    Sets a fingerprint from values that each fit in a machine word, as a block_prefixes computes them.
+    Parameters:
+        fingerprinter printer - The printer in use, with p below 2^32
+        uint64_t      finger  - The fingerprint, below p
+        uint64_t      r_k     - r^k mod p
+        uint64_t      r_mk    - r^-k mod p
+        fingerprint   f       - The fingerprint to set
+    Returns void:
+        Parameter f modified by reference to the fingerprint.
+*/
+void fingerprint_set_words(fingerprinter printer, uint64_t finger, uint64_t r_k, uint64_t r_mk, fingerprint f) {
+    mpz_set_ui(f->finger, finger);
+    mpz_set_ui(f->r_k, r_k);
+    mpz_set_ui(f->r_mk, r_mk);
+}
+
 /*
     fingerprint_free
     Frees a fingerprint from memory.
@@ -275,3 +557,193 @@ void fingerprint_free(fingerprint finger) {
 }
 
 #endif
+
+/*
+    fingerprint_repeat
+    Fingerprints a string repeated k times, by repeated squaring.
+    Parameters:
+        fingerprinter printer - The printer to use
+        fingerprint   u       - The fingerprint of the string
+        unsigned int  k       - Number of repetitions
+        fingerprint   result  - The fingerprint to set
+    Returns void:
+        Parameter result modified by reference to the fingerprint of u^k, using O(log(k)) concatenations.
+*/
+void fingerprint_repeat(fingerprinter printer, fingerprint u, unsigned int k, fingerprint result) {
+    fingerprint power = init_fingerprint(), acc = init_fingerprint(), tmp = init_fingerprint();
+    fingerprint_assign(u, power);
+    while (k) {
+        if (k & 1) {
+            fingerprint_concat(printer, acc, power, tmp);
+            fingerprint_assign(tmp, acc);
+        }
+        k >>= 1;
+        if (k) {
+            fingerprint_concat(printer, power, power, tmp);
+            fingerprint_assign(tmp, power);
+        }
+    }
+    fingerprint_assign(acc, result);
+    fingerprint_free(power);
+    fingerprint_free(acc);
+    fingerprint_free(tmp);
+}
+
+#define BLOCK_PRINT 32
+
+/*
+    typedef struct block_printer
+    Powers of r for fingerprinting BLOCK_PRINT symbols at a time in plain machine words, when p is below 2^32.
+    Components:
+        uint64_t p       - Prime number
+        uint32_t power   - r^t mod p for 0 <= t <= BLOCK_PRINT
+        uint32_t inverse - r^-t mod p for 0 <= t <= BLOCK_PRINT
+    Notes:
+        Every product is of two values below 2^32, so the sums in blockprinter_sum are plain loops of 32-bit by 32-bit
+        multiplications that the compiler vectorises, with a single reduction mod p at the end.
+*/
+typedef struct {
+    uint64_t p;
+    uint32_t power[BLOCK_PRINT + 1], inverse[BLOCK_PRINT + 1];
+} block_printer;
+
+/*
+    blockprinter_build
+    Precomputes the powers of r for a fingerprinter whose prime fits in 32 bits.
+    Parameters:
+        fingerprinter printer - The printer to use
+        block_printer *block  - The block printer to set
+    Returns int:
+        1 if p is below 2^32 and block was set
+        0 otherwise
+*/
+int blockprinter_build(fingerprinter printer, block_printer *block) {
+    mpz_t inverse;
+    uint64_t r, r_inv;
+    int t;
+    if (mpz_sizeinbase(printer->p, 2) > 32) return 0;
+    mpz_init(inverse);
+    mpz_invert(inverse, printer->r, printer->p);
+    block->p = mpz_get_ui(printer->p);
+    r = mpz_get_ui(printer->r);
+    r_inv = mpz_get_ui(inverse);
+    mpz_clear(inverse);
+
+    block->power[0] = block->inverse[0] = 1;
+    for (t = 1; t <= BLOCK_PRINT; t++) {
+        block->power[t] = block->power[t - 1] * r % block->p;
+        block->inverse[t] = block->inverse[t - 1] * r_inv % block->p;
+    }
+    return 1;
+}
+
+/*
+    blockprinter_sum
+    Fingerprints a string of at most BLOCK_PRINT symbols.
+    Parameters:
+        block_printer *block - The block printer to use
+        symbol        *T     - The string
+        int           l      - The length of the string, at most BLOCK_PRINT
+    Returns uint64_t:
+        The sum of T[t] r^t mod p, reading each symbol as set_fingerprint does.
+    Notes:
+        Wider symbols are split into 16-bit halves so that 32 products still sum without overflow.
+*/
+uint64_t blockprinter_sum(block_printer *block, symbol *T, int l) {
+    uint64_t low = 0;
+    int t;
+#if SYMBOL_WIDTH == 8
+    for (t = 0; t < l; t++) low += (uint64_t)symbol_value(T[t]) * block->power[t];
+    return low % block->p;
+#else
+    uint64_t high = 0;
+    for (t = 0; t < l; t++) {
+        low += (uint64_t)(T[t] & 0xffff) * block->power[t];
+        high += (uint64_t)(T[t] >> 16) * block->power[t];
+    }
+    return (low % block->p + (high % block->p << 16)) % block->p;
+#endif
+}
+
+/*
+    typedef struct block_prefixes
+    Prefix fingerprints of a text held in memory, advanced a block of BLOCK_PRINT symbols at a time.
+    Components:
+        block_printer block  - Powers of r
+        symbol        *T     - The text
+        int           start  - Start of the current block
+        uint64_t      finger - Fingerprints of T[0, start - BLOCK_PRINT) and T[0, start)
+        uint64_t      r_k    - r^(start - BLOCK_PRINT) and r^start
+        uint64_t      r_mk   - r^-(start - BLOCK_PRINT) and r^-start
+    Notes:
+        Fingerprints of other prefixes are only put together when they are asked for, by blockprefix_get.
+*/
+typedef struct {
+    block_printer block;
+    symbol *T;
+    int start;
+    uint64_t finger[2], r_k[2], r_mk[2];
+} block_prefixes;
+
+/*
+    blockprefix_build
+    Starts the prefix fingerprints of a text.
+    Parameters:
+        fingerprinter  printer  - The printer to use
+        symbol         *T       - The text
+        block_prefixes *prefixes - The structure to set
+    Returns int:
+        1 if p is below 2^32 and prefixes was set
+        0 otherwise
+*/
+int blockprefix_build(fingerprinter printer, symbol *T, block_prefixes *prefixes) {
+    if (!blockprinter_build(printer, &prefixes->block)) return 0;
+    prefixes->T = T;
+    prefixes->start = 0;
+    prefixes->finger[0] = prefixes->finger[1] = 0;
+    prefixes->r_k[0] = prefixes->r_k[1] = 1;
+    prefixes->r_mk[0] = prefixes->r_mk[1] = 1;
+    return 1;
+}
+
+/*
+    blockprefix_advance
+    Moves the current block forward to the one holding a given index.
+    Parameters:
+        block_prefixes *prefixes - The prefixes to advance
+        int            i         - The index, never less than before
+    Returns void:
+        Parameter prefixes modified by reference, one multiplication by r^start per block passed.
+*/
+void blockprefix_advance(block_prefixes *prefixes, int i) {
+    block_printer *block = &prefixes->block;
+    while (i - prefixes->start >= BLOCK_PRINT) {
+        prefixes->finger[0] = prefixes->finger[1];
+        prefixes->r_k[0] = prefixes->r_k[1];
+        prefixes->r_mk[0] = prefixes->r_mk[1];
+        prefixes->finger[1] = (prefixes->finger[0] + prefixes->r_k[0] * blockprinter_sum(block, &prefixes->T[prefixes->start], BLOCK_PRINT)) % block->p;
+        prefixes->r_k[1] = prefixes->r_k[0] * block->power[BLOCK_PRINT] % block->p;
+        prefixes->r_mk[1] = prefixes->r_mk[0] * block->inverse[BLOCK_PRINT] % block->p;
+        prefixes->start += BLOCK_PRINT;
+    }
+}
+
+/*
+    blockprefix_get
+    Fingerprints a prefix of the text.
+    Parameters:
+        fingerprinter  printer   - The printer prefixes was built with
+        block_prefixes *prefixes - The prefixes
+        int            k         - The length of the prefix, with start - BLOCK_PRINT < k <= start + BLOCK_PRINT
+        fingerprint    f         - The fingerprint to set
+    Returns void:
+        Parameter f modified by reference to the fingerprint of T[0, k).
+*/
+void blockprefix_get(fingerprinter printer, block_prefixes *prefixes, int k, fingerprint f) {
+    block_printer *block = &prefixes->block;
+    int b = (k > prefixes->start), base = prefixes->start - ((b) ? 0 : BLOCK_PRINT);
+    fingerprint_set_words(printer, (prefixes->finger[b] + prefixes->r_k[b] * blockprinter_sum(block, &prefixes->T[base], k - base)) % block->p,
+        prefixes->r_k[b] * block->power[k - base] % block->p, prefixes->r_mk[b] * block->inverse[k - base] % block->p, f);
+}
+
+#endif
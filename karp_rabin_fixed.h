@@ -0,0 +1,594 @@
+/*
+    karp_rabin_fixed.h
+    Fixed-limb backend for Karp-Rabin fingerprints, selected by compiling with -DKARP_RABIN_FIXED.
+    Fingerprints are stored inline as arrays of FIXED_LIMBS limbs and multiplied with Montgomery reduction through the mpn
+    layer of GMP, so no operation allocates, divides or takes an inverse. The number of limbs used is chosen by
+    fingerprinter_build from the width of the prime, so the 1/n^(1+alpha) guarantee of karp_rabin.h is kept.
+    Only included from karp_rabin.h.
+*/
+
+#ifndef KARP_RABIN_FIXED_BACKEND
+#define KARP_RABIN_FIXED_BACKEND
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef FIXED_LIMBS
+#define FIXED_LIMBS 4
+#endif
+
+#define KARP_RABIN_BACKEND "fixed"
+
+/*
+    typedef struct fingerprinter_t *fingerprinter
+    Structure to hold numbers for computing fingerprints.
+    Components:
+        mpz_t     p        - Prime number, odd and below R = 2^(GMP_NUMB_BITS * limbs)
+        mpz_t     r        - Random number such that 1 <= r < p
+        int       limbs    - Number of limbs used for every value
+        mp_limb_t P        - p as limbs
+        mp_limb_t p_inv    - -p^-1 mod 2^GMP_NUMB_BITS
+        mp_limb_t R2       - R^2 mod p
+        mp_limb_t one      - R mod p, i.e. 1 in Montgomery form
+        mp_limb_t r_mont   - r in Montgomery form
+        mp_limb_t r_inv    - r^-1 in Montgomery form
+*/
+typedef struct fingerprinter_t {
+    mpz_t p, r;
+    int limbs;
+    mp_limb_t P[FIXED_LIMBS], p_inv, R2[FIXED_LIMBS], one[FIXED_LIMBS], r_mont[FIXED_LIMBS], r_inv[FIXED_LIMBS];
+} *fingerprinter;
+
+int fingerprinter_size(fingerprinter printer) {
+    return sizeof(mp_limb_t) * (printer->p->_mp_size + printer->r->_mp_size) + sizeof(struct fingerprinter_t);
+}
+
+/*
+    typedef struct fingerprint_t *fingerprint
+    Structure to hold fingerprints.
+    Components:
+        mp_limb_t finger - The fingerprint itself, in Montgomery form
+        mp_limb_t r_k    - r^k - 1 in Montgomery form, where k = ceiling(log_p(finger))
+        mp_limb_t r_mk   - r^-k - 1 in Montgomery form
+    Notes:
+        r^k and r^-k are offset by one so that a zeroed fingerprint is the empty string for every fingerprinter.
+        Every value is fully reduced and limbs past the fingerprinter's are always zero, so fingerprints compare limb by limb.
+*/
+typedef struct fingerprint_t {
+    mp_limb_t finger[FIXED_LIMBS], r_k[FIXED_LIMBS], r_mk[FIXED_LIMBS];
+} *fingerprint;
+
+int fingerprint_size(fingerprint f) {
+    return sizeof(struct fingerprint_t);
+}
+
+/*
+    fixed_redc
+    Montgomery reduction.
+    Parameters:
+        fingerprinter printer - The printer to use
+        mp_limb_t     *t      - 2 * limbs + 1 limbs holding a value below p * R, top limb zero. Overwritten
+        mp_limb_t     *result - The limbs to set
+    Returns void:
+        Parameter result modified by reference to t * R^-1 mod p.
+*/
+void fixed_redc(fingerprinter printer, mp_limb_t *t, mp_limb_t *result) {
+    int limbs = printer->limbs, i;
+    mp_limb_t carry;
+    for (i = 0; i < limbs; i++) {
+        carry = mpn_addmul_1(&t[i], printer->P, limbs, t[i] * printer->p_inv);
+        mpn_add_1(&t[i + limbs], &t[i + limbs], limbs + 1 - i, carry);
+    }
+    if ((t[2 * limbs]) || (mpn_cmp(&t[limbs], printer->P, limbs) >= 0)) mpn_sub_n(result, &t[limbs], printer->P, limbs);
+    else mpn_copyi(result, &t[limbs], limbs);
+}
+
+/*
+    fixed_mul
+    Montgomery multiplication.
+    Parameters:
+        fingerprinter printer - The printer to use
+        mp_limb_t     *a      - First factor, below p
+        mp_limb_t     *b      - Second factor, below p
+        mp_limb_t     *result - The limbs to set. May alias a or b
+    Returns void:
+        Parameter result modified by reference to a * b * R^-1 mod p.
+*/
+void fixed_mul(fingerprinter printer, mp_limb_t *a, mp_limb_t *b, mp_limb_t *result) {
+    mp_limb_t t[2 * FIXED_LIMBS + 1];
+    mpn_mul_n(t, a, b, printer->limbs);
+    t[2 * printer->limbs] = 0;
+    fixed_redc(printer, t, result);
+}
+
+/*
+    fixed_mul_ui
+    Montgomery multiplication by a single limb.
+    Parameters:
+        fingerprinter printer - The printer to use
+        mp_limb_t     *a      - First factor, below p
+        mp_limb_t     b       - Second factor
+        mp_limb_t     *result - The limbs to set. May alias a
+    Returns void:
+        Parameter result modified by reference to a * b * R^-1 mod p.
+*/
+void fixed_mul_ui(fingerprinter printer, mp_limb_t *a, mp_limb_t b, mp_limb_t *result) {
+    mp_limb_t t[2 * FIXED_LIMBS + 1];
+    int limbs = printer->limbs;
+    t[limbs] = mpn_mul_1(t, a, limbs, b);
+    mpn_zero(&t[limbs + 1], limbs);
+    fixed_redc(printer, t, result);
+}
+
+void fixed_add(fingerprinter printer, mp_limb_t *a, mp_limb_t *b, mp_limb_t *result) {
+    int limbs = printer->limbs;
+    if ((mpn_add_n(result, a, b, limbs)) || (mpn_cmp(result, printer->P, limbs) >= 0)) mpn_sub_n(result, result, printer->P, limbs);
+}
+
+void fixed_sub(fingerprinter printer, mp_limb_t *a, mp_limb_t *b, mp_limb_t *result) {
+    int limbs = printer->limbs;
+    if (mpn_sub_n(result, a, b, limbs)) mpn_add_n(result, result, printer->P, limbs);
+}
+
+/*
+    fixed_mul_unit
+    Multiplies two powers of r held offset by one.
+    Parameters:
+        fingerprinter printer - The printer to use
+        mp_limb_t     *a      - x - 1 in Montgomery form
+        mp_limb_t     *b      - y - 1 in Montgomery form
+        mp_limb_t     *result - The limbs to set. Must not alias a or b
+    Returns void:
+        Parameter result modified by reference to xy - 1 in Montgomery form, as xy - 1 = (x - 1)(y - 1) + (x - 1) + (y - 1).
+*/
+void fixed_mul_unit(fingerprinter printer, mp_limb_t *a, mp_limb_t *b, mp_limb_t *result) {
+    fixed_mul(printer, a, b, result);
+    fixed_add(printer, result, a, result);
+    fixed_add(printer, result, b, result);
+}
+
+/*
+    fixed_scale
+    Multiplies a fingerprint by a power of r held offset by one.
+    Parameters:
+        fingerprinter printer - The printer to use
+        mp_limb_t     *f      - f in Montgomery form
+        mp_limb_t     *e      - x - 1 in Montgomery form
+        mp_limb_t     *result - The limbs to set. Must not alias f or e
+    Returns void:
+        Parameter result modified by reference to fx in Montgomery form.
+*/
+void fixed_scale(fingerprinter printer, mp_limb_t *f, mp_limb_t *e, mp_limb_t *result) {
+    fixed_mul(printer, f, e, result);
+    fixed_add(printer, result, f, result);
+}
+
+/*
+    fixed_set_mpz
+    Converts a MP-Integer to Montgomery form.
+    Parameters:
+        fingerprinter printer - The printer to use
+        mpz_t         x       - The number to convert
+        mp_limb_t     *result - The limbs to set
+    Returns void:
+        Parameter result modified by reference to x * R mod p, zero padded to FIXED_LIMBS.
+*/
+void fixed_set_mpz(fingerprinter printer, mpz_t x, mp_limb_t *result) {
+    mpz_t tmp;
+    int i;
+    mpz_init_set(tmp, x);
+    mpz_mul_2exp(tmp, tmp, GMP_NUMB_BITS * printer->limbs);
+    mpz_mod(tmp, tmp, printer->p);
+    for (i = 0; i < FIXED_LIMBS; i++) result[i] = mpz_getlimbn(tmp, i);
+    mpz_clear(tmp);
+}
+
+/*
+    fingerprinter_powers
+    Sets up the Montgomery forms of r and r^-1.
+    Parameters:
+        fingerprinter printer - The printer to change, with p, its constants and r set
+    Returns void:
+        Parameter printer modified by reference with r_mont and r_inv.
+*/
+void fingerprinter_powers(fingerprinter printer) {
+    mpz_t inverse;
+    mpz_init(inverse);
+    mpz_invert(inverse, printer->r, printer->p);
+    fixed_set_mpz(printer, printer->r, printer->r_mont);
+    fixed_set_mpz(printer, inverse, printer->r_inv);
+    mpz_clear(inverse);
+}
+
+/*
+    fingerprinter_randomise
+    Chooses a new random r for a fingerprinter with its prime already set.
+    Parameters:
+        fingerprinter printer - The printer to change
+    Returns void:
+        Parameter printer modified by reference with r such that 1 <= r < p.
+*/
+void fingerprinter_randomise(fingerprinter printer) {
+    mpz_sub_ui(printer->r, printer->p, 1);
+    random_below(printer->r, printer->r);
+    mpz_add_ui(printer->r, printer->r, 1);
+    fingerprinter_powers(printer);
+}
+
+/*
+    fingerprinter_prime
+    Sets up the Montgomery constants of a fingerprinter for its prime.
+    Parameters:
+        fingerprinter printer - The printer to change, with p set
+    Returns void:
+        Parameter printer modified by reference with limbs, P, p_inv, R2 and one. r is left unset.
+*/
+void fingerprinter_prime(fingerprinter printer) {
+    mpz_t tmp;
+    mp_limb_t inverse;
+    int i;
+    printer->limbs = mpz_size(printer->p);
+    for (i = 0; i < FIXED_LIMBS; i++) printer->P[i] = mpz_getlimbn(printer->p, i);
+
+    inverse = printer->P[0];
+    for (i = 0; i < 6; i++) inverse *= 2 - printer->P[0] * inverse;
+    printer->p_inv = -inverse;
+
+    mpz_init_set_ui(tmp, 1);
+    fixed_set_mpz(printer, tmp, printer->one);
+    mpz_mul_2exp(tmp, tmp, GMP_NUMB_BITS * printer->limbs);
+    fixed_set_mpz(printer, tmp, printer->R2);
+    mpz_clear(tmp);
+}
+
+/*
+    fingerprinter_build
+    Constructs a fingerprint for a problem size and accuracy.
+    Parameters:
+        unsigned int n     - Size of the text
+        unsigned int alpha - Desired accuracy
+    Returns fingerprinter:
+        The constructed fingerprint
+    Notes:
+        p is the first prime above 2^(b(2+alpha)), where n <= 2^b, read from prime_offsets rather than searched for.
+        Chances of a collision are at most 1/n^(1+alpha).
+        If p does not fit in FIXED_LIMBS limbs, alpha is lowered until it does. Built with KARP_RABIN_VERBOSE, this is
+        reported on stderr.
+*/
+fingerprinter fingerprinter_build(unsigned int n, unsigned int alpha) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+
+    while ((alpha > 0) && (bit_width(n) * (2 + alpha) >= GMP_NUMB_BITS * FIXED_LIMBS)) {
+        alpha--;
+#ifdef KARP_RABIN_VERBOSE
+        fprintf(stderr, "Warning: n^(2+alpha) exceeds %d limbs, lowering alpha to %u\n", FIXED_LIMBS, alpha);
+#endif
+    }
+    mpz_init(printer->p);
+    prime_above_power(printer->p, bit_width(n) * (2 + alpha));
+
+    fingerprinter_prime(printer);
+    mpz_init(printer->r);
+    fingerprinter_randomise(printer);
+
+    return printer;
+}
+
+/*
+    fingerprinter_build_word
+    Constructs a fingerprinter whose prime fits in a single machine word.
+    Parameters:
+        unsigned int n - Size of the text
+    Returns fingerprinter:
+        The constructed fingerprint
+    Notes:
+        p is the first prime above max(n, 2^31), so every value is a single limb.
+        Chances of a collision are around 1/p per comparison, far weaker than fingerprinter_build.
+        Only intended for callers that verify matches against the text, such as fingerprint_match_verified.
+*/
+fingerprinter fingerprinter_build_word(unsigned int n) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+
+    mpz_init(printer->p);
+    if (n > (1U << 31)) {
+        mpz_set_ui(printer->p, n);
+        mpz_nextprime(printer->p, printer->p);
+    } else prime_above_power(printer->p, 31);
+
+    fingerprinter_prime(printer);
+    mpz_init(printer->r);
+    fingerprinter_randomise(printer);
+
+    return printer;
+}
+
+/*
+    fingerprinter_free
+    Frees a fingerprinter from memory.
+    Parameters:
+        fingerprinter printer - The fingerprinter to free
+*/
+void fingerprinter_free(fingerprinter printer) {
+    mpz_clear(printer->p);
+    mpz_clear(printer->r);
+    free(printer);
+}
+
+/*
+    fingerprinter_save
+    Writes the prime and random number of a fingerprinter to flat memory.
+    Parameters:
+        fingerprinter printer - The printer to save
+        mp_limb_t     *limbs  - 2 * fingerprint_limbs(printer) limbs to write to
+    Returns void:
+        Parameter limbs modified by reference to p then r, each zero-padded to the width of p.
+*/
+void fingerprinter_save(fingerprinter printer, mp_limb_t *limbs) {
+    int i, l = printer->limbs;
+    for (i = 0; i < l; i++) {
+        limbs[i] = mpz_getlimbn(printer->p, i);
+        limbs[i + l] = mpz_getlimbn(printer->r, i);
+    }
+}
+
+/*
+    fingerprinter_load
+    Reconstructs a fingerprinter written by fingerprinter_save, so that fingerprints from another run can be compared.
+    Parameters:
+        mp_limb_t *limbs - The saved limbs
+        int       l      - The number of limbs of p
+    Returns fingerprinter:
+        The fingerprinter
+*/
+fingerprinter fingerprinter_load(mp_limb_t *limbs, int l) {
+    fingerprinter printer = malloc(sizeof(struct fingerprinter_t));
+    mpz_init(printer->p);
+    mpz_import(printer->p, l, -1, sizeof(mp_limb_t), 0, 0, limbs);
+    fingerprinter_prime(printer);
+    mpz_init(printer->r);
+    mpz_import(printer->r, l, -1, sizeof(mp_limb_t), 0, 0, &limbs[l]);
+    fingerprinter_powers(printer);
+    return printer;
+}
+
+/*
+    init_fingerprint
+    Constructs an empty fingerprint.
+    Returns fingerprint:
+        finger = 0
+        r^k = r^mk = 1
+*/
+fingerprint init_fingerprint() {
+    return calloc(1, sizeof(struct fingerprint_t));
+}
+
+/*
+    set_fingerprint
+    Sets a fingerprint to a given string.
+    Parameters:
+        fingerprinter printer - The printer to use
+        symbol        *T      - The text string
+        unsigned      int l   - The length of the string
+        fingerprint   print   - The fingerprint to change
+    Returns void:
+        Parameter print modified by reference to new fingerprint.
+    Notes:
+        Each symbol is hashed as a whole, so wider symbols are never split into bytes.
+        r^i is kept as r^i * R^2 so that multiplying by a raw symbol lands in Montgomery form, two multiplications per symbol.
+*/
+void set_fingerprint(fingerprinter printer, symbol *T, unsigned int l, fingerprint print) {
+    mp_limb_t power[FIXED_LIMBS], term[FIXED_LIMBS], inverse[FIXED_LIMBS];
+    int i, limbs = printer->limbs;
+
+    mpn_copyi(power, printer->R2, limbs);
+    mpn_copyi(inverse, printer->one, limbs);
+    mpn_zero(print->finger, limbs);
+    for (i = 0; i < l; i++) {
+        fixed_mul_ui(printer, power, symbol_value(T[i]), term);
+        fixed_add(printer, print->finger, term, print->finger);
+        fixed_mul(printer, power, printer->r_mont, power);
+        fixed_mul(printer, inverse, printer->r_inv, inverse);
+    }
+    fixed_mul_ui(printer, power, 1, power);
+    fixed_sub(printer, power, printer->one, print->r_k);
+    fixed_sub(printer, inverse, printer->one, print->r_mk);
+}
+
+/*
+    fingerprint_set_symbol
+    Changes the symbol of a fingerprint of one symbol.
+    Parameters:
+        fingerprinter printer - The printer to use
+        symbol        T_i     - The new symbol
+        fingerprint   print   - A fingerprint set by set_fingerprint to a string of length 1
+    Returns void:
+        Parameter print modified by reference to the fingerprint of T_i. Powers of r are shared by every string of length
+        1 and are left as they are, so this costs one multiplication.
+*/
+void fingerprint_set_symbol(fingerprinter printer, symbol T_i, fingerprint print) {
+    fixed_mul_ui(printer, printer->R2, symbol_value(T_i), print->finger);
+}
+
+/*
+    fingerprint_assign
+    Copies a value between fingerprints.
+    Parameters:
+        fingerprint from - The fingerprint to copy from
+        fingerprint to   - The fingerprint to copy to
+    Returns void:
+        Parameter to modified by reference to copied fingerprint.
+*/
+void fingerprint_assign(fingerprint from, fingerprint to) {
+    *to = *from;
+}
+
+/*
+    fingerprint_suffix
+    Removes the prefix from a fingerprint.
+    Parameters:
+        fingerprinter printer - The printer to use
+        fingerprint uv        - The total fingerprint
+        fingerprint u         - The fingerprint prefix
+        fingerprint v         - The fingerprint suffix
+    Returns void:
+        Parameter v modified by reference to suffix.
+*/
+void fingerprint_suffix(fingerprinter printer, fingerprint uv, fingerprint u, fingerprint v) {
+    struct fingerprint_t result = {{0}};
+    mp_limb_t diff[FIXED_LIMBS];
+    fixed_mul_unit(printer, uv->r_k, u->r_mk, result.r_k);
+    fixed_mul_unit(printer, uv->r_mk, u->r_k, result.r_mk);
+    fixed_sub(printer, uv->finger, u->finger, diff);
+    fixed_scale(printer, diff, u->r_mk, result.finger);
+    *v = result;
+}
+
+/*
+    fingerprint_prefix
+    Removes the suffix from a fingerprint.
+    Parameters:
+        fingerprinter printer - The printer to use
+        fingerprint uv        - The total fingerprint
+        fingerprint v         - The fingerprint suffix
+        fingerprint u         - The fingerprint prefix
+    Returns void:
+        Parameter u modified by reference to prefix.
+*/
+void fingerprint_prefix(fingerprinter printer, fingerprint uv, fingerprint v, fingerprint u) {
+    struct fingerprint_t result = {{0}};
+    mp_limb_t shifted[FIXED_LIMBS];
+    fixed_mul_unit(printer, uv->r_k, v->r_mk, result.r_k);
+    fixed_mul_unit(printer, uv->r_mk, v->r_k, result.r_mk);
+    fixed_scale(printer, v->finger, result.r_k, shifted);
+    fixed_sub(printer, uv->finger, shifted, result.finger);
+    *u = result;
+}
+
+/*
+    fingerprint_concat
+    Concatenates two fingerprints together.
+    Parameters:
+        fingerprinter printer - The printer to use
+        fingerprint u         - The fingerprint prefix
+        fingerprint v         - The fingerprint suffix
+        fingerprint uv        - The total fingerprint
+    Returns void:
+        Parameter uv modified by reference to concatenation.
+*/
+void fingerprint_concat(fingerprinter printer, fingerprint u, fingerprint v, fingerprint uv) {
+    struct fingerprint_t result = {{0}};
+    mp_limb_t shifted[FIXED_LIMBS];
+    fixed_mul_unit(printer, u->r_k, v->r_k, result.r_k);
+    fixed_mul_unit(printer, u->r_mk, v->r_mk, result.r_mk);
+    fixed_scale(printer, v->finger, u->r_k, shifted);
+    fixed_add(printer, u->finger, shifted, result.finger);
+    *uv = result;
+}
+
+/*
+    fingerprint_equals
+    Checks if two fingerprints are equal.
+    Parameters:
+        fingerprint T_f - The first fingerprint
+        fingerprint P_f - The second fingerprint
+    Returns int:
+        1 if T_f = P_f
+        0 otherwise
+    Notes:
+        r^-k is determined by r^k, so only finger and r^k are compared.
+*/
+int fingerprint_equals(fingerprint T_f, fingerprint P_f) {
+    return (memcmp(T_f->finger, P_f->finger, sizeof(T_f->finger)) == 0) && (memcmp(T_f->r_k, P_f->r_k, sizeof(T_f->r_k)) == 0);
+}
+
+/*
+    fingerprint_hash
+    Hashes a fingerprint for use as a table key.
+    Parameters:
+        fingerprint f - The fingerprint
+    Returns unsigned long:
+        The low limb of the fingerprint. Equal fingerprints have equal hashes.
+*/
+unsigned long fingerprint_hash(fingerprint f) {
+    return f->finger[0];
+}
+
+/*
+    fingerprint_limbs
+    Returns the number of limbs fingerprint_save writes for each of the three values of a fingerprint.
+    Parameters:
+        fingerprinter printer - The printer in use
+    Returns int:
+        The number of limbs the printer uses
+*/
+int fingerprint_limbs(fingerprinter printer) {
+    return printer->limbs;
+}
+
+/*
+    fingerprint_save
+    Writes a fingerprint to flat memory.
+    Parameters:
+        fingerprinter printer - The printer in use
+        fingerprint   f       - The fingerprint to save
+        mp_limb_t     *limbs  - 3 * fingerprint_limbs(printer) limbs to write to
+    Returns void:
+        Parameter limbs modified by reference to finger, r^k - 1 and r^-k - 1, in Montgomery form.
+*/
+void fingerprint_save(fingerprinter printer, fingerprint f, mp_limb_t *limbs) {
+    int l = printer->limbs;
+    mpn_copyi(limbs, f->finger, l);
+    mpn_copyi(&limbs[l], f->r_k, l);
+    mpn_copyi(&limbs[l << 1], f->r_mk, l);
+}
+
+/*
+    fingerprint_load
+    Reads a fingerprint written by fingerprint_save.
+    Parameters:
+        fingerprinter printer - The printer in use
+        mp_limb_t     *limbs  - The saved limbs
+        fingerprint   f       - The fingerprint to set
+    Returns void:
+        Parameter f modified by reference to the saved fingerprint.
+    Notes:
+        Limbs past the printer's are zero in every fingerprint, so only the printer's limbs are copied.
+*/
+void fingerprint_load(fingerprinter printer, mp_limb_t *limbs, fingerprint f) {
+    int l = printer->limbs;
+    mpn_copyi(f->finger, limbs, l);
+    mpn_copyi(f->r_k, &limbs[l], l);
+    mpn_copyi(f->r_mk, &limbs[l << 1], l);
+}
+
+/*
+    fingerprint_set_words
+    Sets a fingerprint from values that each fit in a machine word, as a block_prefixes computes them.
+    Parameters:
+        fingerprinter printer - The printer in use, with p below 2^32
+        uint64_t      finger  - The fingerprint, below p
+        uint64_t      r_k     - r^k mod p
+        uint64_t      r_mk    - r^-k mod p
+        fingerprint   f       - The fingerprint to set
+    Returns void:
+        Parameter f modified by reference to the fingerprint, each value moved to Montgomery form by multiplying by R^2.
+*/
+void fingerprint_set_words(fingerprinter printer, uint64_t finger, uint64_t r_k, uint64_t r_mk, fingerprint f) {
+    fixed_mul_ui(printer, printer->R2, finger, f->finger);
+    fixed_mul_ui(printer, printer->R2, r_k, f->r_k);
+    fixed_sub(printer, f->r_k, printer->one, f->r_k);
+    fixed_mul_ui(printer, printer->R2, r_mk, f->r_mk);
+    fixed_sub(printer, f->r_mk, printer->one, f->r_mk);
+}
+
+/*
+    fingerprint_free
+    Frees a fingerprint from memory.
+    Parameters:
+        fingerprint finger - The fingerprint to free
+*/
+void fingerprint_free(fingerprint finger) {
+    free(finger);
+}
+
+#endif
@@ -15,24 +15,24 @@
     typedef struct kmp_state
     Structure to hold state of KMP algorithm.
     Components:
-        char        *P            - The pattern
+        symbol      *P            - The pattern
         hash_lookup *lookup       - The failure tables of the pattern
         int         m             - Length of the pattern
         int         period_len    - Length of the period
         int         i             - Current index of pattern
         int         matched_reset - Length of the longest prefix of P that is also a suffix of P
         int         has_break     - 1 if the period breaks at the end of the pattern, 0 otherwise
-        char        period_break  - The character that breaks the period in the pattern
+        symbol      period_break  - The character that breaks the period in the pattern
         hash_lookup break_lookup  - The failure table of the character that breaks the period
 */
 typedef struct {
-    char *P, period_break;
+    symbol *P, period_break;
     int m, i, matched_reset, period_len, has_break;
     hash_lookup *lookup, break_lookup;
 } kmp_state;
 
 int kmp_size(kmp_state state) {
-    int result = sizeof(char*) + sizeof(char) * (state.period_len + 1) + sizeof(int) * 5 + sizeof(hash_lookup*) + ((state.has_break) ? hashlookup_size(state.break_lookup) : (sizeof(int) + sizeof(cmph_t*) + sizeof(int*) + sizeof(char*)));
+    int result = sizeof(symbol*) + sizeof(symbol) * (state.period_len + 1) + sizeof(int) * 5 + sizeof(hash_lookup*) + ((state.has_break) ? hashlookup_size(state.break_lookup) : (sizeof(int) + sizeof(cmph_t*) + sizeof(int*) + sizeof(symbol*)));
     int limit = (state.period_len == state.m) ? state.period_len : (state.period_len << 1);
     int i;
     for (i = 0; i < limit; i++) result += hashlookup_size(state.lookup[i]);
@@ -45,10 +45,10 @@ int kmp_size(kmp_state state) {
     Parameters:
         kmp_state state - The current state of the algorithm
         int       i     - The index
-    Returns char:
+    Returns symbol:
         P[i]
 */
-char get_P_i(kmp_state state, int i) {
+symbol get_P_i(kmp_state state, int i) {
     if (i < state.period_len) return state.P[i];
     if ((i == state.m - 1) && (state.has_break)) return state.period_break;
     return state.P[i % state.period_len];
@@ -75,36 +75,57 @@ int get_failure_i(kmp_state state, int* failure, int i, int double_period) {
     Parameters:
         kmp_state state - The current state of the algorithm
         int       i     - The index
-        char      a     - The character to lookup
-    Returns char:
+        symbol    a     - The character to lookup
+    Returns int:
         lookup[i][a]
 */
-int get_hash_i(kmp_state state, int i, char a) {
+int get_hash_i(kmp_state state, int i, symbol a) {
     if (i < (state.period_len << 1)) return hashlookup_search(state.lookup[i], a);
     if ((i == state.m - 1) && (state.has_break)) return hashlookup_search(state.break_lookup, a);
     return hashlookup_search(state.lookup[(i % state.period_len) + state.period_len], a);
 }
 
 /*
-    kmp_build
-    Constructs a Knuth-Morris-Pratt algorithm for a pattern.
+    typedef struct kmp_builder
+    Structure for a KMP algorithm under construction, fed the pattern one character at a time.
+    Components:
+        kmp_state state         - The algorithm built so far
+        int       i             - Length of the longest border of the pattern read so far, less one
+        int       double_period - Twice the length of the period
+        int       p_len         - Maximum length of the pattern to preprocess
+        int       *failure      - The failure table of the first double_period characters
+        symbol    *sigma        - The alphabet
+        int       s_sigma       - The size of the alphabet
+        symbol    **keys        - Temporary space for building lookups
+        int       *values       - Temporary space for building lookups
+*/
+typedef struct {
+    kmp_state state;
+    int i, double_period, p_len, s_sigma, *failure, *values;
+    symbol *sigma, **keys;
+} kmp_builder;
+
+/*
+    kmpbuilder_init
+    Starts constructing a Knuth-Morris-Pratt algorithm from the start of a pattern.
     Parameters:
-        char *P      - The pattern
-        int  m       - Minimum length of the pattern to preprocess
-        int  p_len   - Maximum length of the pattern to preprocess
-        char *sigma  - The alphabet
-        int  s_sigma - The size of the alphabet
-    Returns kmp_state:
-        The starting state for the algorithm
+        symbol *P      - The first m characters of the pattern
+        int    m       - Minimum length of the pattern to preprocess
+        int    p_len   - Maximum length of the pattern to preprocess
+        symbol *sigma  - The alphabet
+        int    s_sigma - The size of the alphabet
+    Returns kmp_builder:
+        The builder, ready for kmpbuilder_extend with P[m]
 */
-kmp_state kmp_build(char *P, int m, int p_len, char *sigma, int s_sigma) {
+kmp_builder kmpbuilder_init(symbol *P, int m, int p_len, symbol *sigma, int s_sigma) {
     int i, j, k, l, count, *values, *failure;
-    char **keys;
-    kmp_state state;
+    symbol **keys;
+    kmp_builder builder;
+    kmp_state state = {0};
     state.period_len = m;
     state.has_break = 0;
 
-    state.P = malloc(m * sizeof(char));
+    state.P = malloc(m * sizeof(symbol));
     for (i = 0; i < m; i++) state.P[i] = P[i];
     state.m = m;
 
@@ -113,7 +134,7 @@ kmp_state kmp_build(char *P, int m, int p_len, char *sigma, int s_sigma) {
     failure[0] = -1;
     i = -1;
 
-    keys = malloc(s_sigma * sizeof(char*));
+    keys = malloc(s_sigma * sizeof(symbol*));
     values = malloc(s_sigma * sizeof(int));
 
     for (j = 1; j < m; j++) {
@@ -122,11 +143,13 @@ kmp_state kmp_build(char *P, int m, int p_len, char *sigma, int s_sigma) {
         failure[j] = i;
     }
     state.matched_reset = failure[m - 1];
+    builder.p_len = m;
+    builder.double_period = m;
 
     if (((failure[m - 1] + 1) << 1) >= m) {
-        state.period_len = m - failure[m - 1];
+        state.period_len = m - failure[m - 1] - 1;
         int double_period = state.period_len << 1;
-        state.P = realloc(state.P, state.period_len * sizeof(char));
+        state.P = realloc(state.P, state.period_len * sizeof(symbol));
         failure = realloc(failure, (state.period_len << 1) * sizeof(int));
 
         state.lookup = malloc((state.period_len << 1) * sizeof(hash_lookup));
@@ -152,34 +175,8 @@ kmp_state kmp_build(char *P, int m, int p_len, char *sigma, int s_sigma) {
 
             state.lookup[j] = hashlookup_build(keys, values, count);
         }
-
-        while ((state.m < p_len) && (((i + 1) << 1) >= state.m)) {
-            state.m++;
-            while (i > -1 && P[i + 1] != P[state.m - 1]) i = get_failure_i(state, failure, i, double_period);
-            if (P[i + 1] == P[state.m - 1]) i++;
-            state.matched_reset = i;
-            if (((i + 1) << 1) < state.m) {
-                state.has_break = 1;
-                state.period_break = P[state.m - 1];
-                count = 0;
-                for (k = 0; k < s_sigma; k++) {
-                    if (P[state.m - 1] != sigma[k]) {
-                        l = get_failure_i(state, failure, state.m - 2, double_period);
-                        if (P[l + 1] == sigma[k]) {
-                            keys[count] = &sigma[k];
-                            values[count++] = l + 1;
-                        } else {
-                            l = get_hash_i(state, l + 1, sigma[k]);
-                            if (l != -1) {
-                                keys[count] = &sigma[k];
-                                values[count++] = l;
-                            }
-                        }
-                    }
-                }
-                state.break_lookup = hashlookup_build(keys, values, count);
-            }
-        }
+        builder.p_len = p_len;
+        builder.double_period = double_period;
 
     } else {
         state.lookup = malloc(m * sizeof(hash_lookup));
@@ -207,11 +204,94 @@ kmp_state kmp_build(char *P, int m, int p_len, char *sigma, int s_sigma) {
         }
     }
 
-    free(keys);
-    free(values);
-    free(failure);
+    builder.state = state;
+    builder.i = i;
+    builder.failure = failure;
+    builder.sigma = sigma;
+    builder.s_sigma = s_sigma;
+    builder.keys = keys;
+    builder.values = values;
+    return builder;
+}
+
+/*
+    kmpbuilder_extend
+    Extends a periodic pattern under construction by its next character.
+    Parameters:
+        kmp_builder *builder - The builder
+        symbol      a        - The next character of the pattern
+    Returns int:
+        1 if a was added to the pattern
+        0 if the pattern is complete and a was not used
+        Parameter builder modified by reference.
+    Notes:
+        Only the period is kept, so the characters of the pattern are not needed again.
+*/
+int kmpbuilder_extend(kmp_builder *builder, symbol a) {
+    kmp_state *state = &builder->state;
+    int i = builder->i, k, l, count;
+    if ((state->m >= builder->p_len) || (((i + 1) << 1) < state->m)) return 0;
+
+    state->m++;
+    while (i > -1 && get_P_i(*state, i + 1) != a) i = get_failure_i(*state, builder->failure, i, builder->double_period);
+    if (get_P_i(*state, i + 1) == a) i++;
+    state->matched_reset = i;
+    if (((i + 1) << 1) < state->m) {
+        state->has_break = 1;
+        state->period_break = a;
+        count = 0;
+        for (k = 0; k < builder->s_sigma; k++) {
+            if (a != builder->sigma[k]) {
+                l = get_failure_i(*state, builder->failure, state->m - 2, builder->double_period);
+                if (get_P_i(*state, l + 1) == builder->sigma[k]) {
+                    builder->keys[count] = &builder->sigma[k];
+                    builder->values[count++] = l + 1;
+                } else {
+                    l = get_hash_i(*state, l + 1, builder->sigma[k]);
+                    if (l != -1) {
+                        builder->keys[count] = &builder->sigma[k];
+                        builder->values[count++] = l;
+                    }
+                }
+            }
+        }
+        state->break_lookup = hashlookup_build(builder->keys, builder->values, count);
+    }
+    builder->i = i;
+    return 1;
+}
+
+/*
+    kmpbuilder_finish
+    Completes the construction of a Knuth-Morris-Pratt algorithm.
+    Parameters:
+        kmp_builder *builder - The builder. Freed
+    Returns kmp_state:
+        The starting state for the algorithm
+*/
+kmp_state kmpbuilder_finish(kmp_builder *builder) {
+    free(builder->keys);
+    free(builder->values);
+    free(builder->failure);
+    return builder->state;
+}
 
-    return state;
+/*
+    kmp_build
+    Constructs a Knuth-Morris-Pratt algorithm for a pattern.
+    Parameters:
+        symbol *P      - The pattern
+        int    m       - Minimum length of the pattern to preprocess
+        int    p_len   - Maximum length of the pattern to preprocess
+        symbol *sigma  - The alphabet
+        int    s_sigma - The size of the alphabet
+    Returns kmp_state:
+        The starting state for the algorithm
+*/
+kmp_state kmp_build(symbol *P, int m, int p_len, symbol *sigma, int s_sigma) {
+    kmp_builder builder = kmpbuilder_init(P, m, p_len, sigma, s_sigma);
+    while ((builder.state.m < p_len) && (kmpbuilder_extend(&builder, P[builder.state.m])));
+    return kmpbuilder_finish(&builder);
 }
 
 /*
@@ -219,14 +299,14 @@ kmp_state kmp_build(char *P, int m, int p_len, char *sigma, int s_sigma) {
     Performs one round of KMP on the next character in the text.
     Parameters:
         kmp_state *state - The current state
-        char      T_j    - The next character in the text
+        symbol    T_j    - The next character in the text
         int       j      - The index of the text
     Returns int:
         j if there is a match at index j
         -1 otherwise
         Parameter state modified by reference to the next state of the algorithm.
 */
-int kmp_stream(kmp_state *state, char T_j, int j) {
+int kmp_stream(kmp_state *state, symbol T_j, int j) {
     int i = state->i, result = -1;
     if (get_P_i(*state, i + 1) != T_j) i = get_hash_i(*state, i + 1, T_j);
     else i++;
@@ -0,0 +1,276 @@
+#include "match_daemon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+/*
+    Checks the daemon against one matcher per client and pattern, then drives it with many socketpairs from a load generator.
+    Usage: match_daemon [connections] [bytes per connection]
+*/
+
+#define SOCKET_PATH "match_daemon.sock"
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+    typedef struct test_client
+    Structure for one client of the test.
+    Components:
+        int          fd       - The socket
+        int          sent     - Symbols of T written
+        int          received - Bytes of events read
+        int          done     - 1 once the daemon closed the connection
+        symbol       *T       - The text
+        matchd_event *events  - The events read
+*/
+typedef struct {
+    int fd, sent, received, done;
+    symbol *T;
+    matchd_event *events;
+} test_client;
+
+/*
+    Writes at most l symbols more of a client's text, shutting down its side after the last.
+*/
+void client_send(test_client *client, int n, int l) {
+    int written;
+    if (client->sent == n) return;
+    if (client->sent + l > n) l = n - client->sent;
+    written = write(client->fd, &client->T[client->sent], l * sizeof(symbol));
+    if (written > 0) client->sent += written / sizeof(symbol);
+    if ((written > 0) && (written % sizeof(symbol))) {
+        while (write(client->fd, (char*)&client->T[client->sent] + written % sizeof(symbol), sizeof(symbol) - written % sizeof(symbol)) <= 0);
+        client->sent++;
+    }
+    if (client->sent == n) shutdown(client->fd, SHUT_WR);
+}
+
+void client_receive(test_client *client) {
+    int got;
+    if (client->done) return;
+    got = read(client->fd, (char*)client->events + client->received, 1 << 16);
+    if (got > 0) client->received += got;
+    else if (got == 0) client->done = 1;
+}
+
+void daemon_test() {
+    int n = 20000, num_clients = 8, num_patterns = 3, i, j, k, m[3] = {6, 40, 300}, remaining = num_clients;
+    symbol sigma[2] = {'a', 'b'}, **P = malloc(num_patterns * sizeof(symbol*));
+    test_client *clients = malloc(num_clients * sizeof(test_client));
+    struct sockaddr_un address;
+    for (j = 0; j < num_patterns; j++) {
+        P[j] = malloc(m[j] * sizeof(symbol));
+        for (i = 0; i < m[j]; i++) P[j][i] = sigma[rand() % 2];
+    }
+    match_daemon daemon = matchd_build(SOCKET_PATH, P, m, num_patterns, sigma, 2, n, 0, 1L << 20);
+    assert(daemon.listen_fd != -1);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SOCKET_PATH);
+    for (k = 0; k < num_clients; k++) {
+        test_client *c = &clients[k];
+        c->T = malloc(n * sizeof(symbol));
+        c->events = malloc(n * num_patterns * sizeof(matchd_event));
+        for (i = 0; i < n; i++) c->T[i] = sigma[rand() % 2];
+        for (j = 0; j < num_patterns; j++) for (i = rand() % 500; i + m[j] < n; i += m[j] + rand() % (20 * m[j])) memcpy(&c->T[i], P[j], m[j] * sizeof(symbol));
+        c->sent = c->received = c->done = 0;
+        c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(connect(c->fd, (struct sockaddr*)&address, sizeof(address)) == 0);
+        fcntl(c->fd, F_SETFL, O_NONBLOCK);
+    }
+
+    while (remaining) {
+        k = rand() % num_clients;
+        client_send(&clients[k], n, 1 + rand() % 3000);
+        matchd_poll(&daemon, 0);
+        for (k = 0; k < num_clients; k++) {
+            if (clients[k].done) continue;
+            client_receive(&clients[k]);
+            if (clients[k].done) remaining--;
+        }
+    }
+    assert(daemon.connections == 0);
+
+    for (j = 0; j < num_patterns; j++) {
+        for (k = 0; k < num_clients; k++) {
+            exactmatch_state state = exactmatch_build(P[j], m[j], sigma, 2, n, 0);
+            int next = 0, count = clients[k].received / sizeof(matchd_event);
+            for (i = 0; i < n; i++) {
+                if (exactmatch_stream(&state, clients[k].T[i]) == -1) continue;
+                while ((next < count) && (clients[k].events[next].pattern != j)) next++;
+                assert((next < count) && (clients[k].events[next++].location == i));
+            }
+            while ((next < count) && (clients[k].events[next].pattern != j)) next++;
+            assert(next == count);
+            exactmatch_free(&state);
+        }
+    }
+    assert(daemon.refused == 0);
+    matchd_free(&daemon);
+    unlink(SOCKET_PATH);
+    for (k = 0; k < num_clients; k++) {
+        close(clients[k].fd);
+        free(clients[k].T);
+        free(clients[k].events);
+    }
+    for (j = 0; j < num_patterns; j++) free(P[j]);
+    free(P);
+    free(clients);
+}
+
+/*
+    A client that sends without reading its events must stall only itself.
+*/
+void backpressure_test() {
+    int n = 300000, m = 4, i, fds[2], stalled = 0;
+    symbol sigma[2] = {'a', 'b'}, P[4] = {'a', 'a', 'a', 'a'}, *pattern = P;
+    test_client client = {0, 0, 0, 0, malloc(n * sizeof(symbol)), malloc(n * sizeof(matchd_event))};
+    for (i = 0; i < n; i++) client.T[i] = 'a';
+    match_daemon daemon = matchd_build(NULL, &pattern, &m, 1, sigma, 2, n, 0, 1L << 20);
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    client.fd = fds[0];
+    fcntl(client.fd, F_SETFL, O_NONBLOCK);
+    assert(matchd_adopt(&daemon, fds[1]));
+
+    while (stalled < 10) {
+        int before = client.sent;
+        client_send(&client, n, 4096);
+        matchd_poll(&daemon, 0);
+        stalled = (client.sent == before) ? stalled + 1 : 0;
+    }
+    assert(client.sent < n);
+    assert((daemon.list->interest == EPOLLOUT) && (daemon.list->in_bytes == MATCHD_INPUT));
+
+    while (!client.done) {
+        client_send(&client, n, 4096);
+        matchd_poll(&daemon, 0);
+        client_receive(&client);
+    }
+    assert(client.received == (n - m + 1) * sizeof(matchd_event));
+    for (i = 0; i < n - m + 1; i++) assert(client.events[i].location == i + m - 1);
+    matchd_free(&daemon);
+    close(client.fd);
+    free(client.T);
+    free(client.events);
+}
+
+/*
+    typedef struct load_client
+    Structure for one connection of the load generator.
+    Components:
+        int  fd     - The client's end of the socketpair
+        int  offset - Where in the shared text the client's stream starts
+        int  sent   - Bytes written
+        int  events - Bytes of events read
+*/
+typedef struct {
+    int fd, offset, sent, events;
+} load_client;
+
+void *daemon_loop(void *data) {
+    match_daemon *daemon = data;
+    while (daemon->connections > 0) matchd_poll(daemon, 100);
+    return NULL;
+}
+
+void load_benchmark(int num_connections, int bytes) {
+    int num_patterns = 2, m[2] = {32, 256}, i, j, fds[2], open_clients = num_connections, ready, length = 1 << 22;
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, **P = malloc(num_patterns * sizeof(symbol*));
+    char *T = malloc(length);
+    load_client *clients = malloc(num_connections * sizeof(load_client));
+    struct epoll_event event, *events = malloc(MATCHD_WAIT * sizeof(struct epoll_event));
+    struct rlimit limit;
+    char buffer[1 << 16];
+    long received = 0;
+    pthread_t thread;
+
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < 2 * num_connections + 16) {
+        num_connections = open_clients = (limit.rlim_cur - 16) / 2;
+        printf("Warning: file descriptor limit allows only %d connections\n", num_connections);
+    }
+    bytes -= bytes % sizeof(symbol);
+    for (i = 0; i < length / (int)sizeof(symbol); i++) ((symbol*)T)[i] = sigma[rand() % 4];
+    for (j = 0; j < num_patterns; j++) {
+        P[j] = malloc(m[j] * sizeof(symbol));
+        for (i = 0; i < m[j]; i++) P[j][i] = sigma[rand() % 4];
+        for (i = 0; i < 2000; i++) memcpy((symbol*)T + rand() % (length / sizeof(symbol) - m[j]), P[j], m[j] * sizeof(symbol));
+    }
+    match_daemon daemon = matchd_build(NULL, P, m, num_patterns, sigma, 4, bytes, 0, 1L << 30);
+
+    int epoll_fd = epoll_create1(0);
+    for (i = 0; i < num_connections; i++) {
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        assert(matchd_adopt(&daemon, fds[1]));
+        clients[i].fd = fds[0];
+        clients[i].offset = (rand() % (length - bytes)) & ~(int)(sizeof(symbol) - 1);
+        clients[i].sent = 0;
+        clients[i].events = 0;
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.ptr = &clients[i];
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fds[0], &event);
+    }
+
+    double start = now();
+    pthread_create(&thread, NULL, daemon_loop, &daemon);
+    while (open_clients) {
+        ready = epoll_wait(epoll_fd, events, MATCHD_WAIT, 100);
+        for (i = 0; i < ready; i++) {
+            load_client *c = events[i].data.ptr;
+            if ((events[i].events & EPOLLOUT) && (c->sent < bytes)) {
+                int l = (bytes - c->sent < 1460) ? bytes - c->sent : 1460, written = write(c->fd, T + c->offset + c->sent, l);
+                if (written > 0) c->sent += written;
+                if (c->sent == bytes) {
+                    shutdown(c->fd, SHUT_WR);
+                    event.events = EPOLLIN;
+                    event.data.ptr = c;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &event);
+                }
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP)) {
+                int got = read(c->fd, buffer, sizeof(buffer));
+                if (got > 0) c->events += got;
+                else if (got == 0) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+                    close(c->fd);
+                    received += c->events / sizeof(matchd_event);
+                    open_clients--;
+                }
+            }
+        }
+    }
+    pthread_join(thread, NULL);
+    double seconds = now() - start;
+    assert(received == daemon.events);
+
+    printf("%d connections, %d bytes each, %d patterns: %.2f s, %.2f MB/s, %.1f kevents/s, %ld events\n", num_connections, bytes, num_patterns, seconds, (double)num_connections * bytes / seconds / 1e6, daemon.events / seconds / 1e3, daemon.events);
+    printf("%d bytes per connection: %d of buffers and %d of cursors\n", (int)(sizeof(matchd_connection) + MATCHD_INPUT + MATCHD_EVENTS * sizeof(matchd_event) + num_patterns * sizeof(int) + daemon.tables[0].slot_size + daemon.tables[1].slot_size),
+        (int)(sizeof(matchd_connection) + MATCHD_INPUT + MATCHD_EVENTS * sizeof(matchd_event) + num_patterns * sizeof(int)), daemon.tables[0].slot_size + daemon.tables[1].slot_size);
+    matchd_free(&daemon);
+    close(epoll_fd);
+    for (j = 0; j < num_patterns; j++) free(P[j]);
+    free(P);
+    free(T);
+    free(clients);
+    free(events);
+}
+
+int main(int argc, char **argv) {
+    int num_connections = (argc > 1) ? atoi(argv[1]) : 2000, bytes = (argc > 2) ? atoi(argv[2]) : 2048;
+    srand(6);
+    daemon_test();
+    backpressure_test();
+    load_benchmark(num_connections, bytes);
+    return 0;
+}
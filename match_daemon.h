@@ -0,0 +1,366 @@
+/*
+    match_daemon.h
+    A local matching service: clients connect over a Unix socket, stream text, and read back match events.
+    The patterns are compiled once into one flow_table each, and every connection keeps only a cursor per pattern, so
+    thousands of connections share the pattern set. All sockets are non-blocking and driven by epoll from matchd_poll, which
+    can be called from the caller's own loop.
+    Feeding never blocks either. flowtable_stream returns the number of symbols consumed and stops as soon as the
+    connection's event buffer is full, so unconsumed input stays buffered and reading from that client pauses until its
+    events have been written. A client that does not read its events therefore slows only itself.
+    Protocol:
+        Client to daemon - The text, as raw symbols. Shutting down the write side ends the stream
+        Daemon to client - One matchd_event per match, in increasing location for each pattern. The daemon closes the
+                           connection once every event has been written
+*/
+
+#ifndef MATCH_DAEMON
+#define MATCH_DAEMON
+
+#include "flow_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#define MATCHD_INPUT 4096
+#define MATCHD_EVENTS 512
+#define MATCHD_WAIT 256
+
+/*
+    typedef struct matchd_event
+    Structure for a match, as written to clients.
+    Components:
+        int location - Index of the client's text at the end of the match
+        int pattern  - Index of the pattern that matched
+*/
+typedef struct {
+    int location, pattern;
+} matchd_event;
+
+/*
+    typedef struct matchd_connection
+    Structure for a client.
+    Components:
+        int           fd        - The socket
+        unsigned long id        - Flow id of the client in every flow_table
+        int           interest  - The epoll events currently watched
+        int           eof       - 1 once the client has shut down its side
+        int           in_bytes  - Bytes of input buffered
+        int           *fed      - Symbols of the buffered input consumed by each pattern
+        int           pattern   - Pattern being fed, for the sink
+        int           out_count - Events buffered
+        int           out_sent  - Bytes of the buffered events already written
+        char          *in       - MATCHD_INPUT bytes of input
+        matchd_event  *out      - MATCHD_EVENTS events to write
+        struct matchd_connection_t *prev, *next - Neighbours in the list of connections
+*/
+typedef struct matchd_connection_t {
+    int fd, interest, eof, in_bytes, *fed, pattern, out_count, out_sent;
+    unsigned long id;
+    char *in;
+    matchd_event *out;
+    struct matchd_connection_t *prev, *next;
+} matchd_connection;
+
+/*
+    typedef struct match_daemon
+    Structure for the service.
+    Components:
+        int               listen_fd    - The listening socket, -1 if none
+        int               epoll_fd     - The epoll instance
+        int               num_patterns - Number of patterns
+        int               connections  - Number of open connections
+        flow_table        *tables      - One table per pattern, holding every connection's cursor for it
+        matchd_connection *list        - The open connections
+        unsigned long     next_id      - Flow id of the next connection
+        long              symbols      - Symbols matched so far
+        long              events       - Events written so far
+        long              refused      - Connections refused because the tables were at capacity
+*/
+typedef struct {
+    int listen_fd, epoll_fd, num_patterns, connections;
+    flow_table *tables;
+    matchd_connection *list;
+    unsigned long next_id;
+    long symbols, events, refused;
+} match_daemon;
+
+/*
+    matchd_build
+    Constructs the service.
+    Parameters:
+        char   *path         - Path of the Unix socket to listen on, replacing any file there. NULL to take connections
+                               only through matchd_adopt
+        symbol **P           - The patterns
+        int    *m            - Length of each pattern
+        int    num_patterns  - Number of patterns
+        symbol *sigma        - The alphabet
+        int    s_sigma       - The size of the alphabet
+        int    n             - The longest text a client may send
+        int    alpha         - The level of accuracy desired
+        long   budget        - Bytes to spend on cursors for each pattern, which bounds the number of connections
+    Returns match_daemon:
+        The service, with listen_fd -1 if path was given and could not be bound
+*/
+match_daemon matchd_build(char *path, symbol **P, int *m, int num_patterns, symbol *sigma, int s_sigma, int n, int alpha, long budget) {
+    match_daemon daemon;
+    struct sockaddr_un address;
+    struct epoll_event event;
+    int i;
+    daemon.num_patterns = num_patterns;
+    daemon.tables = malloc(num_patterns * sizeof(flow_table));
+    for (i = 0; i < num_patterns; i++) daemon.tables[i] = flowtable_build(P[i], m[i], sigma, s_sigma, n, alpha, budget);
+    daemon.connections = 0;
+    daemon.list = NULL;
+    daemon.next_id = 0;
+    daemon.symbols = 0;
+    daemon.events = 0;
+    daemon.refused = 0;
+    daemon.epoll_fd = epoll_create1(0);
+    daemon.listen_fd = -1;
+    if (!path) return daemon;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    unlink(path);
+    daemon.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if ((bind(daemon.listen_fd, (struct sockaddr*)&address, sizeof(address)) == -1) || (listen(daemon.listen_fd, SOMAXCONN) == -1)) {
+        printf("Warning: could not listen on %s\n", path);
+        close(daemon.listen_fd);
+        daemon.listen_fd = -1;
+        return daemon;
+    }
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(daemon.epoll_fd, EPOLL_CTL_ADD, daemon.listen_fd, &event);
+    return daemon;
+}
+
+/*
+    matchd_adopt
+    Serves a connected socket, such as one end of a socketpair.
+    Parameters:
+        match_daemon *daemon - The service
+        int          fd      - The socket, which the service now owns
+    Returns int:
+        1 if the connection is being served
+        0 if it was refused and closed because a table is at capacity
+    Notes:
+        Evicting a connection's cursor would silently lose its matches, so connections past the budget are refused instead.
+*/
+int matchd_adopt(match_daemon *daemon, int fd) {
+    struct epoll_event event;
+    matchd_connection *c;
+    int i;
+    for (i = 0; i < daemon->num_patterns; i++) {
+        if (daemon->connections >= daemon->tables[i].capacity) {
+            close(fd);
+            daemon->refused++;
+            return 0;
+        }
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    c = malloc(sizeof(matchd_connection));
+    c->fd = fd;
+    c->id = daemon->next_id++;
+    c->interest = EPOLLIN;
+    c->eof = 0;
+    c->in_bytes = 0;
+    c->fed = calloc(daemon->num_patterns, sizeof(int));
+    c->out_count = 0;
+    c->out_sent = 0;
+    c->in = malloc(MATCHD_INPUT);
+    c->out = malloc(MATCHD_EVENTS * sizeof(matchd_event));
+    c->prev = NULL;
+    c->next = daemon->list;
+    if (daemon->list) daemon->list->prev = c;
+    daemon->list = c;
+    daemon->connections++;
+    event.events = c->interest;
+    event.data.ptr = c;
+    epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    return 1;
+}
+
+/*
+    matchd_drop
+    Closes a connection and frees its cursors.
+    Parameters:
+        match_daemon      *daemon - The service
+        matchd_connection *c      - The connection
+*/
+void matchd_drop(match_daemon *daemon, matchd_connection *c) {
+    int i;
+    for (i = 0; i < daemon->num_patterns; i++) flowtable_close(&daemon->tables[i], c->id);
+    epoll_ctl(daemon->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->prev) c->prev->next = c->next;
+    else daemon->list = c->next;
+    if (c->next) c->next->prev = c->prev;
+    daemon->connections--;
+    free(c->fed);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+int matchd_emit(match_sink *sink, int location) {
+    matchd_connection *c = sink->data;
+    c->out[c->out_count].location = location;
+    c->out[c->out_count++].pattern = c->pattern;
+    return c->out_count == MATCHD_EVENTS;
+}
+
+int matchd_full(match_sink *sink) {
+    return ((matchd_connection*)sink->data)->out_count == MATCHD_EVENTS;
+}
+
+/*
+    matchd_feed
+    Feeds a connection's buffered input to every pattern, as far as its event buffer allows.
+    Parameters:
+        match_daemon      *daemon - The service
+        matchd_connection *c      - The connection
+    Returns int:
+        1 if all whole symbols of the input were consumed by every pattern
+        0 if the event buffer filled first
+*/
+int matchd_feed(match_daemon *daemon, matchd_connection *c) {
+    int i, l = c->in_bytes / sizeof(symbol), done = l, consumed;
+    symbol *T = (symbol*)c->in;
+    match_sink sink = {matchd_emit, matchd_full, NULL, c, 0};
+    for (i = 0; i < daemon->num_patterns; i++) {
+        if (c->fed[i] < l) {
+            c->pattern = i;
+            consumed = flowtable_stream(&daemon->tables[i], c->id, &T[c->fed[i]], l - c->fed[i], &sink);
+            c->fed[i] += consumed;
+            if (i == 0) daemon->symbols += consumed;
+        }
+        if (c->fed[i] < done) done = c->fed[i];
+    }
+    if (done > 0) {
+        memmove(c->in, &T[done], c->in_bytes - done * sizeof(symbol));
+        c->in_bytes -= done * sizeof(symbol);
+        for (i = 0; i < daemon->num_patterns; i++) c->fed[i] -= done;
+    }
+    return done == l;
+}
+
+/*
+    matchd_flush
+    Writes as many buffered events as the socket will take.
+    Parameters:
+        match_daemon      *daemon - The service
+        matchd_connection *c      - The connection
+    Returns int:
+        1 if the connection is still usable
+        0 if the client has gone
+*/
+int matchd_flush(match_daemon *daemon, matchd_connection *c) {
+    int total = c->out_count * sizeof(matchd_event), written;
+    while (c->out_sent < total) {
+        written = send(c->fd, (char*)c->out + c->out_sent, total - c->out_sent, MSG_NOSIGNAL);
+        if (written == -1) return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+        c->out_sent += written;
+    }
+    daemon->events += c->out_count;
+    c->out_count = 0;
+    c->out_sent = 0;
+    return 1;
+}
+
+/*
+    matchd_service
+    Handles a connection that epoll reported ready: reads, feeds, writes, and updates what to wait for.
+    Parameters:
+        match_daemon      *daemon - The service
+        matchd_connection *c      - The connection
+    Notes:
+        Reading pauses while the input buffer is full, which only happens while events are waiting to be written.
+*/
+void matchd_service(match_daemon *daemon, matchd_connection *c) {
+    struct epoll_event event;
+    int got, fed = 0;
+    if ((!c->eof) && (c->in_bytes < MATCHD_INPUT)) {
+        got = read(c->fd, c->in + c->in_bytes, MATCHD_INPUT - c->in_bytes);
+        if (got > 0) c->in_bytes += got;
+        else if (got == 0) c->eof = 1;
+        else if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) c->eof = 1;
+    }
+    while (1) {
+        fed = matchd_feed(daemon, c);
+        if (!matchd_flush(daemon, c)) {
+            matchd_drop(daemon, c);
+            return;
+        }
+        if ((fed) || (c->out_count > 0)) break;
+    }
+    if ((c->eof) && (fed) && (c->out_count == 0)) {
+        matchd_drop(daemon, c);
+        return;
+    }
+    event.events = ((!c->eof) && (c->in_bytes < MATCHD_INPUT) ? EPOLLIN : 0) | ((c->out_count > 0) ? EPOLLOUT : 0);
+    if (event.events != c->interest) {
+        c->interest = event.events;
+        event.data.ptr = c;
+        epoll_ctl(daemon->epoll_fd, EPOLL_CTL_MOD, c->fd, &event);
+    }
+}
+
+/*
+    matchd_poll
+    Waits for sockets to become ready and serves them.
+    Parameters:
+        match_daemon *daemon  - The service
+        int          timeout  - Most milliseconds to wait, -1 to wait indefinitely, 0 to return at once
+    Returns int:
+        Number of sockets served, -1 on error
+*/
+int matchd_poll(match_daemon *daemon, int timeout) {
+    struct epoll_event events[MATCHD_WAIT];
+    int i, fd, ready = epoll_wait(daemon->epoll_fd, events, MATCHD_WAIT, timeout);
+    if (ready == -1) return (errno == EINTR) ? 0 : -1;
+    for (i = 0; i < ready; i++) {
+        if (events[i].data.ptr) matchd_service(daemon, events[i].data.ptr);
+        else while ((fd = accept(daemon->listen_fd, NULL, NULL)) != -1) matchd_adopt(daemon, fd);
+    }
+    return ready;
+}
+
+/*
+    matchd_memory
+    Returns the memory the service has allocated.
+    Parameters:
+        match_daemon *daemon - The service
+    Returns long:
+        Bytes allocated for the tables and the buffers of open connections
+*/
+long matchd_memory(match_daemon *daemon) {
+    long result = sizeof(match_daemon) + (long)daemon->connections * (sizeof(matchd_connection) + MATCHD_INPUT + MATCHD_EVENTS * sizeof(matchd_event) + daemon->num_patterns * sizeof(int));
+    int i;
+    for (i = 0; i < daemon->num_patterns; i++) result += flowtable_memory(&daemon->tables[i]);
+    return result;
+}
+
+/*
+    matchd_free
+    Closes every connection and frees the service.
+    Parameters:
+        match_daemon *daemon - The service to free
+*/
+void matchd_free(match_daemon *daemon) {
+    int i;
+    while (daemon->list) matchd_drop(daemon, daemon->list);
+    if (daemon->listen_fd != -1) close(daemon->listen_fd);
+    close(daemon->epoll_fd);
+    for (i = 0; i < daemon->num_patterns; i++) flowtable_free(&daemon->tables[i]);
+    free(daemon->tables);
+}
+
+#endif
@@ -0,0 +1,475 @@
+/*
+    match_sink.h
+    Destinations for match locations, so that memory for results is bounded by the sink rather than by the length of the text.
+    Provides a callback, a bounded ring buffer with backpressure, a position bitmap, a delta-varint encoded stream and a
+    stream of arithmetic progressions for periodic text.
+*/
+
+#ifndef MATCH_SINK
+#define MATCH_SINK
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    typedef struct match_sink_t match_sink
+    Structure for a destination of match locations.
+    Components:
+        int  (*emit)(match_sink*, int) - Records a location. Returns 1 if the sink is now full, 0 otherwise
+        int  (*full)(match_sink*)      - 1 if the sink can take no more locations, 0 otherwise. May be NULL if never full
+        void (*release)(match_sink*)   - Frees the sink's storage. May be NULL
+        void *data                     - Storage for the sink
+        int  count                     - The number of locations emitted so far
+        int  (*progression)(match_sink*, int, int, int) - Records count locations start, start + stride, ... at once.
+                                                          Returns as emit. May be NULL, and the locations are then emitted
+                                                          one at a time
+*/
+typedef struct match_sink_t {
+    int (*emit)(struct match_sink_t *sink, int location);
+    int (*full)(struct match_sink_t *sink);
+    void (*release)(struct match_sink_t *sink);
+    void *data;
+    int count;
+    int (*progression)(struct match_sink_t *sink, int start, int stride, int count);
+} match_sink;
+
+/*
+    matchsink_emit
+    Passes a location to a sink.
+    Parameters:
+        match_sink *sink     - The sink to use
+        int        location  - The location of the match
+    Returns int:
+        1 if the sink is now full and the producer should stop
+        0 otherwise
+*/
+int matchsink_emit(match_sink *sink, int location) {
+    sink->count++;
+    return sink->emit(sink, location);
+}
+
+/*
+    matchsink_emit_progression
+    Passes the locations start, start + stride, ..., start + (count - 1) * stride to a sink.
+    Parameters:
+        match_sink *sink   - The sink to use
+        int        start   - The first location
+        int        stride  - The distance between locations
+        int        count   - The number of locations, at least 1
+        int        *taken  - Set to the number of locations the sink took. Less than count only if it filled
+    Returns int:
+        1 if the sink is now full and the producer should stop
+        0 otherwise
+    Notes:
+        Sinks with a progression function take the whole progression in O(1). Others are emitted each location in turn.
+*/
+int matchsink_emit_progression(match_sink *sink, int start, int stride, int count, int *taken) {
+    int j;
+    if (sink->progression) {
+        *taken = count;
+        sink->count += count;
+        return sink->progression(sink, start, stride, count);
+    }
+    for (j = 0; j < count; j++) {
+        if (matchsink_emit(sink, start + j * stride)) {
+            *taken = j + 1;
+            return 1;
+        }
+    }
+    *taken = count;
+    return 0;
+}
+
+/*
+    matchsink_full
+    Checks whether a sink can take another location.
+    Parameters:
+        match_sink *sink - The sink to check
+    Returns int:
+        1 if the sink is full
+        0 otherwise
+*/
+int matchsink_full(match_sink *sink) {
+    return (sink->full) ? sink->full(sink) : 0;
+}
+
+/*
+    matchsink_free
+    Frees a sink's storage.
+    Parameters:
+        match_sink *sink - The sink to free
+*/
+void matchsink_free(match_sink *sink) {
+    if (sink->release) sink->release(sink);
+}
+
+int array_emit(match_sink *sink, int location) {
+    ((int*)sink->data)[sink->count - 1] = location;
+    return 0;
+}
+
+/*
+    matchsink_array
+    Constructs a sink writing into a caller-owned array.
+    Parameters:
+        int *results - Array large enough for every match
+    Returns match_sink:
+        The sink
+*/
+match_sink matchsink_array(int *results) {
+    match_sink sink = {array_emit, NULL, NULL, results, 0};
+    return sink;
+}
+
+/*
+    typedef struct callback_sink
+    Storage for a callback sink.
+    Components:
+        void (*callback)(int, void*) - The function to call with each location
+        void *data                   - Passed through to callback
+*/
+typedef struct {
+    void (*callback)(int location, void *data);
+    void *data;
+} callback_sink;
+
+int callback_emit(match_sink *sink, int location) {
+    callback_sink *callback = sink->data;
+    callback->callback(location, callback->data);
+    return 0;
+}
+
+void callback_release(match_sink *sink) {
+    free(sink->data);
+}
+
+/*
+    matchsink_callback
+    Constructs a sink calling a function for every match.
+    Parameters:
+        void (*callback)(int, void*) - The function to call with each location
+        void *data                   - Passed through to callback
+    Returns match_sink:
+        The sink
+*/
+match_sink matchsink_callback(void (*callback)(int location, void *data), void *data) {
+    callback_sink *storage = malloc(sizeof(callback_sink));
+    storage->callback = callback;
+    storage->data = data;
+    match_sink sink = {callback_emit, NULL, callback_release, storage, 0};
+    return sink;
+}
+
+/*
+    typedef struct ring_sink
+    Storage for a bounded ring buffer of locations.
+    Components:
+        int  *values                 - The buffered locations
+        int  capacity                - Maximum number of buffered locations
+        int  head                    - Index of the oldest buffered location
+        int  size                    - Number of buffered locations
+        void (*drain)(match_sink*, void*) - Called when the ring fills up. May be NULL
+        void *data                   - Passed through to drain
+*/
+typedef struct {
+    int *values, capacity, head, size;
+    void (*drain)(match_sink *sink, void *data);
+    void *data;
+} ring_sink;
+
+int ring_full(match_sink *sink) {
+    ring_sink *ring = sink->data;
+    if ((ring->size == ring->capacity) && (ring->drain)) ring->drain(sink, ring->data);
+    return ring->size == ring->capacity;
+}
+
+int ring_emit(match_sink *sink, int location) {
+    ring_sink *ring = sink->data;
+    int tail = ring->head + ring->size;
+    if (tail >= ring->capacity) tail -= ring->capacity;
+    ring->values[tail] = location;
+    ring->size++;
+    return ring_full(sink);
+}
+
+void ring_release(match_sink *sink) {
+    ring_sink *ring = sink->data;
+    free(ring->values);
+    free(ring);
+}
+
+/*
+    matchsink_ring
+    Constructs a bounded ring buffer of locations.
+    Parameters:
+        int  capacity                     - Maximum number of buffered locations
+        void (*drain)(match_sink*, void*) - Called when the ring fills up, e.g. to pop locations with ringsink_pop. May be NULL
+        void *data                        - Passed through to drain
+    Returns match_sink:
+        The sink
+    Notes:
+        If the ring is still full after drain, emit reports the sink as full and producers stop early.
+        Streaming producers can then be resumed once locations have been popped.
+*/
+match_sink matchsink_ring(int capacity, void (*drain)(match_sink *sink, void *data), void *data) {
+    ring_sink *ring = malloc(sizeof(ring_sink));
+    ring->values = malloc(capacity * sizeof(int));
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->size = 0;
+    ring->drain = drain;
+    ring->data = data;
+    match_sink sink = {ring_emit, ring_full, ring_release, ring, 0};
+    return sink;
+}
+
+/*
+    ringsink_pop
+    Removes the oldest location from a ring sink.
+    Parameters:
+        match_sink *sink     - The ring sink
+        int        *location - The location removed
+    Returns int:
+        1 if a location was removed
+        0 if the ring was empty
+*/
+int ringsink_pop(match_sink *sink, int *location) {
+    ring_sink *ring = sink->data;
+    if (ring->size == 0) return 0;
+    *location = ring->values[ring->head];
+    if (++ring->head == ring->capacity) ring->head = 0;
+    ring->size--;
+    return 1;
+}
+
+/*
+    typedef struct bitmap_sink
+    Storage for a bitmap of match locations.
+    Components:
+        unsigned long *bits  - Bit i is set if there is a match at location i
+        int           words  - Number of words allocated
+*/
+typedef struct {
+    unsigned long *bits;
+    int words;
+} bitmap_sink;
+
+#define BITMAP_WORD_BITS (8 * sizeof(unsigned long))
+
+int bitmap_emit(match_sink *sink, int location) {
+    bitmap_sink *bitmap = sink->data;
+    int word = location / BITMAP_WORD_BITS;
+    if (word >= bitmap->words) {
+        int words = bitmap->words;
+        while (words <= word) words <<= 1;
+        bitmap->bits = realloc(bitmap->bits, words * sizeof(unsigned long));
+        memset(&bitmap->bits[bitmap->words], 0, (words - bitmap->words) * sizeof(unsigned long));
+        bitmap->words = words;
+    }
+    bitmap->bits[word] |= 1UL << (location % BITMAP_WORD_BITS);
+    return 0;
+}
+
+void bitmap_release(match_sink *sink) {
+    bitmap_sink *bitmap = sink->data;
+    free(bitmap->bits);
+    free(bitmap);
+}
+
+/*
+    matchsink_bitmap
+    Constructs a bitmap of match locations, one bit per location of the text.
+    Returns match_sink:
+        The sink
+*/
+match_sink matchsink_bitmap() {
+    bitmap_sink *bitmap = malloc(sizeof(bitmap_sink));
+    bitmap->words = 1;
+    bitmap->bits = calloc(1, sizeof(unsigned long));
+    match_sink sink = {bitmap_emit, NULL, bitmap_release, bitmap, 0};
+    return sink;
+}
+
+/*
+    bitmapsink_test
+    Checks whether there was a match at a location.
+    Parameters:
+        match_sink *sink     - The bitmap sink
+        int        location  - The location to check
+    Returns int:
+        1 if there was a match at location
+        0 otherwise
+*/
+int bitmapsink_test(match_sink *sink, int location) {
+    bitmap_sink *bitmap = sink->data;
+    int word = location / BITMAP_WORD_BITS;
+    if (word >= bitmap->words) return 0;
+    return (bitmap->bits[word] >> (location % BITMAP_WORD_BITS)) & 1;
+}
+
+/*
+    typedef struct varint_sink
+    Storage for delta-varint encoded match locations.
+    Components:
+        unsigned char *bytes    - The encoded stream. Each location is stored as its distance from the last in LEB128
+        int           size      - Number of bytes used
+        int           capacity  - Number of bytes allocated
+        int           last      - The last location encoded
+*/
+typedef struct {
+    unsigned char *bytes;
+    int size, capacity, last;
+} varint_sink;
+
+int varint_emit(match_sink *sink, int location) {
+    varint_sink *varint = sink->data;
+    unsigned int delta = location - varint->last;
+    if (varint->size + 5 > varint->capacity) {
+        varint->capacity <<= 1;
+        varint->bytes = realloc(varint->bytes, varint->capacity);
+    }
+    while (delta >= 0x80) {
+        varint->bytes[varint->size++] = (delta & 0x7f) | 0x80;
+        delta >>= 7;
+    }
+    varint->bytes[varint->size++] = delta;
+    varint->last = location;
+    return 0;
+}
+
+void varint_release(match_sink *sink) {
+    varint_sink *varint = sink->data;
+    free(varint->bytes);
+    free(varint);
+}
+
+/*
+    matchsink_varint
+    Constructs a delta-varint encoded stream of match locations.
+    Returns match_sink:
+        The sink
+    Notes:
+        Locations must be emitted in increasing order. Memory used is proportional to the number of matches.
+*/
+match_sink matchsink_varint() {
+    varint_sink *varint = malloc(sizeof(varint_sink));
+    varint->capacity = 16;
+    varint->bytes = malloc(varint->capacity);
+    varint->size = 0;
+    varint->last = 0;
+    match_sink sink = {varint_emit, NULL, varint_release, varint, 0};
+    return sink;
+}
+
+/*
+    varintsink_next
+    Decodes the next location from a delta-varint sink.
+    Parameters:
+        match_sink *sink     - The varint sink
+        int        *offset   - Byte offset to decode from. Start at 0
+        int        *location - The previous location decoded. Start at 0
+    Returns int:
+        1 if a location was decoded
+        0 at the end of the stream
+        Parameters offset and location modified by reference to the next offset and location.
+*/
+int varintsink_next(match_sink *sink, int *offset, int *location) {
+    varint_sink *varint = sink->data;
+    if (*offset >= varint->size) return 0;
+    unsigned int delta = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = varint->bytes[(*offset)++];
+        delta |= (unsigned int)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *location += delta;
+    return 1;
+}
+
+/*
+    typedef struct progression_sink
+    Storage for a stream of arithmetic progressions of locations.
+    Components:
+        void (*callback)(int, int, int, void*) - The function to call with each progression
+        void *data                             - Passed through to callback
+        int  start                             - First location of the pending progression
+        int  stride                            - Distance between its locations, 0 if it has only one
+        int  count                             - Number of its locations, 0 if there is none pending
+        int  progressions                      - Number of progressions passed to callback so far
+*/
+typedef struct {
+    void (*callback)(int start, int stride, int count, void *data);
+    void *data;
+    int start, stride, count, progressions;
+} progression_sink;
+
+/*
+    progressionsink_flush
+    Passes the pending progression of a progression sink to its callback.
+    Parameters:
+        match_sink *sink - The progression sink
+    Notes:
+        Call once the text has been matched. Progressions are only passed on once the next location does not extend them.
+*/
+void progressionsink_flush(match_sink *sink) {
+    progression_sink *progression = sink->data;
+    if (progression->count == 0) return;
+    progression->callback(progression->start, progression->stride, progression->count, progression->data);
+    progression->progressions++;
+    progression->count = 0;
+}
+
+int progression_add(match_sink *sink, int start, int stride, int count) {
+    progression_sink *progression = sink->data;
+    if (progression->count > 0) {
+        int merged = (progression->count > 1) ? progression->stride : start - progression->start;
+        if ((merged > 0) && (start == progression->start + merged * progression->count) && ((count == 1) || (stride == merged))) {
+            progression->stride = merged;
+            progression->count += count;
+            return 0;
+        }
+        progressionsink_flush(sink);
+    }
+    progression->start = start;
+    progression->stride = (count > 1) ? stride : 0;
+    progression->count = count;
+    return 0;
+}
+
+int progression_emit(match_sink *sink, int location) {
+    return progression_add(sink, location, 0, 1);
+}
+
+void progression_release(match_sink *sink) {
+    progressionsink_flush(sink);
+    free(sink->data);
+}
+
+/*
+    matchsink_progression
+    Constructs a sink collapsing locations into arithmetic progressions, e.g. the overlapping matches of a periodic
+    pattern in a run of its period.
+    Parameters:
+        void (*callback)(int, int, int, void*) - Called with the start, stride and count of each maximal progression
+        void *data                             - Passed through to callback
+    Returns match_sink:
+        The sink
+    Notes:
+        Locations must be emitted in increasing order. Each is added to the pending progression if it is the next term,
+        and otherwise the pending progression is passed on and a new one started, so a run of matches costs one callback.
+        Producers that know a run is periodic pass it in whole with matchsink_emit_progression. The pending progression is
+        passed on by progressionsink_flush or matchsink_free.
+*/
+match_sink matchsink_progression(void (*callback)(int start, int stride, int count, void *data), void *data) {
+    progression_sink *progression = malloc(sizeof(progression_sink));
+    progression->callback = callback;
+    progression->data = data;
+    progression->count = 0;
+    progression->progressions = 0;
+    match_sink sink = {progression_emit, NULL, progression_release, progression, 0, progression_add};
+    return sink;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "matching_2d.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks 2D matching against a naive scan on a synthetic image, then times it on a larger one.
+*/
+int naive_2d(symbol *T, int width, int height, symbol **P, int m1, int m2, int *correct) {
+    int row, col, i, count = 0;
+    for (row = m1 - 1; row < height; row++) {
+        for (col = m2 - 1; col < width; col++) {
+            for (i = 0; i < m1; i++) if (memcmp(&T[(row - m1 + 1 + i) * width + col - m2 + 1], P[i], m2 * sizeof(symbol))) break;
+            if (i == m1) correct[count++] = row * width + col;
+        }
+    }
+    return count;
+}
+
+symbol *synthetic_image(int width, int height, symbol **P, int m1, int m2, int plants, int s_sigma) {
+    symbol *T = malloc(width * height * sizeof(symbol));
+    int i, j, row, col;
+    for (i = 0; i < width * height; i++) T[i] = 'a' + rand() % s_sigma;
+    for (j = 0; j < plants; j++) {
+        row = rand() % (height - m1 + 1);
+        col = rand() % (width - m2 + 1);
+        for (i = 0; i < m1; i++) memcpy(&T[(row + i) * width + col], P[i], m2 * sizeof(symbol));
+    }
+    return T;
+}
+
+symbol **synthetic_tile(int m1, int m2, int s_sigma) {
+    symbol **P = malloc(m1 * sizeof(symbol*));
+    int i, j;
+    for (i = 0; i < m1; i++) {
+        P[i] = malloc(m2 * sizeof(symbol));
+        if ((i > 0) && (rand() % 3 == 0)) memcpy(P[i], P[rand() % i], m2 * sizeof(symbol));
+        else for (j = 0; j < m2; j++) P[i][j] = 'a' + rand() % s_sigma;
+    }
+    return P;
+}
+
+void match2d_test(int width, int height, int m1, int m2, int s_sigma) {
+    symbol **P = synthetic_tile(m1, m2, s_sigma);
+    symbol *T = synthetic_image(width, height, P, m1, m2, 20, s_sigma);
+    int i, n = width * height, offset = 0, location = 0, consumed = 0, block = 1;
+    int *correct = malloc(n * sizeof(int)), num_correct = naive_2d(T, width, height, P, m1, m2, correct);
+    assert(num_correct > 0);
+
+    match2d_state state = match2d_build(P, m1, m2, width, n, 0);
+    match_sink sink = matchsink_varint();
+    while (consumed < n) {
+        if (consumed + block > n) block = n - consumed;
+        consumed += match2d_stream_block(&state, &T[consumed], block, &sink);
+        block = (block * 7) % 501 + 1;
+    }
+    for (i = 0; varintsink_next(&sink, &offset, &location); i++) assert((i < num_correct) && (location == correct[i]));
+    assert(i == num_correct);
+    matchsink_free(&sink);
+    match2d_free(&state);
+
+    for (i = 0; i < m1; i++) free(P[i]);
+    free(P);
+    free(T);
+    free(correct);
+}
+
+void match2d_benchmark(int width, int height, int m1, int m2) {
+    symbol **P = synthetic_tile(m1, m2, 4);
+    symbol *T = synthetic_image(width, height, P, m1, m2, 100, 4);
+    int i, n = width * height;
+    match2d_state state = match2d_build(P, m1, m2, width, n, 0);
+    match_sink sink = matchsink_varint();
+    clock_t start = clock();
+    match2d_stream_block(&state, T, n, &sink);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%dx%d image, %dx%d tile: %d matches, %.2f Mpixel/s\n", width, height, m1, m2, sink.count, n / seconds / 1e6);
+    matchsink_free(&sink);
+    match2d_free(&state);
+    for (i = 0; i < m1; i++) free(P[i]);
+    free(P);
+    free(T);
+}
+
+int main(void) {
+    srand(1);
+    match2d_test(257, 200, 5, 7, 2);
+    match2d_test(100, 80, 1, 9, 2);
+    match2d_test(64, 300, 12, 1, 2);
+    match2d_test(300, 50, 3, 3, 3);
+    match2d_benchmark(1024, 1024, 8, 8);
+    match2d_benchmark(4096, 512, 32, 32);
+    return 0;
+}
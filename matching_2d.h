@@ -0,0 +1,205 @@
+/*
+    matching_2d.h
+    Streaming exact matching of a 2D pattern over a row-major text of known width, after Bird and Baker.
+    Each width-m2 window of a text row is fingerprinted and named by the pattern row it equals, if any. The names down each
+    column are then matched against the names of the pattern rows by a single KMP automaton, with one KMP index kept per
+    column. Space is O(m1 * m2) for the pattern plus one int per column of the text.
+*/
+
+#ifndef MATCHING_2D
+#define MATCHING_2D
+
+#include "karp_rabin.h"
+#include "kmp.h"
+#include "match_sink.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    typedef struct match2d_state
+    Structure for the current state of 2D matching.
+    Components:
+        int           m1          - Number of rows of the pattern
+        int           m2          - Number of columns of the pattern
+        int           width       - Number of columns of the text
+        int           row         - Current row of the text
+        int           col         - Current column of the text
+        int           distinct    - Number of distinct pattern rows. Also the name of a window matching no pattern row
+        fingerprinter printer     - The printer to use
+        fingerprint   *names      - Fingerprint of each distinct pattern row, indexed by name
+        int           *table      - Open-addressing table from fingerprint_hash to name, -1 if empty
+        int           table_mask  - Size of table - 1
+        fingerprint   *prefixes   - Prefix fingerprints of the last m2 characters of the text row, by column mod m2
+        fingerprint   T_cur       - The fingerprint of the character that just occured
+        fingerprint   window      - The fingerprint of the current window
+        fingerprint   tmp         - Temporary space
+        fingerprint   empty       - The empty fingerprint
+        kmp_state     column      - KMP for the names of the pattern rows
+        int           *column_i   - KMP index of each column of the text
+*/
+typedef struct {
+    int m1, m2, width, row, col, distinct, table_mask, *table, *column_i;
+    fingerprinter printer;
+    fingerprint *names, *prefixes, T_cur, window, tmp, empty;
+    kmp_state column;
+} match2d_state;
+
+/*
+    match2d_name
+    Looks up the name of a window.
+    Parameters:
+        match2d_state *state  - The state
+        fingerprint   window  - The fingerprint of the window
+    Returns int:
+        The name of the pattern row equal to the window, state->distinct if there is none
+*/
+int match2d_name(match2d_state *state, fingerprint window) {
+    int slot = fingerprint_hash(window) & state->table_mask;
+    while (state->table[slot] != -1) {
+        if (fingerprint_equals(state->names[state->table[slot]], window)) return state->table[slot];
+        slot = (slot + 1) & state->table_mask;
+    }
+    return state->distinct;
+}
+
+/*
+    match2d_build
+    Constructs a 2D matching state.
+    Parameters:
+        symbol **P     - The pattern, as m1 rows of m2 characters
+        int    m1      - Number of rows of the pattern
+        int    m2      - Number of columns of the pattern
+        int    width   - Number of columns of the text
+        int    n       - Number of characters in the text
+        int    alpha   - The level of accuracy desired
+    Returns match2d_state:
+        The initial state, at row 0 and column 0 of the text
+    Notes:
+        Names are used as symbols for the column KMP, so with SYMBOL_WIDTH 8 the pattern may have at most 127 distinct rows.
+*/
+match2d_state match2d_build(symbol **P, int m1, int m2, int width, int n, int alpha) {
+    match2d_state state;
+    int i, j, slot, size = 2;
+    symbol *column_P = malloc(m1 * sizeof(symbol)), *sigma;
+    state.m1 = m1;
+    state.m2 = m2;
+    state.width = width;
+    state.row = 0;
+    state.col = 0;
+    state.printer = fingerprinter_build(n, alpha);
+    state.T_cur = init_fingerprint();
+    state.window = init_fingerprint();
+    state.tmp = init_fingerprint();
+    state.empty = init_fingerprint();
+
+    while (size < m1 << 1) size <<= 1;
+    state.table_mask = size - 1;
+    state.table = malloc(size * sizeof(int));
+    for (i = 0; i < size; i++) state.table[i] = -1;
+    state.names = malloc(m1 * sizeof(fingerprint));
+    state.distinct = 0;
+    for (i = 0; i < m1; i++) {
+        set_fingerprint(state.printer, P[i], m2, state.window);
+        j = match2d_name(&state, state.window);
+        if (j == state.distinct) {
+            state.names[j] = init_fingerprint();
+            fingerprint_assign(state.window, state.names[j]);
+            slot = fingerprint_hash(state.window) & state.table_mask;
+            while (state.table[slot] != -1) slot = (slot + 1) & state.table_mask;
+            state.table[slot] = j;
+            state.distinct++;
+        }
+        column_P[i] = j;
+    }
+
+    sigma = malloc((state.distinct + 1) * sizeof(symbol));
+    for (i = 0; i <= state.distinct; i++) sigma[i] = i;
+    state.column = kmp_build(column_P, m1, m1, sigma, state.distinct + 1);
+    free(sigma);
+    free(column_P);
+
+    state.column_i = malloc(width * sizeof(int));
+    for (i = 0; i < width; i++) state.column_i[i] = -1;
+    state.prefixes = malloc(m2 * sizeof(fingerprint));
+    for (i = 0; i < m2; i++) state.prefixes[i] = init_fingerprint();
+    return state;
+}
+
+/*
+    match2d_stream
+    Performs the next round of 2D matching.
+    Parameters:
+        match2d_state *state - The current state
+        symbol        T_i    - The next character of the text
+    Returns int:
+        row * width + col if the pattern occurs with its bottom-right corner at (row, col)
+        -1 otherwise
+        Parameter state modified by reference to the next state of the algorithm.
+*/
+int match2d_stream(match2d_state *state, symbol T_i) {
+    int result = -1, col = state->col, slot = col % state->m2, name;
+    fingerprint *prefixes = state->prefixes;
+    set_fingerprint(state->printer, &T_i, 1, state->T_cur);
+    fingerprint_concat(state->printer, prefixes[(col) ? (col - 1) % state->m2 : state->m2 - 1], state->T_cur, state->tmp);
+
+    if (col >= state->m2 - 1) {
+        fingerprint_suffix(state->printer, state->tmp, prefixes[slot], state->window);
+        name = match2d_name(state, state->window);
+        state->column.i = state->column_i[col];
+        if (kmp_stream(&state->column, name, state->row) != -1) result = state->row * state->width + col;
+        state->column_i[col] = state->column.i;
+    }
+    fingerprint_assign(state->tmp, prefixes[slot]);
+
+    if (++state->col == state->width) {
+        state->col = 0;
+        state->row++;
+        for (slot = 0; slot < state->m2; slot++) fingerprint_assign(state->empty, prefixes[slot]);
+    }
+    return result;
+}
+
+/*
+    match2d_stream_block
+    Performs 2D matching on the next block of the text.
+    Parameters:
+        match2d_state *state - The current state
+        symbol        *T     - The next block of the text, continuing row-major from the last
+        int           l      - Length of the block
+        match_sink    *sink  - Destination for row * width + col of each match
+    Returns int:
+        Number of characters of T consumed. Less than l only if the sink reported it was full.
+*/
+int match2d_stream_block(match2d_state *state, symbol *T, int l, match_sink *sink) {
+    int i, result;
+    if (matchsink_full(sink)) return 0;
+    for (i = 0; i < l; i++) {
+        result = match2d_stream(state, T[i]);
+        if ((result != -1) && (matchsink_emit(sink, result))) return i + 1;
+    }
+    return l;
+}
+
+/*
+    match2d_free
+    Frees a 2D matching state from memory.
+    Parameters:
+        match2d_state *state - The state to free
+*/
+void match2d_free(match2d_state *state) {
+    int i;
+    for (i = 0; i < state->distinct; i++) fingerprint_free(state->names[i]);
+    for (i = 0; i < state->m2; i++) fingerprint_free(state->prefixes[i]);
+    free(state->names);
+    free(state->prefixes);
+    free(state->table);
+    free(state->column_i);
+    fingerprint_free(state->T_cur);
+    fingerprint_free(state->window);
+    fingerprint_free(state->tmp);
+    fingerprint_free(state->empty);
+    fingerprinter_free(state->printer);
+    kmp_free(&state->column);
+}
+
+#endif
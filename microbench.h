@@ -0,0 +1,117 @@
+/*
+    microbench.h
+    Harness for timing primitives in isolation.
+    Each benchmark is warmed up by doubling a batch of calls until one batch takes at least the minimum time, then timed
+    over a number of repetitions of that batch. The minimum, median, mean and standard deviation of the time per call are
+    written one row per benchmark as CSV, or as JSON lines with --json, for tracking across releases.
+    Usage: <program> [--json] [--quick] [--reps N]
+*/
+
+#ifndef MICROBENCH
+#define MICROBENCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/*
+    typedef struct microbench
+    Structure for the settings of a run of benchmarks.
+    Components:
+        char   *suite       - Name of the program, written on every row
+        int    json         - 1 to write JSON lines, 0 to write CSV
+        int    repetitions  - Number of timed batches
+        int    warmup       - Number of batches run and discarded after calibration
+        double batch_time   - Least time a batch should take, in seconds
+        int    rows         - Number of rows written so far
+*/
+typedef struct {
+    char *suite;
+    int json, repetitions, warmup, rows;
+    double batch_time;
+} microbench;
+
+double microbench_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int microbench_compare(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+    microbench_init
+    Reads the settings of a run from the command line.
+    Parameters:
+        int  argc  - Number of arguments
+        char **argv - The arguments
+        char *suite - Name of the program
+    Returns microbench:
+        The settings. --quick cuts the batch time and repetitions for smoke tests.
+*/
+microbench microbench_init(int argc, char **argv, char *suite) {
+    microbench bench = {suite, 0, 15, 3, 0, 1e-3};
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) bench.json = 1;
+        else if (!strcmp(argv[i], "--quick")) {
+            bench.repetitions = 3;
+            bench.warmup = 1;
+            bench.batch_time = 2e-5;
+        } else if ((!strcmp(argv[i], "--reps")) && (i + 1 < argc)) bench.repetitions = atoi(argv[++i]);
+    }
+    if (bench.repetitions < 1) bench.repetitions = 1;
+    return bench;
+}
+
+/*
+    microbench_run
+    Times one primitive and writes a row.
+    Parameters:
+        microbench *bench   - The settings
+        char       *backend - The backend or configuration the primitive runs on
+        char       *name    - The primitive
+        long       param    - A size the primitive was run at, such as a length or a number of keys
+        void       (*op)(void*, long) - Runs the primitive the given number of times
+        void       *data    - Passed through to op
+*/
+void microbench_run(microbench *bench, char *backend, char *name, long param, void (*op)(void *data, long count), void *data) {
+    double *times = malloc(bench->repetitions * sizeof(double)), start, elapsed, sum = 0, squares = 0, mean, median;
+    long batch = 1;
+    int i;
+    while (1) {
+        start = microbench_now();
+        op(data, batch);
+        elapsed = microbench_now() - start;
+        if ((elapsed >= bench->batch_time) || (batch >= 1L << 40)) break;
+        batch <<= 1;
+    }
+    for (i = 0; i < bench->warmup; i++) op(data, batch);
+    for (i = 0; i < bench->repetitions; i++) {
+        start = microbench_now();
+        op(data, batch);
+        times[i] = (microbench_now() - start) * 1e9 / batch;
+        sum += times[i];
+    }
+    mean = sum / bench->repetitions;
+    for (i = 0; i < bench->repetitions; i++) squares += (times[i] - mean) * (times[i] - mean);
+    qsort(times, bench->repetitions, sizeof(double), microbench_compare);
+    median = (bench->repetitions & 1) ? times[bench->repetitions >> 1] : (times[(bench->repetitions >> 1) - 1] + times[bench->repetitions >> 1]) / 2;
+
+    if (bench->json) {
+        printf("{\"suite\": \"%s\", \"backend\": \"%s\", \"name\": \"%s\", \"param\": %ld, \"repetitions\": %d, \"batch\": %ld, \"min_ns\": %.3f, \"median_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f}\n",
+            bench->suite, backend, name, param, bench->repetitions, batch, times[0], median, mean, sqrt(squares / bench->repetitions));
+    } else {
+        if (bench->rows == 0) printf("suite,backend,name,param,repetitions,batch,min_ns,median_ns,mean_ns,stddev_ns\n");
+        printf("%s,%s,%s,%ld,%d,%ld,%.3f,%.3f,%.3f,%.3f\n", bench->suite, backend, name, param, bench->repetitions, batch, times[0], median, mean, sqrt(squares / bench->repetitions));
+    }
+    bench->rows++;
+    free(times);
+}
+
+#endif
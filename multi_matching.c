@@ -0,0 +1,166 @@
+#include "multi_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks the multi-pattern search against a naive scan for patterns of mixed lengths, then times it for growing numbers of
+    same-length signatures against one fingerprint_match_verified per signature.
+    Usage: multi_matching [length] [most patterns] [signature length]
+*/
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    int *locations, *patterns, count;
+} match_list;
+
+void record_match(int pattern, int location, void *data) {
+    match_list *list = data;
+    list->locations[list->count] = location;
+    list->patterns[list->count++] = pattern;
+}
+
+void count_match(int pattern, int location, void *data) {
+    (*(long*)data)++;
+}
+
+symbol **make_patterns(int num_patterns, int *m, int s_sigma) {
+    symbol **P = malloc(num_patterns * sizeof(symbol*));
+    int i, j;
+    for (j = 0; j < num_patterns; j++) {
+        P[j] = malloc(m[j] * sizeof(symbol));
+        for (i = 0; i < m[j]; i++) P[j][i] = 'a' + rand() % s_sigma;
+    }
+    return P;
+}
+
+symbol *make_text(int n, symbol **P, int *m, int num_patterns, int copies, int s_sigma) {
+    symbol *T = malloc(n * sizeof(symbol));
+    int i, j;
+    for (i = 0; i < n; i++) T[i] = 'a' + rand() % s_sigma;
+    for (i = 0; i < copies; i++) {
+        j = rand() % num_patterns;
+        if (m[j] < n) memcpy(&T[rand() % (n - m[j])], P[j], m[j] * sizeof(symbol));
+    }
+    return T;
+}
+
+void free_patterns(symbol **P, int num_patterns) {
+    int j;
+    for (j = 0; j < num_patterns; j++) free(P[j]);
+    free(P);
+}
+
+/*
+    Every match must be found in order of location and, at one location, of length, with verification on or off.
+*/
+void multi_test(int n, int num_patterns, int s_sigma) {
+    int *m = malloc(num_patterns * sizeof(int)), i, j, k, verify, expected = 0;
+    for (j = 0; j < num_patterns; j++) m[j] = 1 + rand() % 12;
+    symbol **P = make_patterns(num_patterns, m, s_sigma);
+    if (num_patterns > 1) {
+        P[num_patterns - 1] = realloc(P[num_patterns - 1], m[0] * sizeof(symbol));
+        memcpy(P[num_patterns - 1], P[0], m[0] * sizeof(symbol));
+        m[num_patterns - 1] = m[0];
+    }
+    symbol *T = make_text(n, P, m, num_patterns, n / 20, s_sigma);
+    match_list list = {malloc(n * num_patterns * sizeof(int)), malloc(n * num_patterns * sizeof(int)), 0};
+    char *found = malloc(num_patterns);
+
+    for (verify = 0; verify <= 1; verify++) {
+        multi_matcher matcher = multimatch_build(P, m, num_patterns, verify);
+        list.count = 0;
+        assert(multimatch_run(&matcher, T, n, record_match, &list) == list.count);
+        for (k = 0, i = 0; i < n; i++) {
+            memset(found, 0, num_patterns);
+            for (; (k < list.count) && (list.locations[k] == i); k++) {
+                if (k > 0) assert((list.locations[k - 1] < i) || (m[list.patterns[k - 1]] <= m[list.patterns[k]]));
+                assert(!found[list.patterns[k]]);
+                found[list.patterns[k]] = 1;
+            }
+            for (j = 0; j < num_patterns; j++) {
+                assert(found[j] == ((i >= m[j] - 1) && (memcmp(&T[i - m[j] + 1], P[j], m[j] * sizeof(symbol)) == 0)));
+            }
+        }
+        assert(k == list.count);
+        if (verify) assert(list.count == expected);
+        else expected = list.count;
+        assert(matcher.candidates == list.count + matcher.false_positives);
+        multimatch_free(&matcher);
+    }
+    assert(expected > num_patterns);
+    free(m);
+    free_patterns(P, num_patterns);
+    free(T);
+    free(list.locations);
+    free(list.patterns);
+    free(found);
+}
+
+/*
+    Times one search for num_patterns signatures of length m over 26 symbols.
+*/
+double multi_time(int n, int num_patterns, int m, int verify, double *build, long *matches) {
+    int *lengths = malloc(num_patterns * sizeof(int)), j;
+    for (j = 0; j < num_patterns; j++) lengths[j] = m;
+    symbol **P = make_patterns(num_patterns, lengths, 26), *T = make_text(n, P, lengths, num_patterns, n / 1000, 26);
+    double start = now();
+    multi_matcher matcher = multimatch_build(P, lengths, num_patterns, verify);
+    *build = now() - start;
+    *matches = 0;
+    start = now();
+    multimatch_run(&matcher, T, n, count_match, matches);
+    double elapsed = now() - start;
+    multimatch_free(&matcher);
+    free_patterns(P, num_patterns);
+    free(lengths);
+    free(T);
+    return elapsed;
+}
+
+/*
+    Times fingerprint_match_verified for one signature of length m, averaged over a few.
+*/
+double single_time(int n, int m) {
+    int lengths[4] = {m, m, m, m}, *results = malloc(n * sizeof(int)), false_positives, j;
+    symbol sigma[26], **P = make_patterns(4, lengths, 26), *T = make_text(n, P, lengths, 4, n / 1000, 26);
+    match_sink sink = matchsink_array(results);
+    for (j = 0; j < 26; j++) sigma[j] = 'a' + j;
+    assert(m > 0);
+    double start = now();
+    for (j = 0; j < 4; j++) fingerprint_match_verified(T, n, P[j], m, sigma, 26, &sink, &false_positives);
+    double elapsed = (now() - start) / 4;
+    free_patterns(P, 4);
+    free(T);
+    free(results);
+    return elapsed;
+}
+
+void multi_benchmark(int n, int most, int m) {
+    int num_patterns;
+    long matches;
+    double build, elapsed, single = single_time(n, m);
+    printf("fingerprint_match_verified, one signature of %d symbols: %.1f ns/symbol\n", m, single * 1e9 / n);
+    for (num_patterns = 10; num_patterns <= most; num_patterns *= 10) {
+        elapsed = multi_time(n, num_patterns, m, 1, &build, &matches);
+        printf("%8d signatures: build %.3f s, %ld matches, %.1f ns/symbol verified", num_patterns, build, matches, elapsed * 1e9 / n);
+        elapsed = multi_time(n, num_patterns, m, 0, &build, &matches);
+        printf(", %.1f ns/symbol unverified (%.0fx faster than one pass per signature)\n", elapsed * 1e9 / n, single * num_patterns / elapsed);
+    }
+}
+
+int main(int argc, char **argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1 << 22, most = (argc > 2) ? atoi(argv[2]) : 1000000, m = (argc > 3) ? atoi(argv[3]) : 32;
+    srand(13);
+    multi_test(5000, 40, 2);
+    multi_test(20000, 300, 4);
+    multi_test(3000, 1, 3);
+    multi_benchmark(n, most, m);
+    return 0;
+}
@@ -0,0 +1,281 @@
+/*
+    multi_matching.h
+    Offline Rabin-Karp search for many patterns at once, such as blocklists of signatures.
+    Patterns are grouped by length. Each group holds the fingerprints of its patterns in an open-addressing table, fronted
+    by a bitmap small enough to stay in cache, and one window fingerprint per group is rolled across the text. Each
+    position costs one roll and one bitmap test per group, whatever the number of patterns, and a table probe only when
+    the bitmap bit is set.
+    Fingerprints are single words modulo the Mersenne prime 2^61 - 1 with a random base, as in exact_compile.h, so a pair
+    of different strings of length m collide with probability at most m/2^61. Matches can be verified against the text to
+    rule collisions out entirely.
+*/
+
+#ifndef MULTI_MATCHING
+#define MULTI_MATCHING
+
+#include "exact_compile.h"
+#include <stdint.h>
+
+#define MULTI_LOAD 2
+#define MULTI_FILTER_BITS 16
+#define MULTI_BATCH 256
+
+/*
+    typedef struct multi_entry
+    An entry of a group's table.
+    Components:
+        uint64_t key     - Fingerprint of the pattern, 2^61 - 1 if the entry is empty
+        int      pattern - Index of the pattern
+*/
+typedef struct {
+    uint64_t key;
+    int pattern;
+} multi_entry;
+
+/*
+    typedef struct multi_group
+    The patterns of one length.
+    Components:
+        int         m           - Length of the patterns
+        int         count       - Number of patterns
+        int         table_mask  - Size of table - 1, at least MULTI_LOAD times count
+        multi_entry *table      - Open-addressing table of fingerprints, indexed by their low bits
+        int         filter_bits - log_2 of the number of bits of filter
+        uint64_t    *filter     - Bit set for the high bits of each fingerprint, MULTI_FILTER_BITS bits per pattern
+        uint64_t    r_m         - r^m mod 2^61 - 1, to drop the symbol leaving the window
+*/
+typedef struct {
+    int m, count, table_mask;
+    multi_entry *table;
+    int filter_bits;
+    uint64_t *filter, r_m;
+} multi_group;
+
+/*
+    typedef struct multi_matcher
+    Structure for searching for many patterns.
+    Components:
+        int         num_patterns    - Number of patterns
+        int         num_groups      - Number of distinct lengths
+        multi_group *groups         - One group per length, in increasing order of length
+        symbol      *patterns       - The patterns, end to end
+        long        *offsets        - Start of each pattern in patterns
+        int         *m              - Length of each pattern
+        uint64_t    r               - Base of the fingerprints
+        int         verify          - 1 if fingerprint matches are checked against the text
+        long        candidates      - Fingerprint matches found by the last multimatch_run
+        long        false_positives - Candidates rejected by verification in the last multimatch_run
+*/
+typedef struct {
+    int num_patterns, num_groups;
+    multi_group *groups;
+    symbol *patterns;
+    long *offsets;
+    int *m;
+    uint64_t r;
+    int verify;
+    long candidates, false_positives;
+} multi_matcher;
+
+uint64_t multi_reduce(uint64_t s) {
+    s = (s & COMPILE_PRIME) + (s >> COMPILE_PRIME_BITS);
+    return (s >= COMPILE_PRIME) ? s - COMPILE_PRIME : s;
+}
+
+/*
+    multi_fingerprint
+    Fingerprints a string as the rolling windows of multimatch_run do.
+    Parameters:
+        uint64_t r - Base of the fingerprints
+        symbol   *S - The string
+        int      l - Length of the string
+    Returns uint64_t:
+        The sum of S[t] r^(l - 1 - t) mod 2^61 - 1
+*/
+uint64_t multi_fingerprint(uint64_t r, symbol *S, int l) {
+    uint64_t f = 0;
+    int t;
+    for (t = 0; t < l; t++) f = multi_reduce(compile_mul(f, r) + compile_value(S[t]));
+    return f;
+}
+
+void multi_insert(multi_group *group, uint64_t key, int pattern) {
+    int position = key & group->table_mask;
+    while (group->table[position].key != COMPILE_PRIME) position = (position + 1) & group->table_mask;
+    group->table[position].key = key;
+    group->table[position].pattern = pattern;
+    group->filter[key >> (COMPILE_PRIME_BITS - group->filter_bits) >> 6] |= (uint64_t)1 << ((key >> (COMPILE_PRIME_BITS - group->filter_bits)) & 63);
+}
+
+int multi_compare(const void *a, const void *b) {
+    long x = *(long*)a, y = *(long*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+    multimatch_build
+    Constructs a search for many patterns.
+    Parameters:
+        symbol **P          - The patterns. Copied
+        int    *m           - Length of each pattern, at least 1
+        int    num_patterns - Number of patterns
+        int    verify       - 1 to check every fingerprint match against the text, 0 to trust fingerprints
+    Returns multi_matcher:
+        The matcher
+    Notes:
+        Patterns are reported by their index in P. Duplicate patterns are each reported.
+*/
+multi_matcher multimatch_build(symbol **P, int *m, int num_patterns, int verify) {
+    multi_matcher matcher;
+    multi_group *group;
+    mpz_t bound, random;
+    long total = 0;
+    int i, j, t, *order = malloc(num_patterns * sizeof(int)), size, bits;
+    long *sorted = malloc(num_patterns * sizeof(long));
+
+    matcher.num_patterns = num_patterns;
+    matcher.verify = verify;
+    matcher.candidates = matcher.false_positives = 0;
+    matcher.m = malloc(num_patterns * sizeof(int));
+    matcher.offsets = malloc(num_patterns * sizeof(long));
+    memcpy(matcher.m, m, num_patterns * sizeof(int));
+    for (i = 0; i < num_patterns; i++) {
+        matcher.offsets[i] = total;
+        total += m[i];
+    }
+    matcher.patterns = malloc((total + 1) * sizeof(symbol));
+    for (i = 0; i < num_patterns; i++) memcpy(&matcher.patterns[matcher.offsets[i]], P[i], m[i] * sizeof(symbol));
+
+    mpz_init_set_ui(bound, COMPILE_PRIME - 2);
+    mpz_init(random);
+    random_below(random, bound);
+    matcher.r = mpz_get_ui(random) + 2;
+    mpz_clear(bound);
+    mpz_clear(random);
+
+    for (i = 0; i < num_patterns; i++) sorted[i] = ((long)m[i] << 32) | i;
+    qsort(sorted, num_patterns, sizeof(long), multi_compare);
+    for (i = 0; i < num_patterns; i++) order[i] = sorted[i] & 0xffffffff;
+    free(sorted);
+    matcher.num_groups = 0;
+    for (i = 0; i < num_patterns; i++) if ((i == 0) || (m[order[i]] != m[order[i - 1]])) matcher.num_groups++;
+    matcher.groups = malloc((matcher.num_groups + 1) * sizeof(multi_group));
+
+    for (i = 0, group = matcher.groups - 1; i < num_patterns; i = j) {
+        group++;
+        for (j = i; (j < num_patterns) && (m[order[j]] == m[order[i]]); j++);
+        group->m = m[order[i]];
+        group->count = j - i;
+        for (size = 1; size < MULTI_LOAD * group->count; size <<= 1);
+        group->table_mask = size - 1;
+        group->table = malloc(size * sizeof(multi_entry));
+        for (bits = 6; (1L << bits) < (long)MULTI_FILTER_BITS * group->count; bits++);
+        group->filter_bits = bits;
+        group->filter = calloc(1L << (bits - 6), sizeof(uint64_t));
+        for (t = 0; t < size; t++) group->table[t].key = COMPILE_PRIME;
+        group->r_m = 1;
+        for (t = 0; t < group->m; t++) group->r_m = compile_mul(group->r_m, matcher.r);
+        for (; i < j; i++) multi_insert(group, multi_fingerprint(matcher.r, P[order[i]], m[order[i]]), order[i]);
+    }
+    free(order);
+    return matcher;
+}
+
+/*
+    multimatch_probe
+    Reports every pattern of a group whose fingerprint is that of the window ending at a location.
+    Parameters:
+        multi_matcher *matcher                        - The matcher
+        multi_group   *group                          - The group
+        uint64_t      key                             - Fingerprint of the window
+        symbol        *T                              - The text
+        int           location                        - Index of the last symbol of the window
+        void          (*emit)(int, int, void*)        - Called with the pattern and location of each match
+        void          *data                           - Passed through to emit
+    Returns int:
+        Number of matches reported
+*/
+int multimatch_probe(multi_matcher *matcher, multi_group *group, uint64_t key, symbol *T, int location, void (*emit)(int pattern, int location, void *data), void *data) {
+    int position = key & group->table_mask, pattern, matches = 0;
+    while (group->table[position].key != COMPILE_PRIME) {
+        if (group->table[position].key == key) {
+            pattern = group->table[position].pattern;
+            matcher->candidates++;
+            if ((matcher->verify) && (memcmp(&T[location - group->m + 1], &matcher->patterns[matcher->offsets[pattern]], group->m * sizeof(symbol)) != 0)) matcher->false_positives++;
+            else {
+                emit(pattern, location, data);
+                matches++;
+            }
+        }
+        position = (position + 1) & group->table_mask;
+    }
+    return matches;
+}
+
+/*
+    multimatch_run
+    Searches a text for every pattern.
+    Parameters:
+        multi_matcher *matcher                        - The matcher
+        symbol        *T                              - The text
+        int           n                               - Length of the text
+        void          (*emit)(int, int, void*)        - Called with the pattern and location of each match
+        void          *data                           - Passed through to emit
+    Returns int:
+        Number of matches reported.
+    Notes:
+        Matches are reported in increasing order of location, the location being the index of the last symbol of the
+        occurance. Matches at one location are reported shortest pattern first.
+        The windows are rolled MULTI_BATCH positions at a time into a buffer before any are looked up, so the dependency
+        chain of the roll never waits on a cache miss in a filter, and the filter loads of a batch are independent.
+*/
+int multimatch_run(multi_matcher *matcher, symbol *T, int n, void (*emit)(int pattern, int location, void *data), void *data) {
+    uint64_t *keys = malloc((long)matcher->num_groups * MULTI_BATCH * sizeof(uint64_t)), key, window, r = matcher->r, r_m;
+    int start, l, i, g, m, shift, matches = 0;
+    multi_group *group;
+    matcher->candidates = matcher->false_positives = 0;
+    for (start = 0; start < n; start += l) {
+        l = (n - start < MULTI_BATCH) ? n - start : MULTI_BATCH;
+        for (g = 0; g < matcher->num_groups; g++) {
+            m = matcher->groups[g].m;
+            r_m = matcher->groups[g].r_m;
+            window = (start) ? keys[(long)g * MULTI_BATCH + MULTI_BATCH - 1] : 0;
+            for (i = start; i < start + l; i++) {
+                key = compile_mul(window, r) + compile_value(T[i]);
+                if (i >= m) key += COMPILE_PRIME - compile_mul(compile_value(T[i - m]), r_m);
+                keys[(long)g * MULTI_BATCH + i - start] = window = multi_reduce(key);
+            }
+        }
+        for (i = start; i < start + l; i++) {
+            for (g = 0; g < matcher->num_groups; g++) {
+                group = &matcher->groups[g];
+                if (i < group->m - 1) break;
+                key = keys[(long)g * MULTI_BATCH + i - start];
+                shift = COMPILE_PRIME_BITS - group->filter_bits;
+                if ((group->filter[key >> shift >> 6] >> ((key >> shift) & 63)) & 1) matches += multimatch_probe(matcher, group, key, T, i, emit, data);
+            }
+        }
+    }
+    free(keys);
+    return matches;
+}
+
+/*
+    multimatch_free
+    Frees a search for many patterns.
+    Parameters:
+        multi_matcher *matcher - The matcher to free
+*/
+void multimatch_free(multi_matcher *matcher) {
+    int g;
+    for (g = 0; g < matcher->num_groups; g++) {
+        free(matcher->groups[g].table);
+        free(matcher->groups[g].filter);
+    }
+    free(matcher->groups);
+    free(matcher->patterns);
+    free(matcher->offsets);
+    free(matcher->m);
+}
+
+#endif
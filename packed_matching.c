@@ -0,0 +1,142 @@
+#include "packed_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks matching on packed text against a naive scan of the unpacked text, for 1, 2 and 4 bits per symbol and pattern
+    lengths either side of the Shift-And and automaton limits, then times it against unpacking and calling
+    exactmatch_stream_block.
+    Usage: packed_matching [length]
+*/
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void make_alphabet(int bits, symbol *sigma) {
+    int c;
+    for (c = 0; c < (1 << bits); c++) sigma[c] = (bits == 2) ? "ACGT"[c] : 'a' + c;
+}
+
+/*
+    A text over the alphabet with copies of the pattern, some overlapping and some broken by one symbol.
+*/
+symbol *make_text(int n, symbol *P, int m, symbol *sigma, int s_sigma) {
+    symbol *T = malloc(n * sizeof(symbol));
+    int i;
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % s_sigma];
+    for (i = rand() % 50; i + m < n; i += m + rand() % (8 * m)) {
+        memcpy(&T[i], P, m * sizeof(symbol));
+        if (rand() % 3 == 0) i -= m / 2;
+        else if (rand() % 3 == 0) T[i + rand() % m] = sigma[rand() % s_sigma];
+    }
+    return T;
+}
+
+void packed_test(int bits, int m, int n) {
+    int s_sigma = 1 << bits, i, l, count = 0, location, *expected = malloc(n * sizeof(int)), *results = malloc(n * sizeof(int));
+    symbol sigma[16], *P = malloc(m * sizeof(symbol)), *T;
+    uint8_t *packed = malloc(packed_size(n, bits));
+    make_alphabet(bits, sigma);
+    for (i = 0; i < m; i++) P[i] = sigma[rand() % s_sigma];
+    T = make_text(n, P, m, sigma, s_sigma);
+    assert(packed_pack(T, n, sigma, s_sigma, bits, packed));
+    for (i = 0; i < n; i++) assert(sigma[packed_get(packed, i, bits)] == T[i]);
+    for (i = m - 1; i < n; i++) if (memcmp(&T[i - m + 1], P, m * sizeof(symbol)) == 0) expected[count++] = i;
+
+    if (m >= 3) {
+        exactmatch_state unpacked = exactmatch_build(P, m, sigma, s_sigma, n, 0);
+        match_sink sink = matchsink_array(results);
+        assert(exactmatch_stream_block(&unpacked, T, n, &sink) == n);
+        assert(sink.count == count);
+        for (i = 0; i < count; i++) assert(results[i] == expected[i]);
+        exactmatch_free(&unpacked);
+    }
+
+    packed_state state = packedmatch_build(P, m, sigma, s_sigma, bits, n, 0);
+    if (m + 8 / bits <= 65) assert(state.engine == PACKED_SHIFT_AND);
+    else assert(state.engine == (((m + 1) * 256 <= PACKED_DFA_ENTRIES) ? PACKED_DFA : PACKED_EXACT));
+    match_sink sink = matchsink_array(results);
+    for (i = 0; i < n; i += l) {
+        l = (rand() % 4) ? rand() % 200 : rand() % 5;
+        if (i + l > n) l = n - i;
+        assert(packedmatch_stream_block(&state, packed, i, l, &sink) == l);
+    }
+    assert(sink.count == count);
+    for (i = 0; i < count; i++) assert(results[i] == expected[i]);
+    packedmatch_free(&state);
+
+    if (count > 2) {
+        match_sink ring = matchsink_ring(2, NULL, NULL);
+        int consumed = 0, popped = 0;
+        state = packedmatch_build(P, m, sigma, s_sigma, bits, n, 0);
+        while (consumed < n) {
+            consumed += packedmatch_stream_block(&state, packed, consumed, n - consumed, &ring);
+            while (ringsink_pop(&ring, &location)) assert(location == expected[popped++]);
+        }
+        assert(popped == count);
+        matchsink_free(&ring);
+        packedmatch_free(&state);
+    }
+    free(P);
+    free(T);
+    free(packed);
+    free(expected);
+    free(results);
+}
+
+void packed_benchmark(int bits, int m, int n) {
+    int s_sigma = 1 << bits, i, l, *results = malloc(n * sizeof(int));
+    char *engines[3] = {"Shift-And", "automaton", "exact matching"};
+    symbol sigma[16], *P = malloc(m * sizeof(symbol)), *T, *buffer = malloc(PACKED_BUFFER * sizeof(symbol));
+    uint8_t *packed = malloc(packed_size(n, bits));
+    make_alphabet(bits, sigma);
+    for (i = 0; i < m; i++) P[i] = sigma[rand() % s_sigma];
+    T = make_text(n, P, m, sigma, s_sigma);
+    packed_pack(T, n, sigma, s_sigma, bits, packed);
+
+    exactmatch_state unpacked = exactmatch_build(P, m, sigma, s_sigma, n, 0);
+    match_sink unpacked_sink = matchsink_array(results);
+    double start = now();
+    for (i = 0; i < n; i += l) {
+        l = (n - i < PACKED_BUFFER) ? n - i : PACKED_BUFFER;
+        packed_unpack(packed, i, l, sigma, bits, buffer);
+        exactmatch_stream_block(&unpacked, buffer, l, &unpacked_sink);
+    }
+    double unpacked_time = now() - start;
+
+    packed_state state = packedmatch_build(P, m, sigma, s_sigma, bits, n, 0);
+    match_sink sink = matchsink_array(results);
+    start = now();
+    packedmatch_stream_block(&state, packed, 0, n, &sink);
+    double packed_time = now() - start;
+    assert(sink.count == unpacked_sink.count);
+
+    printf("%d bits, m = %3d, %s: %d symbols in %d bytes (%d as symbols), %d matches: unpack and exactmatch %.1f ns/symbol, packed %.2f ns/symbol (%.0fx)\n", bits, m, engines[state.engine], n, packed_size(n, bits), n * (int)sizeof(symbol), sink.count, unpacked_time * 1e9 / n, packed_time * 1e9 / n, unpacked_time / packed_time);
+    exactmatch_free(&unpacked);
+    packedmatch_free(&state);
+    free(P);
+    free(T);
+    free(buffer);
+    free(packed);
+    free(results);
+}
+
+int main(int argc, char **argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1 << 22, bits, i;
+    int lengths[13] = {1, 2, 3, 8, 20, 56, 57, 61, 63, 100, 500, 1023, 1024};
+    srand(11);
+    for (bits = 1; bits <= 4; bits <<= 1) {
+        for (i = 0; i < 13; i++) packed_test(bits, lengths[i], 20000);
+    }
+    packed_benchmark(2, 20, n);
+    packed_benchmark(2, 200, n);
+    packed_benchmark(2, 2000, n);
+    packed_benchmark(1, 32, n);
+    packed_benchmark(4, 12, n);
+    return 0;
+}
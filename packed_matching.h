@@ -0,0 +1,451 @@
+/*
+    packed_matching.h
+    Exact matching over text packed 1, 2 or 4 bits per symbol, e.g. DNA at 4 symbols per byte or binary telemetry at 8.
+    Each packed value is a code, the index of its symbol in the alphabet. Symbol i of the text is bits (i * bits) % 8
+    upwards of byte (i * bits) / 8, so the first symbol sits in the low bits.
+    Every engine reports the same locations as exact matching on the unpacked text:
+        PACKED_SHIFT_AND - Patterns short enough for one 64-bit word, a whole byte of the text per step: a table built with
+                           the pattern gives, for each byte value, the mask of pattern positions that survive all the
+                           symbols in it, and bits above the pattern collect the matches that end inside the byte.
+        PACKED_DFA       - Longer patterns, while KMP as an automaton over whole bytes fits in PACKED_DFA_ENTRIES: each
+                           entry holds the state after the byte and a bit for each symbol of it that ends a match.
+        PACKED_EXACT     - Anything longer unpacks each byte into a small buffer for exactmatch_stream_block, which saves
+                           the memory of unpacking the whole text but costs as much per symbol as exact matching on it.
+*/
+
+#ifndef PACKED_MATCHING
+#define PACKED_MATCHING
+
+#include "exact_matching.h"
+#include <stdint.h>
+
+#define PACKED_BUFFER 512
+
+#define PACKED_SHIFT_AND 0
+#define PACKED_DFA 1
+#define PACKED_EXACT 2
+
+/*
+    Tunable limits of packedmatch_build. Override with -D.
+    Components:
+        PACKED_DFA_ENTRIES - Most entries of the automaton over bytes, 1 MB of uint32_t, as PLAN_DFA_ENTRIES in planner.h
+*/
+#ifndef PACKED_DFA_ENTRIES
+#define PACKED_DFA_ENTRIES (1 << 18)
+#endif
+
+/*
+    typedef struct packed_state
+    Structure for exact matching on packed text.
+    Components:
+        int              bits      - Bits per symbol: 1, 2 or 4
+        int              per_byte  - Symbols per byte
+        int              m         - Length of the pattern
+        int              engine    - PACKED_SHIFT_AND, PACKED_DFA or PACKED_EXACT
+        int              position  - Index of the next symbol of the text
+        uint64_t         D         - Shift-And state: bit j is set if the pattern's first j + 1 symbols end at the last symbol read
+        uint64_t         keep      - The bits of D carried from one byte to the next
+        uint64_t         code[16]  - Shift-And mask for each code. Bits at or above m are all set
+        uint64_t         *table    - Shift-And mask for each byte value, 256 entries
+        int              q         - Automaton state: the number of symbols of the pattern matched. PACKED_DFA
+        int              *delta    - The automaton over codes, row per state, 1 << bits columns. PACKED_DFA
+        uint32_t         *dfa      - The automaton over bytes, row per state, 256 columns: next state << 8 | the bit
+                                     1 << h for each symbol h of the byte that ends a match. PACKED_DFA
+        symbol           *sigma    - The alphabet, indexed by code
+        int              s_sigma   - The size of the alphabet
+        symbol           *buffer   - PACKED_BUFFER unpacked symbols for exact matching
+        exactmatch_state matcher   - Exact matching. PACKED_EXACT
+*/
+typedef struct {
+    int bits, per_byte, m, engine, position;
+    uint64_t D, keep, code[16], *table;
+    int q, *delta;
+    uint32_t *dfa;
+    symbol *sigma;
+    int s_sigma;
+    symbol *buffer;
+    exactmatch_state matcher;
+} packed_state;
+
+/*
+    packed_size
+    Returns the number of bytes holding a packed text.
+    Parameters:
+        int n    - Number of symbols
+        int bits - Bits per symbol
+    Returns int:
+        The number of bytes
+*/
+int packed_size(int n, int bits) {
+    return (n * bits + 7) >> 3;
+}
+
+/*
+    packed_get
+    Returns the code of one symbol of a packed text.
+    Parameters:
+        uint8_t *packed - The packed text
+        int     i       - Index of the symbol
+        int     bits    - Bits per symbol
+    Returns int:
+        The code
+*/
+int packed_get(uint8_t *packed, int i, int bits) {
+    return (packed[(i * bits) >> 3] >> ((i * bits) & 7)) & ((1 << bits) - 1);
+}
+
+/*
+    packed_pack
+    Packs a text.
+    Parameters:
+        symbol  *T       - The text
+        int     n        - Length of the text
+        symbol  *sigma   - The alphabet, indexed by code
+        int     s_sigma  - The size of the alphabet, at most 1 << bits
+        int     bits     - Bits per symbol: 1, 2 or 4
+        uint8_t *packed  - packed_size(n, bits) bytes to write
+    Returns int:
+        1 if every symbol of T is in the alphabet
+        0 otherwise, and the symbols that are not are packed as code 0
+*/
+int packed_pack(symbol *T, int n, symbol *sigma, int s_sigma, int bits, uint8_t *packed) {
+    int i, c, valid = 1;
+    memset(packed, 0, packed_size(n, bits));
+    for (i = 0; i < n; i++) {
+        for (c = 0; (c < s_sigma) && (sigma[c] != T[i]); c++);
+        if (c == s_sigma) {
+            valid = 0;
+            c = 0;
+        }
+        packed[(i * bits) >> 3] |= c << ((i * bits) & 7);
+    }
+    return valid;
+}
+
+/*
+    packed_unpack
+    Unpacks symbols of a packed text.
+    Parameters:
+        uint8_t *packed - The packed text
+        int     from    - Index of the first symbol to unpack
+        int     l       - Number of symbols to unpack
+        symbol  *sigma  - The alphabet, indexed by code
+        int     bits    - Bits per symbol
+        symbol  *T      - l symbols to write
+*/
+void packed_unpack(uint8_t *packed, int from, int l, symbol *sigma, int bits, symbol *T) {
+    int i;
+    for (i = 0; i < l; i++) T[i] = sigma[packed_get(packed, from + i, bits)];
+}
+
+/*
+    packedmatch_build_dfa
+    Builds the automata of PACKED_DFA, KMP over codes and then over whole bytes.
+    Parameters:
+        packed_state *state   - The state to set up, with bits, per_byte and m set
+        symbol       *P       - The pattern
+        symbol       *sigma   - The alphabet, indexed by code
+        int          s_sigma  - The size of the alphabet
+    Returns void:
+        Parameter state modified by reference with q, delta and dfa.
+    Notes:
+        Takes (m + 1) * 256 * per_byte steps. Row m of delta is the row of the longest proper border of P, so matches may
+        overlap.
+*/
+void packedmatch_build_dfa(packed_state *state, symbol *P, symbol *sigma, int s_sigma) {
+    int m = state->m, k = state->per_byte, width = 1 << state->bits, i, j, b, c, x = 0, q, hits;
+    int *codes = malloc(m * sizeof(int));
+    for (j = 0; j < m; j++) {
+        for (c = 0; (c < s_sigma) && (sigma[c] != P[j]); c++);
+        codes[j] = (c < s_sigma) ? c : -1;
+    }
+    state->delta = calloc((long)(m + 1) * width, sizeof(int));
+    for (j = 0; j <= m; j++) {
+        if (j) memcpy(&state->delta[(long)j * width], &state->delta[(long)x * width], width * sizeof(int));
+        if ((j < m) && (codes[j] >= 0)) {
+            state->delta[(long)j * width + codes[j]] = j + 1;
+            if (j) x = state->delta[(long)x * width + codes[j]];
+        }
+    }
+    state->dfa = malloc((long)(m + 1) * 256 * sizeof(uint32_t));
+    for (i = 0; i <= m; i++) {
+        for (b = 0; b < 256; b++) {
+            q = i;
+            hits = 0;
+            for (j = 0; j < k; j++) {
+                q = state->delta[(long)q * width + ((b >> (j * state->bits)) & (width - 1))];
+                if (q == m) hits |= 1 << j;
+            }
+            state->dfa[((long)i << 8) + b] = ((uint32_t)q << 8) | hits;
+        }
+    }
+    state->q = 0;
+    free(codes);
+}
+
+/*
+    packedmatch_build
+    Constructs exact matching on packed text.
+    Parameters:
+        symbol *P      - The pattern
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet, indexed by code
+        int    s_sigma - The size of the alphabet, at most 1 << bits. Every code in the text must be below s_sigma
+        int    bits    - Bits per symbol: 1, 2 or 4
+        int    n       - The length of the text
+        int    alpha   - The level of accuracy desired, if exact matching is used
+    Returns packed_state:
+        The initial state
+    Notes:
+        Shift-And is used when the pattern and the matches ending inside one byte fit in 64 bits, i.e. m + 8 / bits <= 65.
+        Otherwise the automaton is used if its (m + 1) * 256 entries are at most PACKED_DFA_ENTRIES, so m below 1024 by
+        default, and exact matching if not, which is no faster than exactmatch_stream_block on the unpacked text.
+*/
+packed_state packedmatch_build(symbol *P, int m, symbol *sigma, int s_sigma, int bits, int n, int alpha) {
+    packed_state state;
+    int i, j, c, k;
+    uint64_t mask;
+    state.bits = bits;
+    state.per_byte = 8 / bits;
+    state.m = m;
+    state.position = 0;
+    state.sigma = malloc(s_sigma * sizeof(symbol));
+    memcpy(state.sigma, sigma, s_sigma * sizeof(symbol));
+    state.s_sigma = s_sigma;
+    if (m + state.per_byte <= 65) state.engine = PACKED_SHIFT_AND;
+    else if ((long)(m + 1) * 256 <= PACKED_DFA_ENTRIES) state.engine = PACKED_DFA;
+    else state.engine = PACKED_EXACT;
+    state.table = NULL;
+    state.delta = NULL;
+    state.dfa = NULL;
+    state.buffer = NULL;
+    if (state.engine == PACKED_EXACT) {
+        state.buffer = malloc(PACKED_BUFFER * sizeof(symbol));
+        state.matcher = exactmatch_build(P, m, sigma, s_sigma, n, alpha);
+        return state;
+    }
+    if (state.engine == PACKED_DFA) {
+        packedmatch_build_dfa(&state, P, sigma, s_sigma);
+        return state;
+    }
+
+    state.D = 0;
+    state.keep = (m == 64) ? ~(uint64_t)0 : ((uint64_t)1 << m) - 1;
+    for (c = 0; c < 16; c++) {
+        state.code[c] = ~state.keep;
+        for (j = 0; j < m; j++) if ((c < s_sigma) && (P[j] == sigma[c])) state.code[c] |= (uint64_t)1 << j;
+    }
+    state.table = malloc(256 * sizeof(uint64_t));
+    for (i = 0; i < 256; i++) {
+        mask = ~(uint64_t)0;
+        for (k = 0; k < state.per_byte; k++) {
+            c = (i >> (k * bits)) & ((1 << bits) - 1);
+            j = state.per_byte - 1 - k;
+            mask &= (state.code[c] << j) | (((uint64_t)1 << j) - 1);
+        }
+        state.table[i] = mask;
+    }
+    return state;
+}
+
+/*
+    packedmatch_symbol
+    Performs one Shift-And or automaton step.
+    Parameters:
+        packed_state *state - The current state
+        int          c      - Code of the next symbol of the text
+    Returns int:
+        1 if there is a match ending at the symbol
+        0 otherwise
+*/
+int packedmatch_symbol(packed_state *state, int c) {
+    if (state->engine == PACKED_DFA) {
+        state->q = state->delta[(long)state->q * (1 << state->bits) + c];
+        return state->q == state->m;
+    }
+    state->D = ((state->D << 1) | 1) & state->code[c] & state->keep;
+    return (state->D >> (state->m - 1)) & 1;
+}
+
+/*
+    packedmatch_byte
+    Performs Shift-And steps over a whole byte, stopping early if the sink fills.
+    Parameters:
+        packed_state *state - The current state, at the start of the byte
+        int          byte   - The byte
+        match_sink   *sink  - Destination for the location of each match
+        int          *full  - Set to 1 if the sink reported it was full
+    Returns int:
+        Number of symbols of the byte consumed, up to the match that filled the sink.
+*/
+int packedmatch_byte(packed_state *state, int byte, match_sink *sink, int *full) {
+    int k = state->per_byte, h, c;
+    uint64_t D = state->D, hits;
+    state->D = ((D << k) | (((uint64_t)1 << k) - 1)) & state->table[byte];
+    hits = (state->D >> (state->m - 1)) & (((uint64_t)1 << k) - 1);
+    state->D &= state->keep;
+    if (!hits) return k;
+    for (h = k - 1; h >= 0; h--) {
+        if (((hits >> h) & 1) && (matchsink_emit(sink, state->position + k - 1 - h))) {
+            *full = 1;
+            if (h == 0) return k;
+            state->D = D;
+            for (c = 0; c < k - h; c++) packedmatch_symbol(state, (byte >> (c * state->bits)) & ((1 << state->bits) - 1));
+            return k - h;
+        }
+    }
+    return k;
+}
+
+/*
+    packedmatch_dfa_byte
+    Performs automaton steps over a whole byte, stopping early if the sink fills.
+    Parameters:
+        packed_state *state - The current state, at the start of the byte
+        int          byte   - The byte
+        match_sink   *sink  - Destination for the location of each match
+        int          *full  - Set to 1 if the sink reported it was full
+    Returns int:
+        Number of symbols of the byte consumed, up to the match that filled the sink.
+*/
+int packedmatch_dfa_byte(packed_state *state, int byte, match_sink *sink, int *full) {
+    int k = state->per_byte, h, c, q = state->q;
+    uint32_t entry = state->dfa[((long)q << 8) + byte];
+    state->q = entry >> 8;
+    for (h = 0; h < k; h++) {
+        if (((entry >> h) & 1) && (matchsink_emit(sink, state->position + h))) {
+            *full = 1;
+            if (h == k - 1) return k;
+            state->q = q;
+            for (c = 0; c <= h; c++) packedmatch_symbol(state, (byte >> (c * state->bits)) & ((1 << state->bits) - 1));
+            return h + 1;
+        }
+    }
+    return k;
+}
+
+/*
+    packedmatch_stream_symbols
+    Performs exact matching one symbol at a time, for the ends of a block that do not fill a byte and for PACKED_EXACT.
+    Parameters:
+        packed_state *state  - The current state
+        uint8_t      *packed - The packed text
+        int          from    - Index in packed of the first symbol
+        int          l       - Number of symbols
+        match_sink   *sink   - Destination for the location of each match
+        int          *full   - Set to 1 if the sink reported it was full
+    Returns int:
+        Number of symbols consumed, up to the match that filled the sink.
+*/
+int packedmatch_stream_symbols(packed_state *state, uint8_t *packed, int from, int l, match_sink *sink, int *full) {
+    int i, chunk, consumed;
+    if (state->engine != PACKED_EXACT) {
+        for (i = 0; i < l; i++) {
+            state->position++;
+            if ((packedmatch_symbol(state, packed_get(packed, from + i, state->bits))) && (matchsink_emit(sink, state->position - 1))) {
+                *full = 1;
+                return i + 1;
+            }
+        }
+        return l;
+    }
+    for (i = 0; i < l; i += chunk) {
+        chunk = (l - i < PACKED_BUFFER) ? l - i : PACKED_BUFFER;
+        packed_unpack(packed, from + i, chunk, state->sigma, state->bits, state->buffer);
+        consumed = exactmatch_stream_block(&state->matcher, state->buffer, chunk, sink);
+        state->position += consumed;
+        if ((consumed < chunk) || (matchsink_full(sink))) {
+            *full = 1;
+            return i + consumed;
+        }
+    }
+    return l;
+}
+
+/*
+    packedmatch_stream_block
+    Performs exact matching on the next block of a packed text.
+    Parameters:
+        packed_state *state  - The current state
+        uint8_t      *packed - The packed text
+        int          from    - Index in packed of the first symbol of the block
+        int          l       - Number of symbols in the block
+        match_sink   *sink   - Destination for the location of each match
+    Returns int:
+        Number of symbols consumed. Less than l only if the sink reported it was full.
+        Parameter state modified by reference to the next state.
+    Notes:
+        Blocks may start and end part way into a byte. Once the sink has room again, resume from symbol from plus the
+        number consumed.
+*/
+int packedmatch_stream_block(packed_state *state, uint8_t *packed, int from, int l, match_sink *sink) {
+    int head, b, bytes, consumed, full = 0, k = state->per_byte, position, q;
+    uint64_t D, next, *table = state->table, low = ((uint64_t)1 << k) - 1, hits;
+    uint32_t entry, *dfa = state->dfa;
+    if (matchsink_full(sink)) return 0;
+    if (state->engine == PACKED_EXACT) return packedmatch_stream_symbols(state, packed, from, l, sink, &full);
+    head = (k - from % k) % k;
+    if (head > l) head = l;
+    consumed = packedmatch_stream_symbols(state, packed, from, head, sink, &full);
+    if (full) return consumed;
+    packed += (from + head) / k;
+    bytes = (l - head) / k;
+    position = state->position;
+    if (state->engine == PACKED_DFA) {
+        q = state->q;
+        for (b = 0; b < bytes; b++) {
+            entry = dfa[((long)q << 8) + packed[b]];
+            if (!(entry & 0xff)) {
+                q = entry >> 8;
+                continue;
+            }
+            state->q = q;
+            state->position = position + b * k;
+            consumed = packedmatch_dfa_byte(state, packed[b], sink, &full);
+            state->position += consumed;
+            if (full) return head + b * k + consumed;
+            q = state->q;
+        }
+        state->q = q;
+        state->position = position + bytes * k;
+        return head + bytes * k + packedmatch_stream_symbols(state, &packed[bytes], 0, l - head - bytes * k, sink, &full);
+    }
+    hits = low << (state->m - 1);
+    D = state->D;
+    for (b = 0; b < bytes; b++) {
+        next = ((D << k) | low) & table[packed[b]];
+        if (!(next & hits)) {
+            D = next & state->keep;
+            continue;
+        }
+        state->D = D;
+        state->position = position + b * k;
+        consumed = packedmatch_byte(state, packed[b], sink, &full);
+        state->position += consumed;
+        if (full) return head + b * k + consumed;
+        D = state->D;
+    }
+    state->D = D;
+    state->position = position + bytes * k;
+    return head + bytes * k + packedmatch_stream_symbols(state, &packed[bytes], 0, l - head - bytes * k, sink, &full);
+}
+
+/*
+    packedmatch_free
+    Frees exact matching on packed text.
+    Parameters:
+        packed_state *state - The state to free
+*/
+void packedmatch_free(packed_state *state) {
+    if (state->engine == PACKED_SHIFT_AND) free(state->table);
+    else if (state->engine == PACKED_DFA) {
+        free(state->delta);
+        free(state->dfa);
+    } else {
+        exactmatch_free(&state->matcher);
+        free(state->buffer);
+    }
+    free(state->sigma);
+}
+
+#endif
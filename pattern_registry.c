@@ -0,0 +1,354 @@
+#include "pattern_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks the pattern registry against a naive scan, with updates between blocks and from a second thread, then measures
+    the time the ingest thread takes per block with and without a thread churning the patterns, and with the patterns held
+    under a mutex and rebuilt for contrast.
+    Usage: pattern_registry [length] [block] [microseconds between updates]
+*/
+
+#define NUM_PERSISTENT 4
+#define NUM_CHURN 8
+#define PATTERN_LENGTH 24
+
+symbol sigma[2] = {'a', 'b'};
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    symbol *T, **P;
+    int *m, *started, *ended, *last, *counts;
+    int max_id;
+} registry_check;
+
+int occurs(symbol *T, symbol *P, int m, int location) {
+    return (location >= m - 1) && (memcmp(&T[location - m + 1], P, m * sizeof(symbol)) == 0);
+}
+
+int count_occurances(symbol *T, symbol *P, int m, int from, int to) {
+    int i, count = 0;
+    for (i = from + m - 1; i < to; i++) count += occurs(T, P, m, i);
+    return count;
+}
+
+/*
+    Every match must be real, start no earlier than the pattern did, and come after the last one of its pattern.
+*/
+void check_match(int pattern, int location, void *data) {
+    registry_check *check = data;
+    assert((pattern >= 0) && (pattern < check->max_id));
+    assert(occurs(check->T, check->P[pattern], check->m[pattern], location));
+    assert(location > check->last[pattern]);
+    check->last[pattern] = location;
+    check->counts[pattern]++;
+}
+
+symbol *make_text(int n, symbol **P, int *m, int num_patterns) {
+    symbol *T = malloc(n * sizeof(symbol));
+    int i, j;
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 2];
+    for (j = 0; j < num_patterns; j++) {
+        for (i = rand() % 500; i + m[j] < n; i += m[j] + rand() % (20 * m[j])) memcpy(&T[i], P[j], m[j] * sizeof(symbol));
+    }
+    return T;
+}
+
+symbol **make_patterns(int num_patterns, int **m) {
+    symbol **P = malloc(num_patterns * sizeof(symbol*));
+    int i, j;
+    *m = malloc(num_patterns * sizeof(int));
+    for (j = 0; j < num_patterns; j++) {
+        (*m)[j] = PATTERN_LENGTH / 2 + rand() % PATTERN_LENGTH;
+        P[j] = malloc((*m)[j] * sizeof(symbol));
+        for (i = 0; i < (*m)[j]; i++) P[j][i] = sigma[rand() % 2];
+    }
+    return P;
+}
+
+void free_patterns(symbol **P, int *m, int num_patterns) {
+    int j;
+    for (j = 0; j < num_patterns; j++) free(P[j]);
+    free(P);
+    free(m);
+}
+
+registry_check check_build(symbol *T, symbol **P, int *m, int num_patterns) {
+    registry_check check = {T, P, m, malloc(num_patterns * sizeof(int)), malloc(num_patterns * sizeof(int)), malloc(num_patterns * sizeof(int)), calloc(num_patterns, sizeof(int)), num_patterns};
+    int j;
+    for (j = 0; j < num_patterns; j++) check.started[j] = check.ended[j] = check.last[j] = -1;
+    return check;
+}
+
+void check_free(registry_check *check) {
+    free(check->started);
+    free(check->ended);
+    free(check->last);
+    free(check->counts);
+}
+
+/*
+    Adds and removes patterns between blocks, so each is active over a known window of the text, and checks it reports
+    exactly the occurances inside that window, including those split across the blocks either side of another update.
+*/
+void registry_test(int n) {
+    int num_patterns = 12, *m, i, j, l, id, pending, added = 0, removed = 0;
+    symbol **P = make_patterns(num_patterns, &m), *T = make_text(n, P, m, num_patterns);
+    registry_check check = check_build(T, P, m, num_patterns);
+    pattern_registry *registry = registry_build(sigma, 2, n, 0);
+
+    for (i = 0, j = 0; i < n; i += l) {
+        if ((j < num_patterns) && (rand() % 3 == 0)) {
+            id = registry_add(registry, P[j], m[j]);
+            assert(id == j);
+            check.started[j++] = i;
+            added++;
+        }
+        if (rand() % 5 == 0) {
+            id = rand() % num_patterns;
+            if ((check.started[id] != -1) && (check.ended[id] == -1)) {
+                assert(registry_remove(registry, id));
+                check.ended[id] = i;
+                removed++;
+            }
+            else assert(!registry_remove(registry, id));
+        }
+        l = 1 + rand() % 700;
+        if (i + l > n) l = n - i;
+        registry_stream_block(registry, &T[i], l, check_match, &check);
+    }
+    for (j = 0; j < num_patterns; j++) {
+        if (check.started[j] == -1) continue;
+        assert(check.counts[j] == count_occurances(T, P[j], m[j], check.started[j], (check.ended[j] == -1) ? n : check.ended[j]));
+    }
+    assert(registry->updates == added + removed);
+
+    pthread_mutex_lock(&registry->update);
+    assert(registry_reclaim(registry) == 0);
+    pthread_mutex_unlock(&registry->update);
+    id = registry_add(registry, P[0], m[0]);
+    registry_remove(registry, id);
+    pthread_mutex_lock(&registry->update);
+    pending = registry_reclaim(registry);
+    pthread_mutex_unlock(&registry->update);
+    assert(pending == 2);
+    registry_stream_block(registry, T, 1, check_match, &check);
+    pthread_mutex_lock(&registry->update);
+    assert(registry_reclaim(registry) == 0);
+    registry_quiescent(registry);
+    pthread_mutex_unlock(&registry->update);
+
+    registry_free(registry);
+    check_free(&check);
+    free_patterns(P, m, num_patterns);
+    free(T);
+}
+
+typedef struct {
+    pattern_registry *registry;
+    symbol **P;
+    int *m, interval;
+    atomic_int done;
+    long updates;
+} churn_args;
+
+void pause_for(int microseconds) {
+    struct timespec t = {0, microseconds * 1000L};
+    nanosleep(&t, NULL);
+}
+
+/*
+    Swaps a churned pattern for another every interval microseconds until the ingest thread is done. Patterns
+    NUM_PERSISTENT to NUM_PERSISTENT + NUM_CHURN / 2 - 1 start in the registry with identifiers equal to their indices.
+*/
+void *churn_thread(void *arg) {
+    churn_args *args = arg;
+    int slots[NUM_CHURN / 2], ids[NUM_CHURN / 2], in_use[NUM_CHURN] = {0}, s, j;
+    unsigned int seed = 5;
+    for (s = 0; s < NUM_CHURN / 2; s++) {
+        slots[s] = ids[s] = NUM_PERSISTENT + s;
+        in_use[s] = 1;
+    }
+    while (!atomic_load_explicit(&args->done, memory_order_acquire)) {
+        s = rand_r(&seed) % (NUM_CHURN / 2);
+        do j = rand_r(&seed) % NUM_CHURN; while (in_use[j]);
+        in_use[slots[s] - NUM_PERSISTENT] = 0;
+        in_use[j] = 1;
+        assert(registry_remove(args->registry, ids[s]));
+        slots[s] = NUM_PERSISTENT + j;
+        ids[s] = registry_add(args->registry, args->P[slots[s]], args->m[slots[s]]);
+        args->updates++;
+        if (args->interval) pause_for(args->interval);
+    }
+    return NULL;
+}
+
+typedef struct {
+    symbol *T, **P;
+    int *m;
+    atomic_int invalid;
+    int counts[NUM_PERSISTENT];
+} churn_matches;
+
+/*
+    Under churn the identifier of a churned pattern is only known to the churn thread, so the ingest thread checks each
+    match is an occurance of some pattern, and counts matches of the persistent patterns, whose identifiers are 0 to
+    NUM_PERSISTENT - 1.
+*/
+void churn_match(int pattern, int location, void *data) {
+    churn_matches *matches = data;
+    int j, real = 0;
+    if (pattern < NUM_PERSISTENT) {
+        assert(occurs(matches->T, matches->P[pattern], matches->m[pattern], location));
+        matches->counts[pattern]++;
+        return;
+    }
+    for (j = NUM_PERSISTENT; j < NUM_PERSISTENT + NUM_CHURN; j++) real |= occurs(matches->T, matches->P[j], matches->m[j], location);
+    if (!real) atomic_fetch_add(&matches->invalid, 1);
+}
+
+typedef struct {
+    pattern_registry *registry;
+    symbol *T;
+    int n, block;
+    double *pauses;
+    void *matches;
+} ingest_args;
+
+/*
+    Streams the text in blocks through the registry, timing each block.
+*/
+void *ingest_thread(void *arg) {
+    ingest_args *args = arg;
+    double start;
+    int i;
+    for (i = 0; i < args->n; i += args->block) {
+        start = now();
+        registry_stream_block(args->registry, &args->T[i], (i + args->block < args->n) ? args->block : args->n - i, churn_match, args->matches);
+        args->pauses[i / args->block] = now() - start;
+    }
+    return NULL;
+}
+
+int compare_pause(const void *a, const void *b) {
+    double x = *(double*)a, y = *(double*)b;
+    return (x > y) - (x < y);
+}
+
+void print_pauses(char *name, double *pauses, int count, long updates) {
+    qsort(pauses, count, sizeof(double), compare_pause);
+    printf("%-20s %8ld updates  p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  max %8.1f us\n", name, updates, pauses[count / 2] * 1e6, pauses[(int)(count * 0.99)] * 1e6, pauses[(int)(count * 0.999)] * 1e6, pauses[count - 1] * 1e6);
+}
+
+/*
+    Streams the text through a registry holding the persistent patterns and half of the churned ones, optionally with the
+    churn thread running, and prints the distribution of the time per block.
+*/
+void registry_churn(char *name, int n, int block, int churn, int interval) {
+    int num_patterns = NUM_PERSISTENT + NUM_CHURN, *m, j, blocks = (n + block - 1) / block;
+    symbol **P = make_patterns(num_patterns, &m), *T = make_text(n, P, m, num_patterns);
+    double *pauses = malloc(blocks * sizeof(double));
+    churn_matches matches = {T, P, m, 0, {0}};
+    pattern_registry *registry = registry_build(sigma, 2, n, 0);
+    churn_args args = {registry, P, m, interval, 0, 0};
+    pthread_t ingest, churner;
+    for (j = 0; j < NUM_PERSISTENT + NUM_CHURN / 2; j++) assert(registry_add(registry, P[j], m[j]) == j);
+
+    ingest_args ingest_args = {registry, T, n, block, pauses, &matches};
+    if (churn) pthread_create(&churner, NULL, churn_thread, &args);
+    pthread_create(&ingest, NULL, ingest_thread, &ingest_args);
+    pthread_join(ingest, NULL);
+    atomic_store_explicit(&args.done, 1, memory_order_release);
+    if (churn) pthread_join(churner, NULL);
+
+    for (j = 0; j < NUM_PERSISTENT; j++) assert(matches.counts[j] == count_occurances(T, P[j], m[j], 0, n));
+    assert(atomic_load(&matches.invalid) == 0);
+    assert(registry->updates == NUM_PERSISTENT + NUM_CHURN / 2 + 2 * args.updates);
+    print_pauses(name, pauses, blocks, args.updates);
+
+    registry_free(registry);
+    free_patterns(P, m, num_patterns);
+    free(T);
+    free(pauses);
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    exactmatch_state *states;
+    int count, n;
+    symbol **P;
+    int *m, interval;
+    atomic_int done;
+    long updates;
+} locked_patterns;
+
+/*
+    The alternative: the patterns sit behind a mutex and an update tears down a matcher and builds a new one while
+    holding it.
+*/
+void *locked_churn_thread(void *arg) {
+    locked_patterns *patterns = arg;
+    unsigned int seed = 5;
+    int j, k;
+    while (!atomic_load_explicit(&patterns->done, memory_order_acquire)) {
+        j = NUM_PERSISTENT + rand_r(&seed) % NUM_CHURN;
+        k = NUM_PERSISTENT + rand_r(&seed) % (patterns->count - NUM_PERSISTENT);
+        pthread_mutex_lock(&patterns->lock);
+        exactmatch_free(&patterns->states[k]);
+        patterns->states[k] = exactmatch_build(patterns->P[j], patterns->m[j], sigma, 2, patterns->n, 0);
+        pthread_mutex_unlock(&patterns->lock);
+        patterns->updates++;
+        if (patterns->interval) pause_for(patterns->interval);
+    }
+    return NULL;
+}
+
+void locked_churn(int n, int block, int interval) {
+    int num_patterns = NUM_PERSISTENT + NUM_CHURN, *m, i, j, blocks = (n + block - 1) / block, l;
+    symbol **P = make_patterns(num_patterns, &m), *T = make_text(n, P, m, num_patterns);
+    double *pauses = malloc(blocks * sizeof(double)), start;
+    locked_patterns patterns = {PTHREAD_MUTEX_INITIALIZER, malloc((NUM_PERSISTENT + NUM_CHURN / 2) * sizeof(exactmatch_state)), NUM_PERSISTENT + NUM_CHURN / 2, n, P, m, interval, 0, 0};
+    pthread_t churner;
+    for (j = 0; j < patterns.count; j++) patterns.states[j] = exactmatch_build(P[j], m[j], sigma, 2, n, 0);
+
+    pthread_create(&churner, NULL, locked_churn_thread, &patterns);
+    for (i = 0; i < n; i += block) {
+        l = (i + block < n) ? block : n - i;
+        start = now();
+        pthread_mutex_lock(&patterns.lock);
+        for (j = 0; j < patterns.count; j++) {
+            exactmatch_state *state = &patterns.states[j];
+            int k;
+            for (k = 0; k < l; k++) exactmatch_stream(state, T[i + k]);
+        }
+        pthread_mutex_unlock(&patterns.lock);
+        pauses[i / block] = now() - start;
+    }
+    atomic_store_explicit(&patterns.done, 1, memory_order_release);
+    pthread_join(churner, NULL);
+    print_pauses("mutex and rebuild", pauses, blocks, patterns.updates);
+
+    for (j = 0; j < patterns.count; j++) exactmatch_free(&patterns.states[j]);
+    free(patterns.states);
+    free_patterns(P, m, num_patterns);
+    free(T);
+    free(pauses);
+}
+
+int main(int argc, char **argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1 << 19, block = (argc > 2) ? atoi(argv[2]) : 256, interval = (argc > 3) ? atoi(argv[3]) : 100;
+    srand(3);
+    registry_test(20000);
+    registry_test(3000);
+    registry_churn("registry", n, block, 0, interval);
+    registry_churn("registry, churning", n, block, 1, interval);
+    locked_churn(n, block, interval);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+    pattern_registry.h
+    A set of patterns that can be changed while one ingest thread is streaming text through it, in the style of
+    read-copy-update (RCU).
+    The ingest thread reads the current set through one atomic pointer per block, so it never waits. An update copies the
+    set, adds or drops one pattern and publishes the copy, then advances a grace-period counter. The matchers of the
+    patterns that stay are shared between the old and new sets, so any viable occurance already in their rows survives
+    the update. The old set, and a dropped pattern, are retired with the new value of the counter. At the end of every block
+    the ingest thread records the counter it started the block with, and a retired item is freed once that value has
+    reached the item's own: the ingest thread has then finished a block that began after the item was unpublished.
+    All building and freeing happens on the updating threads.
+*/
+
+#ifndef PATTERN_REGISTRY
+#define PATTERN_REGISTRY
+
+#include "exact_matching.h"
+#include "spsc_queue.h"
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+    typedef struct registry_pattern
+    Structure for one pattern of the registry.
+    Components:
+        int              id      - Identifier returned by registry_add
+        int              m       - Length of the pattern
+        int              started - 1 once the ingest thread has seen the pattern. Written only by the ingest thread
+        int              start   - Index of the text the pattern started matching from. Written only by the ingest thread
+        exactmatch_state matcher - The algorithm. Advanced only by the ingest thread
+*/
+typedef struct {
+    int id, m, started, start;
+    exactmatch_state matcher;
+} registry_pattern;
+
+/*
+    typedef struct registry_set
+    An immutable set of patterns, as published to the ingest thread.
+    Components:
+        int              count    - Number of patterns
+        registry_pattern **patterns - The patterns
+*/
+typedef struct {
+    int count;
+    registry_pattern **patterns;
+} registry_set;
+
+/*
+    typedef struct registry_retired
+    Something unpublished, waiting for the ingest thread to pass a grace period before it is freed.
+    Components:
+        long             epoch   - Value of the counter once it was unpublished
+        registry_set     *set    - The old set
+        registry_pattern *pattern - A dropped pattern, NULL if none
+*/
+typedef struct {
+    long epoch;
+    registry_set *set;
+    registry_pattern *pattern;
+} registry_retired;
+
+/*
+    typedef struct pattern_registry
+    Structure for the registry.
+    Components:
+        registry_set     *current      - The published set. Swapped atomically
+        atomic_long      epoch        - The grace-period counter, advanced by every update
+        atomic_long      reader_epoch - Value of epoch when the ingest thread began its last completed block
+        int              position     - Index of the next character of the text. Written only by the ingest thread
+        pthread_mutex_t  update       - Serialises the updating threads. Never taken by the ingest thread
+        symbol           *sigma       - The alphabet
+        int              s_sigma      - The size of the alphabet
+        int              n            - Length of the text
+        int              alpha        - Desired level of accuracy
+        int              next_id      - Identifier of the next pattern added
+        int              num_retired  - Number of retired items not yet freed
+        int              retired_size - Number of retired items allocated
+        registry_retired *retired     - The retired items, oldest first
+        long             updates      - Number of sets published
+        long             reclaimed    - Number of retired items freed
+*/
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic(registry_set*) current;
+    _Alignas(CACHE_LINE) atomic_long epoch;
+    _Alignas(CACHE_LINE) atomic_long reader_epoch;
+    int position;
+    _Alignas(CACHE_LINE) pthread_mutex_t update;
+    symbol *sigma;
+    int s_sigma, n, alpha, next_id, num_retired, retired_size;
+    registry_retired *retired;
+    long updates, reclaimed;
+} pattern_registry;
+
+/*
+    registry_build
+    Constructs an empty registry.
+    Parameters:
+        symbol *sigma  - The alphabet. Copied
+        int    s_sigma - The size of the alphabet
+        int    n       - Length of the text
+        int    alpha   - Desired level of accuracy
+    Returns pattern_registry *:
+        The registry
+*/
+pattern_registry *registry_build(symbol *sigma, int s_sigma, int n, int alpha) {
+    pattern_registry *registry = aligned_alloc(CACHE_LINE, sizeof(pattern_registry));
+    registry_set *empty = malloc(sizeof(registry_set));
+    empty->count = 0;
+    empty->patterns = NULL;
+    atomic_init(&registry->current, empty);
+    atomic_init(&registry->epoch, 0);
+    atomic_init(&registry->reader_epoch, 0);
+    registry->position = 0;
+    pthread_mutex_init(&registry->update, NULL);
+    registry->sigma = malloc(s_sigma * sizeof(symbol));
+    memcpy(registry->sigma, sigma, s_sigma * sizeof(symbol));
+    registry->s_sigma = s_sigma;
+    registry->n = n;
+    registry->alpha = alpha;
+    registry->next_id = 0;
+    registry->num_retired = 0;
+    registry->retired_size = 16;
+    registry->retired = malloc(registry->retired_size * sizeof(registry_retired));
+    registry->updates = 0;
+    registry->reclaimed = 0;
+    return registry;
+}
+
+void registry_set_free(registry_set *set) {
+    free(set->patterns);
+    free(set);
+}
+
+void registry_pattern_free(registry_pattern *pattern) {
+    exactmatch_free(&pattern->matcher);
+    free(pattern);
+}
+
+/*
+    registry_reclaim
+    Frees every retired item the ingest thread can no longer be using.
+    Parameters:
+        pattern_registry *registry - The registry
+    Returns int:
+        Number of retired items still waiting for a grace period
+    Notes:
+        Called by the updating threads, holding registry->update. Cheap when nothing is ready.
+*/
+int registry_reclaim(pattern_registry *registry) {
+    long passed = atomic_load_explicit(&registry->reader_epoch, memory_order_acquire);
+    int i, done = 0;
+    while ((done < registry->num_retired) && (registry->retired[done].epoch <= passed)) {
+        registry_set_free(registry->retired[done].set);
+        if (registry->retired[done].pattern) registry_pattern_free(registry->retired[done].pattern);
+        done++;
+    }
+    for (i = done; i < registry->num_retired; i++) registry->retired[i - done] = registry->retired[i];
+    registry->num_retired -= done;
+    registry->reclaimed += done;
+    return registry->num_retired;
+}
+
+/*
+    registry_publish
+    Replaces the published set and retires the old one.
+    Parameters:
+        pattern_registry *registry - The registry, with registry->update held
+        registry_set     *set      - The new set
+        registry_pattern *dropped  - A pattern in the old set but not the new one, NULL if none
+*/
+void registry_publish(pattern_registry *registry, registry_set *set, registry_pattern *dropped) {
+    registry_set *old = atomic_exchange_explicit(&registry->current, set, memory_order_acq_rel);
+    long epoch = atomic_fetch_add_explicit(&registry->epoch, 1, memory_order_acq_rel) + 1;
+    if (registry->num_retired == registry->retired_size) {
+        registry->retired_size <<= 1;
+        registry->retired = realloc(registry->retired, registry->retired_size * sizeof(registry_retired));
+    }
+    registry->retired[registry->num_retired].epoch = epoch;
+    registry->retired[registry->num_retired].set = old;
+    registry->retired[registry->num_retired++].pattern = dropped;
+    registry->updates++;
+    registry_reclaim(registry);
+}
+
+/*
+    registry_add
+    Adds a pattern, which starts matching from the next character the ingest thread reads after it picks up the new set.
+    Parameters:
+        pattern_registry *registry - The registry
+        symbol           *P        - The pattern
+        int              m         - Length of the pattern
+    Returns int:
+        Identifier of the pattern, passed to emit with each of its matches
+    Notes:
+        The matcher is built before the registry is locked, so concurrent updates only wait for each other's swaps.
+*/
+int registry_add(pattern_registry *registry, symbol *P, int m) {
+    registry_pattern *pattern = malloc(sizeof(registry_pattern));
+    registry_set *set = malloc(sizeof(registry_set)), *old;
+    pattern->m = m;
+    pattern->started = 0;
+    pattern->start = 0;
+    pattern->matcher = exactmatch_build(P, m, registry->sigma, registry->s_sigma, registry->n, registry->alpha);
+
+    pthread_mutex_lock(&registry->update);
+    pattern->id = registry->next_id++;
+    old = atomic_load_explicit(&registry->current, memory_order_relaxed);
+    set->count = old->count + 1;
+    set->patterns = malloc(set->count * sizeof(registry_pattern*));
+    if (old->count) memcpy(set->patterns, old->patterns, old->count * sizeof(registry_pattern*));
+    set->patterns[old->count] = pattern;
+    registry_publish(registry, set, NULL);
+    pthread_mutex_unlock(&registry->update);
+    return pattern->id;
+}
+
+/*
+    registry_remove
+    Drops a pattern. Its matcher is freed after a grace period.
+    Parameters:
+        pattern_registry *registry - The registry
+        int              id        - Identifier of the pattern
+    Returns int:
+        1 if the pattern was dropped
+        0 if there is no pattern with that identifier
+    Notes:
+        Matches the ingest thread finds in the block it is reading may still be reported.
+*/
+int registry_remove(pattern_registry *registry, int id) {
+    registry_set *set, *old;
+    int i, j;
+    pthread_mutex_lock(&registry->update);
+    old = atomic_load_explicit(&registry->current, memory_order_relaxed);
+    for (i = 0; (i < old->count) && (old->patterns[i]->id != id); i++);
+    if (i == old->count) {
+        pthread_mutex_unlock(&registry->update);
+        return 0;
+    }
+    set = malloc(sizeof(registry_set));
+    set->count = old->count - 1;
+    set->patterns = malloc((set->count + 1) * sizeof(registry_pattern*));
+    for (j = 0; j < old->count; j++) if (j != i) set->patterns[j - (j > i)] = old->patterns[j];
+    registry_publish(registry, set, old->patterns[i]);
+    pthread_mutex_unlock(&registry->update);
+    return 1;
+}
+
+/*
+    registry_stream_block
+    Streams the next block of the text through every published pattern. Called only by the ingest thread.
+    Parameters:
+        pattern_registry *registry                      - The registry
+        symbol           *T                             - The next block of the text
+        int              l                              - Length of the block
+        void             (*emit)(int, int, void*)       - Called with the pattern identifier and location of each match
+        void             *data                          - Passed through to emit
+    Returns int:
+        Number of matches reported.
+    Notes:
+        One atomic load of the counter and one of the set on entry and one atomic store on exit, whatever the updates.
+        Matches are reported pattern by pattern, each in increasing order of location.
+*/
+int registry_stream_block(pattern_registry *registry, symbol *T, int l, void (*emit)(int pattern, int location, void *data), void *data) {
+    long epoch = atomic_load_explicit(&registry->epoch, memory_order_acquire);
+    registry_set *set = atomic_load_explicit(&registry->current, memory_order_acquire);
+    int p, i, result, matches = 0;
+    for (p = 0; p < set->count; p++) {
+        registry_pattern *pattern = set->patterns[p];
+        if (!pattern->started) {
+            pattern->started = 1;
+            pattern->start = registry->position;
+        }
+        for (i = 0; i < l; i++) {
+            result = exactmatch_stream(&pattern->matcher, T[i]);
+            if (result != -1) {
+                emit(pattern->id, pattern->start + result, data);
+                matches++;
+            }
+        }
+    }
+    registry->position += l;
+    atomic_store_explicit(&registry->reader_epoch, epoch, memory_order_release);
+    return matches;
+}
+
+/*
+    registry_quiescent
+    Records that the ingest thread holds no set, so that updates can be reclaimed while it is idle. Called only by the
+    ingest thread, between blocks.
+    Parameters:
+        pattern_registry *registry - The registry
+*/
+void registry_quiescent(pattern_registry *registry) {
+    atomic_store_explicit(&registry->reader_epoch, atomic_load_explicit(&registry->epoch, memory_order_acquire), memory_order_release);
+}
+
+/*
+    registry_count
+    Number of patterns in the published set.
+    Parameters:
+        pattern_registry *registry - The registry
+    Returns int:
+        The number of patterns
+*/
+int registry_count(pattern_registry *registry) {
+    return atomic_load_explicit(&registry->current, memory_order_acquire)->count;
+}
+
+/*
+    registry_free
+    Frees a registry and every pattern in it. The ingest thread must have stopped.
+    Parameters:
+        pattern_registry *registry - The registry to free
+*/
+void registry_free(pattern_registry *registry) {
+    registry_set *set = atomic_load_explicit(&registry->current, memory_order_acquire);
+    int i;
+    registry_quiescent(registry);
+    registry_reclaim(registry);
+    for (i = 0; i < set->count; i++) registry_pattern_free(set->patterns[i]);
+    registry_set_free(set);
+    pthread_mutex_destroy(&registry->update);
+    free(registry->sigma);
+    free(registry->retired);
+    free(registry);
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+    perf_counters.h
+    Optional hardware performance counters for the matching hot paths, compiled in with -DEXACT_MATCHING_PERF.
+    Counts cycles, instructions, L1 data and last-level cache read misses and branch misses through perf_event_open, along
+    with the number of GMP allocations, for each stage: building, feeding blocks, and within each character the KMP prefix,
+    the fingerprint rows and the final KMP suffix. Without the flag every macro expands to nothing, so there is no cost.
+    Stage counters read the counters around every character, which slows matching by a few times; compare stages with each
+    other rather than with an uninstrumented build.
+*/
+
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS
+
+#define PERF_BUILD 0
+#define PERF_BLOCK 1
+#define PERF_KMP_PREFIX 2
+#define PERF_ROWS 3
+#define PERF_KMP_SUFFIX 4
+#define PERF_STAGES 5
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_L1_MISSES 2
+#define PERF_LLC_MISSES 3
+#define PERF_BRANCH_MISSES 4
+#define PERF_ALLOCATIONS 5
+#define PERF_EVENTS 6
+
+#ifdef EXACT_MATCHING_PERF
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+
+/*
+    typedef struct perf_stage
+    Structure for the totals of one stage.
+    Components:
+        long long counts[] - Total of each event, indexed by PERF_CYCLES etc
+        long      calls    - Number of times the stage ran
+        long      symbols  - Number of symbols the stage handled
+*/
+typedef struct {
+    long long counts[PERF_EVENTS];
+    long calls, symbols;
+} perf_stage;
+
+/*
+    Counter state shared by every matcher.
+        int        perf_opened        - 1 once perf_open has run
+        int        perf_leader        - File descriptor of the group, -1 if perf_event_open failed
+        int        perf_slot[]        - Position of each hardware event in a group read, -1 if it could not be opened
+        int        perf_opened_events - Number of hardware events in the group
+        long long  perf_allocations   - Number of GMP allocations and reallocations
+        perf_stage perf_stages[]      - Totals of each stage
+*/
+int perf_opened = 0, perf_leader = -1, perf_slot[PERF_ALLOCATIONS], perf_opened_events = 0;
+long long perf_allocations = 0;
+perf_stage perf_stages[PERF_STAGES];
+
+void *(*perf_gmp_alloc)(size_t);
+void *(*perf_gmp_realloc)(void*, size_t, size_t);
+void (*perf_gmp_free)(void*, size_t);
+
+void *perf_count_alloc(size_t size) {
+    perf_allocations++;
+    return perf_gmp_alloc(size);
+}
+
+void *perf_count_realloc(void *pointer, size_t old_size, size_t new_size) {
+    perf_allocations++;
+    return perf_gmp_realloc(pointer, old_size, new_size);
+}
+
+/*
+    perf_open
+    Opens the counters and starts counting GMP allocations.
+    Notes:
+        Called on first use. If perf_event_open is not permitted, a warning is printed once and only the GMP allocations,
+        calls and symbols are counted. Events the processor lacks read as zero.
+*/
+void perf_open() {
+    unsigned long long configs[PERF_ALLOCATIONS][2] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+    struct perf_event_attr attr;
+    int i, fd;
+    perf_opened = 1;
+    memset(perf_stages, 0, sizeof(perf_stages));
+    mp_get_memory_functions(&perf_gmp_alloc, &perf_gmp_realloc, &perf_gmp_free);
+    mp_set_memory_functions(perf_count_alloc, perf_count_realloc, perf_gmp_free);
+
+    for (i = 0; i < PERF_ALLOCATIONS; i++) {
+        perf_slot[i] = -1;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = configs[i][0];
+        attr.config = configs[i][1];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (perf_leader == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, perf_leader, 0);
+        if (fd == -1) continue;
+        if (perf_leader == -1) perf_leader = fd;
+        perf_slot[i] = perf_opened_events++;
+    }
+    if (perf_leader == -1) printf("Warning: perf_event_open unavailable. Only GMP allocations will be counted.\n");
+    else ioctl(perf_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/*
+    perf_read
+    Reads every counter.
+    Parameters:
+        long long *values - PERF_EVENTS values to set
+    Returns void:
+        Parameter values modified by reference to the current count of each event.
+*/
+void perf_read(long long *values) {
+    long long group[PERF_ALLOCATIONS + 1];
+    int i;
+    if (!perf_opened) perf_open();
+    if ((perf_leader == -1) || (read(perf_leader, group, sizeof(group)) <= 0)) group[0] = 0;
+    for (i = 0; i < PERF_ALLOCATIONS; i++) values[i] = ((perf_slot[i] == -1) || (group[0] == 0)) ? 0 : group[1 + perf_slot[i]];
+    values[PERF_ALLOCATIONS] = perf_allocations;
+}
+
+/*
+    perf_end
+    Adds the events since a reading to the totals of a stage.
+    Parameters:
+        int       stage   - The stage, PERF_BUILD etc
+        long long *start  - The reading taken at the start of the stage
+        long      symbols - Number of symbols the stage handled
+*/
+void perf_end(int stage, long long *start, long symbols) {
+    long long end[PERF_EVENTS];
+    int i;
+    perf_read(end);
+    for (i = 0; i < PERF_EVENTS; i++) perf_stages[stage].counts[i] += end[i] - start[i];
+    perf_stages[stage].calls++;
+    perf_stages[stage].symbols += symbols;
+}
+
+/*
+    perf_report
+    Prints the totals of every stage that ran, per symbol.
+    Parameters:
+        FILE *out - Where to print
+*/
+void perf_report(FILE *out) {
+    char *names[PERF_STAGES] = {"build", "block", "kmp prefix", "rows", "kmp suffix"};
+    int i;
+    perf_stage *s;
+    fprintf(out, "%-11s %10s %12s %10s %10s %6s %11s %11s %11s %10s\n", "stage", "calls", "symbols", "cycles/sym", "instr/sym", "IPC", "L1miss/sym", "LLCmiss/sym", "brmiss/sym", "alloc/sym");
+    for (i = 0; i < PERF_STAGES; i++) {
+        s = &perf_stages[i];
+        if (s->calls == 0) continue;
+        double per = (s->symbols) ? (double)s->symbols : 1.0;
+        fprintf(out, "%-11s %10ld %12ld %10.2f %10.2f %6.2f %11.4f %11.4f %11.4f %10.4f\n", names[i], s->calls, s->symbols,
+            s->counts[PERF_CYCLES] / per, s->counts[PERF_INSTRUCTIONS] / per,
+            (s->counts[PERF_CYCLES]) ? (double)s->counts[PERF_INSTRUCTIONS] / s->counts[PERF_CYCLES] : 0.0,
+            s->counts[PERF_L1_MISSES] / per, s->counts[PERF_LLC_MISSES] / per, s->counts[PERF_BRANCH_MISSES] / per, s->counts[PERF_ALLOCATIONS] / per);
+    }
+}
+
+/*
+    perf_reset
+    Clears the totals of every stage.
+*/
+void perf_reset() {
+    memset(perf_stages, 0, sizeof(perf_stages));
+}
+
+#define PERF_BEGIN(start) long long start[PERF_EVENTS]; perf_read(start)
+#define PERF_RESTART(start) perf_read(start)
+#define PERF_END(stage, start, symbols) perf_end(stage, start, symbols)
+#define PERF_REPORT(out) perf_report(out)
+#define PERF_RESET() perf_reset()
+
+#else
+
+#define PERF_BEGIN(start)
+#define PERF_RESTART(start)
+#define PERF_END(stage, start, symbols)
+#define PERF_REPORT(out)
+#define PERF_RESET()
+
+#endif
+
+#endif
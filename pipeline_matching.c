@@ -0,0 +1,51 @@
+#include "pipeline_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+    Checks that the pipelined stages give the same matches as exactmatch_stream, for texts fed in blocks of varying sizes.
+*/
+void pipeline_test(symbol *T, int n, symbol *P, int m, symbol *sigma, int s_sigma) {
+    int i, fed = 0, block = 1, num_correct = 0, offset = 0, location = 0;
+    int *correct = malloc(n * sizeof(int));
+    exactmatch_state state = exactmatch_build(P, m, sigma, s_sigma, n, 0);
+    for (i = 0; i < n; i++) if (exactmatch_stream(&state, T[i]) != -1) correct[num_correct++] = i;
+    assert(num_correct > 0);
+    exactmatch_free(&state);
+
+    state = exactmatch_build(P, m, sigma, s_sigma, n, 0);
+    exactmatch_pipeline *pipeline = exactmatch_pipeline_build(&state);
+    match_sink sink = matchsink_varint();
+    while (fed < n) {
+        if (fed + block > n) block = n - fed;
+        exactmatch_pipeline_stream_block(pipeline, &T[fed], block, &sink);
+        fed += block;
+        block = (block * 3) % 97 + 1;
+    }
+    exactmatch_pipeline_free(pipeline);
+    exactmatch_free(&state);
+
+    for (i = 0; varintsink_next(&sink, &offset, &location); i++) assert((i < num_correct) && (location == correct[i]));
+    assert(i == num_correct);
+    matchsink_free(&sink);
+    free(correct);
+}
+
+int main(void) {
+    int n = 20000, i, j;
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, *T = malloc(n * sizeof(symbol));
+    char *patterns[] = {"aaaaabbbbbcccccaaaaa", "aaaaabbbbbcccccaaaaaaaaaabbbbbcccccddddd", "abababababababababababababababac", "aaaaaaaaaaaaaaaaaaaa"};
+    srand(1);
+    for (j = 0; j < 4; j++) {
+        int m = strlen(patterns[j]);
+        symbol *P = malloc(m * sizeof(symbol));
+        for (i = 0; i < m; i++) P[i] = patterns[j][i];
+        for (i = 0; i < n; i++) T[i] = sigma[rand() % ((j == 3) ? 2 : 4)];
+        for (i = 0; i + m < n; i += m + rand() % (3 * m)) memcpy(&T[i], P, m * sizeof(symbol));
+        pipeline_test(T, n, P, m, sigma, 4);
+        free(P);
+    }
+    free(T);
+    return 0;
+}
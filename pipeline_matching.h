@@ -0,0 +1,208 @@
+/*
+    pipeline_matching.h
+    Pipeline-parallel exact matching of a single stream.
+    The KMP stage (last log_2(m) characters) and the fingerprint stage (fmatch_stream) of an exactmatch_state run on their own
+    threads. Their results are passed through SPSC queues to the calling thread, which reconciles them with the buffer exactly
+    as exactmatch_stream does. Throughput approaches that of the slower stage.
+*/
+
+#ifndef PIPELINE_MATCHING
+#define PIPELINE_MATCHING
+
+#include "exact_matching.h"
+#include "spsc_queue.h"
+#include <pthread.h>
+
+#define PIPELINE_QUEUE_SIZE 4096
+
+/*
+    typedef struct exactmatch_pipeline
+    Structure for a pipelined exact matching algorithm.
+    Components:
+        atomic_int       block           - Sequence number of the published block, -1 to stop the stages
+        atomic_int       kmp_progress    - Index of the text the KMP stage has reached
+        atomic_int       fmatch_progress - Index of the text the fingerprint stage has reached
+        exactmatch_state *state          - The algorithm being run
+        symbol           *T              - The published block
+        int              l               - Length of the published block
+        int              start           - Index of the text at the start of the block
+        spsc_queue       *kmp_hits       - Indices at which the KMP stage matched
+        spsc_queue       *fmatch_hits    - (index << 32 | result) for each result of the fingerprint stage
+        pthread_t        kmp_thread      - Thread running the KMP stage
+        pthread_t        fmatch_thread   - Thread running the fingerprint stage
+*/
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int block;
+    _Alignas(CACHE_LINE) atomic_int kmp_progress;
+    _Alignas(CACHE_LINE) atomic_int fmatch_progress;
+    _Alignas(CACHE_LINE) exactmatch_state *state;
+    symbol *T;
+    int l, start;
+    spsc_queue *kmp_hits, *fmatch_hits;
+    pthread_t kmp_thread, fmatch_thread;
+} exactmatch_pipeline;
+
+/*
+    pipeline_wait
+    Waits for a block after the last one a stage has seen.
+    Parameters:
+        exactmatch_pipeline *pipeline - The pipeline
+        int                 seen      - Sequence number of the last block seen
+    Returns int:
+        Sequence number of the new block, -1 if the stage should stop
+*/
+int pipeline_wait(exactmatch_pipeline *pipeline, int seen) {
+    int block;
+    while ((block = atomic_load_explicit(&pipeline->block, memory_order_acquire)) == seen) sched_yield();
+    return block;
+}
+
+void *pipeline_kmp_stage(void *data) {
+    exactmatch_pipeline *pipeline = data;
+    kmp_state *kmp = &pipeline->state->kmp;
+    symbol *T, *fold = pipeline->state->fold;
+    int block = 0, i, l, start, index;
+    while ((block = pipeline_wait(pipeline, block)) != -1) {
+        T = pipeline->T;
+        l = pipeline->l;
+        start = pipeline->start;
+        for (i = 0; i < l; i++) {
+            index = start + i;
+            if (kmp_stream(kmp, (fold) ? fold_symbol(fold, T[i]) : T[i], index) != -1) spscqueue_push(pipeline->kmp_hits, index);
+            atomic_store_explicit(&pipeline->kmp_progress, index + 1, memory_order_release);
+        }
+    }
+    return NULL;
+}
+
+void *pipeline_fmatch_stage(void *data) {
+    exactmatch_pipeline *pipeline = data;
+    fmatch_state *fmatch = &pipeline->state->fmatch;
+    symbol *T, *fold = pipeline->state->fold;
+    int block = 0, i, l, start, index, result;
+    while ((block = pipeline_wait(pipeline, block)) != -1) {
+        T = pipeline->T;
+        l = pipeline->l;
+        start = pipeline->start;
+        for (i = 0; i < l; i++) {
+            index = start + i;
+            result = fmatch_stream(fmatch, (fold) ? fold_symbol(fold, T[i]) : T[i], index);
+            if (result != -1) spscqueue_push(pipeline->fmatch_hits, ((int64_t)index << 32) | (uint32_t)result);
+            atomic_store_explicit(&pipeline->fmatch_progress, index + 1, memory_order_release);
+        }
+    }
+    return NULL;
+}
+
+/*
+    pipeline_fmatch_until
+    Moves the results of the fingerprint stage for indices before step into the buffer.
+    Parameters:
+        exactmatch_pipeline *pipeline - The pipeline
+        int                 step      - Index of the text to stop at
+    Returns int:
+        The result of the fingerprint stage at index step, not yet added to the buffer
+        -1 if there was none
+*/
+int pipeline_fmatch_until(exactmatch_pipeline *pipeline, int step) {
+    exactmatch_state *state = pipeline->state;
+    int64_t item;
+    int done, item_step, result;
+    while (1) {
+        done = atomic_load_explicit(&pipeline->fmatch_progress, memory_order_acquire) > step;
+        if (spscqueue_peek(pipeline->fmatch_hits, &item)) {
+            item_step = item >> 32;
+            result = (int)(uint32_t)item;
+            if (item_step > step) return -1;
+            spscqueue_pop(pipeline->fmatch_hits, &item);
+            if (item_step == step) return result;
+            state->buffer[result % state->lm] = result;
+        } else if (done) return -1;
+        else sched_yield();
+    }
+}
+
+/*
+    exactmatch_pipeline_build
+    Starts the stage threads for an exact matching algorithm.
+    Parameters:
+        exactmatch_state *state - The algorithm to run. Owned by the pipeline's threads until exactmatch_pipeline_free
+    Returns exactmatch_pipeline *:
+        The pipeline
+*/
+exactmatch_pipeline *exactmatch_pipeline_build(exactmatch_state *state) {
+    exactmatch_pipeline *pipeline = aligned_alloc(CACHE_LINE, sizeof(exactmatch_pipeline));
+    pipeline->state = state;
+    pipeline->kmp_hits = spscqueue_build(PIPELINE_QUEUE_SIZE);
+    pipeline->fmatch_hits = spscqueue_build(PIPELINE_QUEUE_SIZE);
+    atomic_init(&pipeline->block, 0);
+    atomic_init(&pipeline->kmp_progress, state->text_index);
+    atomic_init(&pipeline->fmatch_progress, state->text_index);
+    pthread_create(&pipeline->kmp_thread, NULL, pipeline_kmp_stage, pipeline);
+    pthread_create(&pipeline->fmatch_thread, NULL, pipeline_fmatch_stage, pipeline);
+    return pipeline;
+}
+
+/*
+    exactmatch_pipeline_stream_block
+    Performs exact matching on the next block of the text with the stages running in parallel.
+    Parameters:
+        exactmatch_pipeline *pipeline - The pipeline
+        symbol              *T        - The next block of the text
+        int                 l         - Length of the block
+        match_sink          *sink     - Destination for the location of each match
+    Returns int:
+        Number of matches.
+        Locations of matches passed to sink in increasing order. Identical to calling exactmatch_stream on every character.
+    Notes:
+        The whole block is always consumed; a sink reporting it is full does not stop the stages.
+*/
+int exactmatch_pipeline_stream_block(exactmatch_pipeline *pipeline, symbol *T, int l, match_sink *sink) {
+    exactmatch_state *state = pipeline->state;
+    int start = state->text_index, end = start + l, matches = 0, done, i, fmatch_result;
+    int64_t item;
+    if (l <= 0) return 0;
+
+    pipeline->T = T;
+    pipeline->l = l;
+    pipeline->start = start;
+    atomic_store_explicit(&pipeline->block, atomic_load_explicit(&pipeline->block, memory_order_relaxed) + 1, memory_order_release);
+
+    while (1) {
+        done = atomic_load_explicit(&pipeline->kmp_progress, memory_order_acquire) == end;
+        if (!spscqueue_pop(pipeline->kmp_hits, &item)) {
+            if (done) break;
+            sched_yield();
+            continue;
+        }
+        i = item;
+        fmatch_result = pipeline_fmatch_until(pipeline, i);
+        if ((i >= state->m) && ((state->buffer[i % state->lm] == i - state->lm) || (fmatch_result == i - state->lm))) {
+            matches++;
+            matchsink_emit(sink, i);
+        }
+        if (fmatch_result != -1) state->buffer[fmatch_result % state->lm] = fmatch_result;
+    }
+    fmatch_result = pipeline_fmatch_until(pipeline, end - 1);
+    if (fmatch_result != -1) state->buffer[fmatch_result % state->lm] = fmatch_result;
+
+    state->text_index = end;
+    return matches;
+}
+
+/*
+    exactmatch_pipeline_free
+    Stops the stage threads and frees a pipeline. The exactmatch_state is returned to the caller and not freed.
+    Parameters:
+        exactmatch_pipeline *pipeline - The pipeline to free
+*/
+void exactmatch_pipeline_free(exactmatch_pipeline *pipeline) {
+    atomic_store_explicit(&pipeline->block, -1, memory_order_release);
+    pthread_join(pipeline->kmp_thread, NULL);
+    pthread_join(pipeline->fmatch_thread, NULL);
+    spscqueue_free(pipeline->kmp_hits);
+    spscqueue_free(pipeline->fmatch_hits);
+    free(pipeline);
+}
+
+#endif
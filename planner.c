@@ -0,0 +1,148 @@
+#include "planner.h"
+#include "microbench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/*
+    Checks every engine against a naive search, then benchmarks them to tune the limits of planner.h.
+    Usage: planner [--json] [--quick] [--reps N]
+*/
+
+symbol plan_sigma[4] = {'a', 'b', 'c', 'd'};
+
+int naive_matches(symbol *T, int n, symbol *P, int m, int *correct) {
+    int i, count = 0;
+    for (i = m - 1; i < n; i++) if (memcmp(&T[i - m + 1], P, m * sizeof(symbol)) == 0) correct[count++] = i;
+    return count;
+}
+
+void engine_test(symbol *T, int n, symbol *P, int m, int s_sigma, int engine, int mode, int *correct, int num_correct) {
+    int i, consumed = 0, l, *results = malloc(n * sizeof(int));
+    match_plan plan = plan_pattern(P, m, s_sigma, mode);
+    plan.engine = engine;
+    matcher matcher = matcher_build_plan(plan, P, plan_sigma, n, 0);
+    match_sink sink = matchsink_array(results);
+    if (mode == PLAN_STREAM) {
+        for (i = 0; i < n; i++) if ((l = matcher_stream(&matcher, T[i])) != -1) matchsink_emit(&sink, l);
+    } else {
+        while (consumed < n) {
+            l = (mode == PLAN_OFFLINE) ? n : 1 + rand() % (2 * m + 10);
+            if (consumed + l > n) l = n - consumed;
+            consumed += matcher_stream_block(&matcher, &T[consumed], l, &sink);
+        }
+    }
+    assert(sink.count == num_correct);
+    for (i = 0; i < num_correct; i++) assert(results[i] == correct[i]);
+    matcher_free(&matcher);
+    free(results);
+}
+
+void planner_test(int m, int s_sigma, int periodic) {
+    int n = 20000, i, *correct = malloc(n * sizeof(int)), num_correct;
+    symbol *T = malloc(n * sizeof(symbol)), *P = malloc(m * sizeof(symbol));
+    for (i = 0; i < m; i++) P[i] = (periodic) ? plan_sigma[i % 3 % s_sigma] : plan_sigma[rand() % s_sigma];
+    for (i = 0; i < n; i++) T[i] = plan_sigma[rand() % s_sigma];
+    for (i = rand() % 50; i + m < n; i += m + rand() % (4 * m + 50)) memcpy(&T[i], P, m * sizeof(symbol));
+    num_correct = naive_matches(T, n, P, m, correct);
+    assert(num_correct > 0);
+
+    engine_test(T, n, P, m, s_sigma, ENGINE_MEMMEM, PLAN_OFFLINE, correct, num_correct);
+    engine_test(T, n, P, m, s_sigma, ENGINE_MEMMEM, PLAN_BLOCK, correct, num_correct);
+    engine_test(T, n, P, m, s_sigma, ENGINE_MEMMEM, PLAN_STREAM, correct, num_correct);
+    engine_test(T, n, P, m, s_sigma, ENGINE_DFA, PLAN_STREAM, correct, num_correct);
+    engine_test(T, n, P, m, s_sigma, ENGINE_DFA, PLAN_BLOCK, correct, num_correct);
+    if (m >= 4) {
+        engine_test(T, n, P, m, s_sigma, ENGINE_BG, PLAN_STREAM, correct, num_correct);
+        engine_test(T, n, P, m, s_sigma, ENGINE_BG, PLAN_BLOCK, correct, num_correct);
+    }
+    free(T);
+    free(P);
+    free(correct);
+}
+
+void plan_test() {
+    symbol *P = malloc(100000 * sizeof(symbol));
+    int i;
+    for (i = 0; i < 100000; i++) P[i] = plan_sigma[rand() % 4];
+    match_plan plan = plan_pattern(P, 4, 4, PLAN_OFFLINE);
+    assert(plan.engine == ENGINE_MEMMEM);
+    plan_explain(plan, stdout);
+    plan = plan_pattern(P, 64, 4, PLAN_BLOCK);
+    assert(plan.engine == ENGINE_MEMMEM);
+    plan_explain(plan, stdout);
+    plan = plan_pattern(P, 64, 4, PLAN_STREAM);
+    assert(plan.engine == ENGINE_DFA);
+    plan_explain(plan, stdout);
+    plan = plan_pattern(P, 100000, 4, PLAN_STREAM);
+    assert((plan.engine == ENGINE_BG) && (plan.period > 50000));
+    plan_explain(plan, stdout);
+    for (i = 0; i < 100000; i++) P[i] = plan_sigma[i % 3];
+    plan = plan_pattern(P, 100000, 4, PLAN_BLOCK);
+    assert((plan.engine == ENGINE_BG) && (plan.period == 3));
+    plan_explain(plan, stdout);
+    free(P);
+}
+
+/*
+    typedef struct engine_bench
+    Operands for benchmarking an engine.
+    Components:
+        matcher matcher - The matcher
+        symbol  *T      - A text of ENGINE_TEXT characters, fed in blocks of ENGINE_BLOCK
+        int     *results - Room for the matches of one block
+*/
+typedef struct {
+    matcher matcher;
+    symbol *T;
+    int *results;
+} engine_bench;
+
+#define ENGINE_TEXT 65536
+#define ENGINE_BLOCK 4096
+
+void engine_op(void *data, long count) {
+    engine_bench *b = data;
+    long fed = 0, l;
+    while (fed < count) {
+        match_sink sink = matchsink_array(b->results);
+        l = (count - fed < ENGINE_BLOCK) ? count - fed : ENGINE_BLOCK;
+        matcher_stream_block(&b->matcher, &b->T[fed & (ENGINE_TEXT - 1)], l, &sink);
+        fed += l;
+    }
+}
+
+/*
+    Benchmarks each engine on a pattern of length m, in nanoseconds per character.
+*/
+void engine_benchmark(microbench *bench, int m) {
+    char *names[3] = {"memmem", "dfa", "breslauer-galil"};
+    symbol *P = malloc(m * sizeof(symbol));
+    engine_bench b = {.T = malloc(ENGINE_TEXT * sizeof(symbol)), .results = malloc(ENGINE_BLOCK * sizeof(int))};
+    int i, engine;
+    for (i = 0; i < m; i++) P[i] = plan_sigma[rand() % 4];
+    for (i = 0; i < ENGINE_TEXT; i++) b.T[i] = plan_sigma[rand() % 4];
+    for (engine = ENGINE_MEMMEM; engine <= ENGINE_BG; engine++) {
+        match_plan plan = plan_pattern(P, m, 4, PLAN_BLOCK);
+        plan.engine = engine;
+        b.matcher = matcher_build_plan(plan, P, plan_sigma, 1 << 30, 0);
+        microbench_run(bench, "block", names[engine], m, engine_op, &b);
+        matcher_free(&b.matcher);
+    }
+    free(P);
+    free(b.T);
+    free(b.results);
+}
+
+int main(int argc, char **argv) {
+    microbench bench = microbench_init(argc, argv, "planner");
+    int lengths[5] = {4, 16, 64, 256, 1024}, i;
+    srand(4);
+    for (i = 1; i <= 9; i++) planner_test(i, 2, 0);
+    planner_test(64, 4, 0);
+    planner_test(300, 2, 0);
+    planner_test(40, 3, 1);
+    plan_test();
+    for (i = 0; i < 5; i++) engine_benchmark(&bench, lengths[i]);
+    return 0;
+}
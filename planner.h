@@ -0,0 +1,379 @@
+/*
+    planner.h
+    Chooses a matching engine for a pattern and runs it behind one interface.
+    Engines:
+        ENGINE_MEMMEM - memmem from the C library (Two-Way, vectorised in glibc). Offline, or blocks with the last m - 1 symbols
+                        carried over, so it cannot take one character at a time.
+        ENGINE_DFA    - KMP as a dense automaton of (m + 1) * (s_sigma + 1) ints, one table lookup per character.
+        ENGINE_BG     - exactmatch_state, Breslauer and Galil in O(log(m)) space. Falls back to compressed KMP itself when
+                        the pattern is periodic.
+    The planner prefers them in that order, subject to the input mode and PLAN_DFA_ENTRIES and PLAN_CARRY_MAX.
+*/
+
+#ifndef PLANNER
+#define PLANNER
+
+#include "exact_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _GNU_SOURCE
+void *memmem(const void *haystack, size_t haystack_len, const void *needle, size_t needle_len);
+#endif
+
+#define ENGINE_MEMMEM 0
+#define ENGINE_DFA 1
+#define ENGINE_BG 2
+
+#define PLAN_STREAM 0
+#define PLAN_BLOCK 1
+#define PLAN_OFFLINE 2
+
+/*
+    Limits of the planner, tuned with planner.c (8-bit symbols, 4-letter alphabet, 4096-symbol blocks). Per character, memmem
+    took 0.5-2 ns up to m = 256 and 4 ns at m = 1024 as the carried symbols grew, the automaton about 7 ns at every m and
+    exactmatch_state about 900 ns.
+        PLAN_DFA_ENTRIES - Most entries of an automaton, 1 MB of ints, so that it stays in a typical L2 cache
+        PLAN_CARRY_MAX   - Longest pattern for memmem over blocks. Each block costs O(m) more for the symbols carried over
+*/
+#ifndef PLAN_DFA_ENTRIES
+#define PLAN_DFA_ENTRIES (1 << 18)
+#endif
+#ifndef PLAN_CARRY_MAX
+#define PLAN_CARRY_MAX 4096
+#endif
+
+/*
+    typedef struct match_plan
+    Structure for the decision of the planner.
+    Components:
+        int  engine     - ENGINE_MEMMEM, ENGINE_DFA or ENGINE_BG
+        int  mode       - PLAN_STREAM, PLAN_BLOCK or PLAN_OFFLINE
+        int  m          - Length of the pattern
+        int  s_sigma    - Size of the alphabet
+        int  period     - Length of the shortest period of the pattern
+        long memory     - Bytes held by the engine once built, 0 until then
+        char reason[]   - Why the engine was chosen
+*/
+typedef struct {
+    int engine, mode, m, s_sigma, period;
+    long memory;
+    char reason[160];
+} match_plan;
+
+/*
+    pattern_period
+    Finds the shortest period of a pattern.
+    Parameters:
+        symbol *P - The pattern
+        int    m  - Length of the pattern
+    Returns int:
+        The least p > 0 such that P[i] = P[i + p] for all i < m - p
+*/
+int pattern_period(symbol *P, int m) {
+    int *failure = malloc(m * sizeof(int)), i = -1, j, result;
+    failure[0] = -1;
+    for (j = 1; j < m; j++) {
+        while ((i > -1) && (P[i + 1] != P[j])) i = failure[i];
+        if (P[i + 1] == P[j]) i++;
+        failure[j] = i;
+    }
+    result = m - failure[m - 1] - 1;
+    free(failure);
+    return result;
+}
+
+/*
+    plan_pattern
+    Chooses an engine.
+    Parameters:
+        symbol *P       - The pattern
+        int    m        - Length of the pattern
+        int    s_sigma  - Size of the alphabet
+        int    mode     - PLAN_STREAM if the text arrives one character at a time, PLAN_BLOCK if in blocks, PLAN_OFFLINE if whole
+    Returns match_plan:
+        The plan. Offline text always uses memmem. Blocks use memmem for patterns up to PLAN_CARRY_MAX. Otherwise the
+        automaton is used if it has at most PLAN_DFA_ENTRIES entries, and Breslauer and Galil if not.
+*/
+match_plan plan_pattern(symbol *P, int m, int s_sigma, int mode) {
+    match_plan plan = {ENGINE_BG, mode, m, s_sigma, pattern_period(P, m), 0, ""};
+    long entries = (long)(m + 1) * (s_sigma + 1);
+    if (mode == PLAN_OFFLINE) {
+        plan.engine = ENGINE_MEMMEM;
+        snprintf(plan.reason, sizeof(plan.reason), "offline text, memmem needs no preprocessing state");
+    } else if ((mode == PLAN_BLOCK) && (m <= PLAN_CARRY_MAX)) {
+        plan.engine = ENGINE_MEMMEM;
+        snprintf(plan.reason, sizeof(plan.reason), "blocks and m = %d <= %d, carrying m - 1 symbols between blocks", m, PLAN_CARRY_MAX);
+    } else if (entries <= PLAN_DFA_ENTRIES) {
+        plan.engine = ENGINE_DFA;
+        snprintf(plan.reason, sizeof(plan.reason), "automaton of %ld entries <= %d", entries, PLAN_DFA_ENTRIES);
+    } else {
+        snprintf(plan.reason, sizeof(plan.reason), "automaton of %ld entries > %d, Breslauer and Galil in O(log(m)) space", entries, PLAN_DFA_ENTRIES);
+    }
+    return plan;
+}
+
+/*
+    plan_explain
+    Prints a plan for debugging.
+    Parameters:
+        match_plan plan - The plan
+        FILE       *out - Where to print
+*/
+void plan_explain(match_plan plan, FILE *out) {
+    char *engines[3] = {"memmem", "dfa", "breslauer-galil"}, *modes[3] = {"stream", "block", "offline"};
+    fprintf(out, "engine=%s mode=%s m=%d sigma=%d period=%d memory=%ld reason=\"%s\"\n", engines[plan.engine], modes[plan.mode], plan.m, plan.s_sigma, plan.period, plan.memory, plan.reason);
+}
+
+/*
+    typedef struct matcher
+    Structure for a pattern matched by the engine of a plan.
+    Components:
+        match_plan       plan       - The plan
+        int              text_index - Index of the text
+        symbol           *P         - The pattern. ENGINE_MEMMEM
+        symbol           *carry     - The last m - 1 symbols of the text, with room for m - 1 more. ENGINE_MEMMEM
+        int              carried    - Number of symbols in carry. ENGINE_MEMMEM
+        int              *dfa       - The automaton, row per number of symbols matched. ENGINE_DFA
+        int              state      - The row of the automaton. ENGINE_DFA
+        int              *columns   - Column of each 8-bit symbol, s_sigma if not in the alphabet. ENGINE_DFA
+        hash_lookup      lookup     - Column of each wider symbol. ENGINE_DFA
+        exactmatch_state bg         - The algorithm. ENGINE_BG
+*/
+typedef struct {
+    match_plan plan;
+    int text_index, carried, *dfa, state, *columns;
+    symbol *P, *carry;
+    hash_lookup lookup;
+    exactmatch_state bg;
+} matcher;
+
+int dfa_column(matcher *matcher, symbol c) {
+#if SYMBOL_WIDTH == 8
+    return matcher->columns[(unsigned char)c];
+#else
+    int column = hashlookup_search(matcher->lookup, c);
+    return (column == -1) ? matcher->plan.s_sigma : column;
+#endif
+}
+
+/*
+    matcher_build_plan
+    Constructs a matcher for a given plan, so that the choice of engine may be overridden.
+    Parameters:
+        match_plan plan    - The plan
+        symbol     *P      - The pattern
+        symbol     *sigma  - The alphabet, holding every symbol of P
+        int        n       - The length of the text
+        int        alpha   - The level of accuracy desired, for ENGINE_BG
+    Returns matcher:
+        The matcher, with plan.memory set
+*/
+matcher matcher_build_plan(match_plan plan, symbol *P, symbol *sigma, int n, int alpha) {
+    matcher matcher;
+    int i, j, x, m = plan.m, width = plan.s_sigma + 1;
+    matcher.plan = plan;
+    matcher.text_index = 0;
+    if (plan.engine == ENGINE_MEMMEM) {
+        matcher.P = malloc(m * sizeof(symbol));
+        memcpy(matcher.P, P, m * sizeof(symbol));
+        matcher.carry = malloc((m << 1) * sizeof(symbol));
+        matcher.carried = 0;
+        matcher.plan.memory = 3 * m * sizeof(symbol);
+    } else if (plan.engine == ENGINE_DFA) {
+#if SYMBOL_WIDTH == 8
+        matcher.columns = malloc(256 * sizeof(int));
+        for (i = 0; i < 256; i++) matcher.columns[i] = plan.s_sigma;
+        for (i = 0; i < plan.s_sigma; i++) matcher.columns[(unsigned char)sigma[i]] = i;
+        matcher.plan.memory = 256 * sizeof(int);
+#else
+        symbol **keys = malloc(plan.s_sigma * sizeof(symbol*));
+        int *values = malloc(plan.s_sigma * sizeof(int));
+        for (i = 0; i < plan.s_sigma; i++) {
+            keys[i] = &sigma[i];
+            values[i] = i;
+        }
+        matcher.lookup = hashlookup_build(keys, values, plan.s_sigma);
+        matcher.plan.memory = hashlookup_size(matcher.lookup);
+        free(keys);
+        free(values);
+#endif
+        matcher.dfa = malloc((long)(m + 1) * width * sizeof(int));
+        memset(matcher.dfa, 0, width * sizeof(int));
+        matcher.dfa[dfa_column(&matcher, P[0])] = 1;
+        for (j = 1, x = 0; j <= m; j++) {
+            memcpy(&matcher.dfa[(long)j * width], &matcher.dfa[(long)x * width], width * sizeof(int));
+            if (j == m) break;
+            matcher.dfa[(long)j * width + dfa_column(&matcher, P[j])] = j + 1;
+            x = matcher.dfa[(long)x * width + dfa_column(&matcher, P[j])];
+        }
+        matcher.state = 0;
+        matcher.plan.memory += (long)(m + 1) * width * sizeof(int);
+    } else {
+        matcher.bg = exactmatch_build(P, m, sigma, plan.s_sigma, n, alpha);
+        matcher.plan.memory = exactmatch_size(matcher.bg);
+    }
+    return matcher;
+}
+
+/*
+    matcher_build
+    Plans and constructs a matcher.
+    Parameters:
+        symbol *P      - The pattern
+        int    m       - Length of the pattern
+        symbol *sigma  - The alphabet, holding every symbol of P
+        int    s_sigma - The size of the alphabet
+        int    n       - The length of the text
+        int    alpha   - The level of accuracy desired, for ENGINE_BG
+        int    mode    - PLAN_STREAM, PLAN_BLOCK or PLAN_OFFLINE
+    Returns matcher:
+        The matcher
+*/
+matcher matcher_build(symbol *P, int m, symbol *sigma, int s_sigma, int n, int alpha, int mode) {
+    return matcher_build_plan(plan_pattern(P, m, s_sigma, mode), P, sigma, n, alpha);
+}
+
+/*
+    memmem_next
+    Finds the next occurance of a pattern at a symbol boundary.
+    Parameters:
+        symbol *T    - The text
+        long   l     - Length of the text
+        symbol *P    - The pattern
+        int    m     - Length of the pattern
+        long   start - Index of the text to search from
+    Returns long:
+        Index of the start of the first occurance at or after start, -1 if none
+*/
+long memmem_next(symbol *T, long l, symbol *P, int m, long start) {
+    char *base = (char*)T, *found;
+    long offset = start * sizeof(symbol), end = l * sizeof(symbol);
+    while (offset + m * (long)sizeof(symbol) <= end) {
+        found = memmem(base + offset, end - offset, P, m * sizeof(symbol));
+        if (!found) return -1;
+        offset = found - base;
+        if (offset % sizeof(symbol) == 0) return offset / sizeof(symbol);
+        offset++;
+    }
+    return -1;
+}
+
+/*
+    memmem_carry
+    Keeps the last m - 1 symbols of the text after a block.
+    Parameters:
+        matcher *matcher - The matcher
+        symbol  *T       - The block
+        int     l        - Length of the block
+*/
+void memmem_carry(matcher *matcher, symbol *T, int l) {
+    int keep = matcher->plan.m - 1;
+    if (l >= keep) memcpy(matcher->carry, &T[l - keep], keep * sizeof(symbol));
+    else {
+        int old = (matcher->carried + l > keep) ? keep - l : matcher->carried;
+        memmove(matcher->carry, &matcher->carry[matcher->carried - old], old * sizeof(symbol));
+        memcpy(&matcher->carry[old], T, l * sizeof(symbol));
+        keep = old + l;
+    }
+    matcher->carried = keep;
+}
+
+int memmem_block(matcher *matcher, symbol *T, int l, match_sink *sink) {
+    int m = matcher->plan.m, k = (l < m - 1) ? l : m - 1, start, consumed = l, base = matcher->text_index;
+    if (matcher->carried > 0) {
+        memcpy(&matcher->carry[matcher->carried], T, k * sizeof(symbol));
+        for (start = 0; (start = memmem_next(matcher->carry, matcher->carried + k, matcher->P, m, start)) != -1; start++) {
+            if (start >= matcher->carried) break;
+            if (matchsink_emit(sink, base - matcher->carried + start + m - 1)) {
+                consumed = start + m - matcher->carried;
+                break;
+            }
+        }
+    }
+    if (consumed == l) {
+        for (start = 0; (start = memmem_next(T, l, matcher->P, m, start)) != -1; start++) {
+            if (matchsink_emit(sink, base + start + m - 1)) {
+                consumed = start + m;
+                break;
+            }
+        }
+    }
+    memmem_carry(matcher, T, consumed);
+    matcher->text_index += consumed;
+    return consumed;
+}
+
+/*
+    matcher_stream
+    Performs the next round of matching.
+    Parameters:
+        matcher *matcher - The matcher, planned for PLAN_STREAM
+        symbol  T_i      - The next character of the text
+    Returns int:
+        i if there is a match at index T[i]
+        -1 otherwise
+    Notes:
+        ENGINE_MEMMEM is never planned for PLAN_STREAM. If a plan is overridden to use it, each character is a block of
+        one for memmem_block, which costs O(m) per character to keep the carried symbols.
+*/
+int matcher_stream(matcher *matcher, symbol T_i) {
+    int i;
+    if (matcher->plan.engine == ENGINE_BG) return exactmatch_stream(&matcher->bg, T_i);
+    if (matcher->plan.engine == ENGINE_MEMMEM) {
+        match_sink sink = matchsink_array(&i);
+        memmem_block(matcher, &T_i, 1, &sink);
+        return (sink.count) ? i : -1;
+    }
+    i = matcher->text_index++;
+    matcher->state = matcher->dfa[(long)matcher->state * (matcher->plan.s_sigma + 1) + dfa_column(matcher, T_i)];
+    return (matcher->state == matcher->plan.m) ? i : -1;
+}
+
+/*
+    matcher_stream_block
+    Performs matching on the next block of the text.
+    Parameters:
+        matcher    *matcher - The matcher
+        symbol     *T       - The next block of the text
+        int        l        - Length of the block
+        match_sink *sink    - Destination for the location of each match
+    Returns int:
+        Number of characters of T consumed. Less than l only if the sink reported it was full.
+    Notes:
+        With PLAN_OFFLINE the whole text is expected as one block.
+*/
+int matcher_stream_block(matcher *matcher, symbol *T, int l, match_sink *sink) {
+    int i, result;
+    if (matchsink_full(sink)) return 0;
+    if (matcher->plan.engine == ENGINE_MEMMEM) return memmem_block(matcher, T, l, sink);
+    if (matcher->plan.engine == ENGINE_BG) return exactmatch_stream_block(&matcher->bg, T, l, sink);
+    for (i = 0; i < l; i++) {
+        result = matcher_stream(matcher, T[i]);
+        if ((result != -1) && (matchsink_emit(sink, result))) return i + 1;
+    }
+    return l;
+}
+
+/*
+    matcher_free
+    Frees a matcher from memory.
+    Parameters:
+        matcher *matcher - The matcher to free
+*/
+void matcher_free(matcher *matcher) {
+    if (matcher->plan.engine == ENGINE_MEMMEM) {
+        free(matcher->P);
+        free(matcher->carry);
+    } else if (matcher->plan.engine == ENGINE_DFA) {
+        free(matcher->dfa);
+#if SYMBOL_WIDTH == 8
+        free(matcher->columns);
+#else
+        hashlookup_free(&matcher->lookup);
+#endif
+    } else exactmatch_free(&matcher->bg);
+}
+
+#endif
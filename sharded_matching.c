@@ -0,0 +1,59 @@
+#include "sharded_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct {
+    pattern_match *expected;
+    int count, next;
+} expected_matches;
+
+void check_match(int pattern, int location, void *data) {
+    expected_matches *expected = data;
+    assert(expected->next < expected->count);
+    assert(expected->expected[expected->next].location == location);
+    assert(expected->expected[expected->next++].pattern == pattern);
+}
+
+int main(void) {
+    int n = 100000, num_patterns = 12, i, j, k, *m = malloc(num_patterns * sizeof(int));
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, *T = malloc(n * sizeof(symbol)), **P = malloc(num_patterns * sizeof(symbol*));
+    expected_matches expected = {malloc(n * num_patterns * sizeof(pattern_match)), 0, 0};
+    srand(2);
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 2];
+    for (j = 0; j < num_patterns; j++) {
+        m[j] = 8 + j * 5;
+        P[j] = malloc(m[j] * sizeof(symbol));
+        for (i = 0; i < m[j]; i++) P[j][i] = sigma[rand() % 2];
+        for (i = rand() % 1000; i + m[j] < n; i += m[j] + rand() % 5000) memcpy(&T[i], P[j], m[j] * sizeof(symbol));
+    }
+
+    exactmatch_state *states = malloc(num_patterns * sizeof(exactmatch_state));
+    for (j = 0; j < num_patterns; j++) states[j] = exactmatch_build(P[j], m[j], sigma, 2, n, 0);
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < num_patterns; j++) {
+            if (exactmatch_stream(&states[j], T[i]) != -1) {
+                expected.expected[expected.count].location = i;
+                expected.expected[expected.count++].pattern = j;
+            }
+        }
+    }
+    for (j = 0; j < num_patterns; j++) exactmatch_free(&states[j]);
+    free(states);
+    assert(expected.count > num_patterns);
+
+    for (k = 1; k <= 3; k++) {
+        expected.next = 0;
+        shard_scanner *scanner = shardscan_build(P, m, num_patterns, sigma, 2, n, 0, k, check_match, &expected);
+        for (i = 0; i < n; i += 7919) shardscan_stream(scanner, &T[i], (i + 7919 < n) ? 7919 : n - i);
+        shardscan_free(scanner);
+        assert(expected.next == expected.count);
+    }
+
+    for (j = 0; j < num_patterns; j++) free(P[j]);
+    free(P);
+    free(m);
+    free(T);
+    free(expected.expected);
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*
+    sharded_matching.h
+    Multi-core exact matching of many patterns over one stream.
+    Patterns are partitioned across worker threads. A single producer copies the text into blocks of a shared ring, and every
+    worker runs its exactmatch_states over every block. Each block carries a count of the workers still reading it; the producer
+    reuses a slot only once that count reaches zero, so the workers take no locks. Matches from all workers are merged into one
+    stream ordered by location, then by pattern.
+*/
+
+#ifndef SHARDED_MATCHING
+#define SHARDED_MATCHING
+
+#include "exact_matching.h"
+#include "spsc_queue.h"
+#include <pthread.h>
+
+#define SHARD_BLOCK_SIZE 16384
+#define SHARD_RING_SIZE 8
+
+/*
+    typedef struct pattern_match
+    Structure for a match of one of many patterns.
+    Components:
+        int location - Index of the text at the end of the match
+        int pattern  - Index of the pattern that matched
+*/
+typedef struct {
+    int location, pattern;
+} pattern_match;
+
+/*
+    typedef struct match_list
+    Structure for the matches one worker found in one block.
+    Components:
+        pattern_match *matches - The matches, sorted by location then pattern
+        int           count    - Number of matches
+        int           size     - Number of matches allocated
+*/
+typedef struct {
+    pattern_match *matches;
+    int count, size;
+} match_list;
+
+/*
+    typedef struct shard_block
+    Structure for a slot of the shared ring of text blocks.
+    Components:
+        atomic_int readers - Number of workers yet to finish with this block
+        int        l       - Length of the block
+        symbol     *T      - The text of the block
+        match_list *found  - Matches found in this block, one list per worker
+        int        pending - 1 if the block has been published and its matches not yet merged
+*/
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int readers;
+    int l, pending;
+    symbol *T;
+    match_list *found;
+} shard_block;
+
+typedef struct shard_scanner_t shard_scanner;
+
+/*
+    typedef struct shard_worker
+    Structure for one worker thread.
+    Components:
+        shard_scanner    *scanner     - The scanner the worker belongs to
+        int              id           - Index of the worker
+        int              num_patterns - Number of patterns given to this worker
+        int              *patterns    - Indices of the patterns
+        exactmatch_state *states      - Matching state of each pattern
+        pthread_t        thread       - The thread
+*/
+typedef struct {
+    shard_scanner *scanner;
+    int id, num_patterns, *patterns;
+    exactmatch_state *states;
+    pthread_t thread;
+} shard_worker;
+
+/*
+    typedef struct shard_scanner_t shard_scanner
+    Structure for a pattern-sharded scanner.
+    Components:
+        atomic_int   published   - Number of blocks published to the workers
+        atomic_int   stop        - 1 once the workers should exit
+        int          merged      - Number of blocks whose matches have been merged
+        int          num_workers - Number of worker threads
+        shard_block  ring[]      - The shared ring of blocks
+        shard_worker *workers    - The workers
+        void         (*emit)(int, int, void*) - Called with (pattern, location) for every match, in order
+        void         *data       - Passed through to emit
+*/
+struct shard_scanner_t {
+    _Alignas(CACHE_LINE) atomic_int published;
+    atomic_int stop;
+    _Alignas(CACHE_LINE) int merged, num_workers;
+    shard_block ring[SHARD_RING_SIZE];
+    shard_worker *workers;
+    void (*emit)(int pattern, int location, void *data);
+    void *data;
+};
+
+int pattern_match_compare(const void *a, const void *b) {
+    const pattern_match *x = a, *y = b;
+    if (x->location != y->location) return (x->location < y->location) ? -1 : 1;
+    return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+void *shard_worker_run(void *data) {
+    shard_worker *worker = data;
+    shard_scanner *scanner = worker->scanner;
+    int consumed = 0, published, i, j, result;
+    while (1) {
+        while ((published = atomic_load_explicit(&scanner->published, memory_order_acquire)) == consumed) {
+            if (atomic_load_explicit(&scanner->stop, memory_order_acquire)) return NULL;
+            sched_yield();
+        }
+        for (; consumed < published; consumed++) {
+            shard_block *block = &scanner->ring[consumed % SHARD_RING_SIZE];
+            match_list *found = &block->found[worker->id];
+            found->count = 0;
+            for (j = 0; j < worker->num_patterns; j++) {
+                for (i = 0; i < block->l; i++) {
+                    result = exactmatch_stream(&worker->states[j], block->T[i]);
+                    if (result != -1) {
+                        if (found->count == found->size) {
+                            found->size = (found->size) ? found->size << 1 : 16;
+                            found->matches = realloc(found->matches, found->size * sizeof(pattern_match));
+                        }
+                        found->matches[found->count].location = result;
+                        found->matches[found->count++].pattern = worker->patterns[j];
+                    }
+                }
+            }
+            if (found->count > 1) qsort(found->matches, found->count, sizeof(pattern_match), pattern_match_compare);
+            atomic_fetch_sub_explicit(&block->readers, 1, memory_order_release);
+        }
+    }
+}
+
+/*
+    shardscan_merge
+    Waits for the workers to finish the oldest unmerged block, then emits its matches in order.
+    Parameters:
+        shard_scanner *scanner - The scanner
+*/
+void shardscan_merge(shard_scanner *scanner) {
+    shard_block *block = &scanner->ring[scanner->merged % SHARD_RING_SIZE];
+    int *next = calloc(scanner->num_workers, sizeof(int)), w, best;
+    while (atomic_load_explicit(&block->readers, memory_order_acquire) > 0) sched_yield();
+    while (1) {
+        best = -1;
+        for (w = 0; w < scanner->num_workers; w++) {
+            if (next[w] == block->found[w].count) continue;
+            if ((best == -1) || (pattern_match_compare(&block->found[w].matches[next[w]], &block->found[best].matches[next[best]]) < 0)) best = w;
+        }
+        if (best == -1) break;
+        pattern_match *match = &block->found[best].matches[next[best]++];
+        scanner->emit(match->pattern, match->location, scanner->data);
+    }
+    free(next);
+    block->pending = 0;
+    scanner->merged++;
+}
+
+/*
+    shardscan_build
+    Constructs a scanner and starts its worker threads.
+    Parameters:
+        symbol **P          - The patterns
+        int    *m           - Length of each pattern
+        int    num_patterns - Number of patterns
+        symbol *sigma       - The alphabet
+        int    s_sigma      - The size of the alphabet
+        int    n            - The length of the text
+        int    alpha        - The level of accuracy desired
+        int    num_workers  - Number of worker threads
+        void   (*emit)(int, int, void*) - Called with (pattern, location) for every match, ordered by location then pattern
+        void   *data        - Passed through to emit
+    Returns shard_scanner *:
+        The scanner
+    Notes:
+        Patterns are dealt to workers longest first, each to the worker with the least total pattern length.
+*/
+shard_scanner *shardscan_build(symbol **P, int *m, int num_patterns, symbol *sigma, int s_sigma, int n, int alpha, int num_workers, void (*emit)(int pattern, int location, void *data), void *data) {
+    shard_scanner *scanner = aligned_alloc(CACHE_LINE, sizeof(shard_scanner));
+    int i, j, w, *order = malloc(num_patterns * sizeof(int)), *load = calloc(num_workers, sizeof(int));
+    atomic_init(&scanner->published, 0);
+    atomic_init(&scanner->stop, 0);
+    scanner->merged = 0;
+    scanner->num_workers = num_workers;
+    scanner->emit = emit;
+    scanner->data = data;
+
+    for (i = 0; i < SHARD_RING_SIZE; i++) {
+        atomic_init(&scanner->ring[i].readers, 0);
+        scanner->ring[i].pending = 0;
+        scanner->ring[i].T = malloc(SHARD_BLOCK_SIZE * sizeof(symbol));
+        scanner->ring[i].found = calloc(num_workers, sizeof(match_list));
+    }
+
+    scanner->workers = malloc(num_workers * sizeof(shard_worker));
+    for (w = 0; w < num_workers; w++) {
+        scanner->workers[w].scanner = scanner;
+        scanner->workers[w].id = w;
+        scanner->workers[w].num_patterns = 0;
+        scanner->workers[w].patterns = malloc(num_patterns * sizeof(int));
+        scanner->workers[w].states = malloc(num_patterns * sizeof(exactmatch_state));
+    }
+    for (i = 0; i < num_patterns; i++) {
+        for (j = i; (j > 0) && (m[order[j - 1]] < m[i]); j--) order[j] = order[j - 1];
+        order[j] = i;
+    }
+    for (i = 0; i < num_patterns; i++) {
+        shard_worker *worker = &scanner->workers[0];
+        for (w = 1; w < num_workers; w++) if (load[w] < load[worker->id]) worker = &scanner->workers[w];
+        load[worker->id] += m[order[i]];
+        worker->patterns[worker->num_patterns] = order[i];
+        worker->states[worker->num_patterns++] = exactmatch_build(P[order[i]], m[order[i]], sigma, s_sigma, n, alpha);
+    }
+    free(order);
+    free(load);
+
+    for (w = 0; w < num_workers; w++) pthread_create(&scanner->workers[w].thread, NULL, shard_worker_run, &scanner->workers[w]);
+    return scanner;
+}
+
+/*
+    shardscan_stream
+    Publishes the next part of the text to the workers.
+    Parameters:
+        shard_scanner *scanner - The scanner
+        symbol        *T       - The next part of the text
+        int           l        - Length of T
+    Notes:
+        Returns once T has been copied into the ring. Matches of earlier blocks are emitted as their slots are reused.
+*/
+void shardscan_stream(shard_scanner *scanner, symbol *T, int l) {
+    int published = atomic_load_explicit(&scanner->published, memory_order_relaxed), size;
+    while (l > 0) {
+        shard_block *block = &scanner->ring[published % SHARD_RING_SIZE];
+        if (block->pending) shardscan_merge(scanner);
+        size = (l < SHARD_BLOCK_SIZE) ? l : SHARD_BLOCK_SIZE;
+        memcpy(block->T, T, size * sizeof(symbol));
+        block->l = size;
+        block->pending = 1;
+        atomic_store_explicit(&block->readers, scanner->num_workers, memory_order_relaxed);
+        atomic_store_explicit(&scanner->published, ++published, memory_order_release);
+        T += size;
+        l -= size;
+    }
+}
+
+/*
+    shardscan_flush
+    Waits for the workers to finish every published block and emits all outstanding matches.
+    Parameters:
+        shard_scanner *scanner - The scanner
+*/
+void shardscan_flush(shard_scanner *scanner) {
+    while (scanner->merged < atomic_load_explicit(&scanner->published, memory_order_relaxed)) shardscan_merge(scanner);
+}
+
+/*
+    shardscan_free
+    Emits outstanding matches, stops the workers and frees the scanner.
+    Parameters:
+        shard_scanner *scanner - The scanner to free
+*/
+void shardscan_free(shard_scanner *scanner) {
+    int i, w;
+    shardscan_flush(scanner);
+    atomic_store_explicit(&scanner->stop, 1, memory_order_release);
+    for (w = 0; w < scanner->num_workers; w++) {
+        pthread_join(scanner->workers[w].thread, NULL);
+        for (i = 0; i < scanner->workers[w].num_patterns; i++) exactmatch_free(&scanner->workers[w].states[i]);
+        free(scanner->workers[w].states);
+        free(scanner->workers[w].patterns);
+    }
+    free(scanner->workers);
+    for (i = 0; i < SHARD_RING_SIZE; i++) {
+        for (w = 0; w < scanner->num_workers; w++) free(scanner->ring[i].found[w].matches);
+        free(scanner->ring[i].found);
+        free(scanner->ring[i].T);
+    }
+    free(scanner);
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+    spsc_queue.h
+    Bounded single-producer single-consumer queue of 64-bit integers for passing positions between threads.
+    The producer and consumer indices sit on separate cache lines so the two cores do not false-share.
+*/
+
+#ifndef SPSC_QUEUE
+#define SPSC_QUEUE
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#define CACHE_LINE 64
+
+/*
+    typedef struct spsc_queue
+    Structure for the queue.
+    Components:
+        atomic_uint  head        - Index of the next item to pop. Written only by the consumer
+        unsigned int tail_cache  - The consumer's last view of tail
+        atomic_uint  tail        - Index of the next free slot. Written only by the producer
+        unsigned int head_cache  - The producer's last view of head
+        unsigned int mask        - Capacity - 1. Capacity is a power of two
+        int64_t      *values     - The items
+*/
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint head;
+    unsigned int tail_cache;
+    _Alignas(CACHE_LINE) atomic_uint tail;
+    unsigned int head_cache;
+    _Alignas(CACHE_LINE) unsigned int mask;
+    int64_t *values;
+} spsc_queue;
+
+/*
+    spscqueue_build
+    Constructs an empty queue.
+    Parameters:
+        int capacity - Minimum number of items the queue can hold. Rounded up to a power of two
+    Returns spsc_queue *:
+        The queue
+*/
+spsc_queue *spscqueue_build(int capacity) {
+    spsc_queue *queue = aligned_alloc(CACHE_LINE, sizeof(spsc_queue));
+    unsigned int size = 1;
+    while (size < capacity) size <<= 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    queue->head_cache = 0;
+    queue->tail_cache = 0;
+    queue->mask = size - 1;
+    queue->values = malloc(size * sizeof(int64_t));
+    return queue;
+}
+
+/*
+    spscqueue_push
+    Adds an item to the queue, waiting for the consumer if the queue is full.
+    Parameters:
+        spsc_queue *queue - The queue
+        int64_t    value  - The item to add
+*/
+void spscqueue_push(spsc_queue *queue, int64_t value) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    while (tail - queue->head_cache > queue->mask) {
+        queue->head_cache = atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (tail - queue->head_cache > queue->mask) sched_yield();
+    }
+    queue->values[tail & queue->mask] = value;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+}
+
+/*
+    spscqueue_peek
+    Reads the oldest item without removing it.
+    Parameters:
+        spsc_queue *queue - The queue
+        int64_t    *value - The oldest item
+    Returns int:
+        1 if there was an item
+        0 if the queue was empty
+*/
+int spscqueue_peek(spsc_queue *queue, int64_t *value) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == queue->tail_cache) {
+        queue->tail_cache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head == queue->tail_cache) return 0;
+    }
+    *value = queue->values[head & queue->mask];
+    return 1;
+}
+
+/*
+    spscqueue_pop
+    Removes the oldest item from the queue.
+    Parameters:
+        spsc_queue *queue - The queue
+        int64_t    *value - The item removed
+    Returns int:
+        1 if an item was removed
+        0 if the queue was empty
+*/
+int spscqueue_pop(spsc_queue *queue, int64_t *value) {
+    if (!spscqueue_peek(queue, value)) return 0;
+    atomic_store_explicit(&queue->head, atomic_load_explicit(&queue->head, memory_order_relaxed) + 1, memory_order_release);
+    return 1;
+}
+
+/*
+    spscqueue_free
+    Frees a queue from memory.
+    Parameters:
+        spsc_queue *queue - The queue to free
+*/
+void spscqueue_free(spsc_queue *queue) {
+    free(queue->values);
+    free(queue);
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+    symbol.h
+    The type of a single character of the pattern and the text.
+    Selected at compile time with SYMBOL_WIDTH (8, 16 or 32 bits). Wider symbols are for streams that are already tokenised,
+    e.g. compile with -DSYMBOL_WIDTH=32 to match over 32-bit token IDs directly.
+*/
+
+#ifndef SYMBOL
+#define SYMBOL
+
+#include <stdint.h>
+
+#ifndef SYMBOL_WIDTH
+#define SYMBOL_WIDTH 8
+#endif
+
+/*
+    typedef symbol
+    A single character of the alphabet.
+        SYMBOL_WIDTH 8  - char
+        SYMBOL_WIDTH 16 - uint16_t
+        SYMBOL_WIDTH 32 - uint32_t
+*/
+#if SYMBOL_WIDTH == 8
+typedef char symbol;
+#elif SYMBOL_WIDTH == 16
+typedef uint16_t symbol;
+#elif SYMBOL_WIDTH == 32
+typedef uint32_t symbol;
+#else
+#error "SYMBOL_WIDTH must be 8, 16 or 32"
+#endif
+
+/*
+    symbol_value
+    The value a symbol is fingerprinted as.
+    Parameters:
+        symbol c - The symbol
+    Returns uint32_t:
+        c read as an unsigned integer of SYMBOL_WIDTH bits, so chars of 128 or more are not sign extended
+*/
+uint32_t symbol_value(symbol c) {
+#if SYMBOL_WIDTH == 8
+    return (unsigned char)c;
+#else
+    return c;
+#endif
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "wildcard_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+/*
+    Checks wildcard matching against a naive scan, then times it against matching each fragment over the whole text into
+    a bitmap and correlating the bitmaps afterwards.
+    Usage: wildcard_matching [length] [fields]
+*/
+
+#define WILDCARD '?'
+
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int naive_match(symbol *T, int i, symbol *P, int m) {
+    int j;
+    if (i < m - 1) return 0;
+    for (j = 0; j < m; j++) if ((P[j] != WILDCARD) && (P[j] != T[i - m + 1 + j])) return 0;
+    return 1;
+}
+
+/*
+    A text with copies of the pattern, each wildcard filled at random, some overlapping and some broken by one character.
+*/
+symbol *make_text(int n, symbol *P, int m, symbol *sigma, int s_sigma) {
+    symbol *T = malloc(n * sizeof(symbol));
+    int i, j;
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % s_sigma];
+    for (i = rand() % 50; i + m < n; i += m + rand() % (4 * m)) {
+        for (j = 0; j < m; j++) T[i + j] = (P[j] == WILDCARD) ? sigma[rand() % s_sigma] : P[j];
+        if (rand() % 3 == 0) i -= m / 2;
+        else if (rand() % 3 == 0) T[i + rand() % m] = sigma[rand() % s_sigma];
+    }
+    return T;
+}
+
+void wildcard_test(symbol *P, int m, symbol *T, int n, symbol *sigma, int s_sigma) {
+    int i, l, *results = malloc(n * sizeof(int)), count = 0;
+    wildcard_state state = wildcard_build(P, m, WILDCARD, sigma, s_sigma, n, 0);
+    match_sink sink = matchsink_array(results);
+    for (i = 0; i < n; i += l) {
+        l = rand() % 300;
+        if (i + l > n) l = n - i;
+        assert(wildcard_stream_block(&state, &T[i], l, &sink) == l);
+    }
+    for (i = 0; i < n; i++) {
+        if (naive_match(T, i, P, m)) {
+            assert((count < sink.count) && (results[count] == i));
+            count++;
+        }
+    }
+    assert(count == sink.count);
+    wildcard_free(&state);
+    free(results);
+}
+
+void random_test(int m, int s_sigma, int n) {
+    symbol sigma[4] = {'a', 'b', 'c', 'd'}, *P = malloc(m * sizeof(symbol)), *T;
+    int i, j, field;
+    for (i = 0; i < m; i++) P[i] = sigma[rand() % s_sigma];
+    for (i = 0; i < m; i += field + 1 + rand() % (m / 3 + 1)) {
+        field = 1 + rand() % (m / 4 + 1);
+        for (j = i; (j < i + field) && (j < m); j++) P[j] = WILDCARD;
+    }
+    T = make_text(n, P, m, sigma, s_sigma);
+    wildcard_test(P, m, T, n, sigma, s_sigma);
+    free(P);
+    free(T);
+}
+
+/*
+    On a text of one character, every fragment matches everywhere, and each queue must stay a single progression.
+*/
+void periodic_test(int n) {
+    symbol sigma[2] = {'a', 'b'}, P[400], *T = malloc(n * sizeof(symbol));
+    int i;
+    for (i = 0; i < 400; i++) P[i] = ((i >= 100) && (i < 250)) ? WILDCARD : 'a';
+    P[320] = WILDCARD;
+    for (i = 0; i < n; i++) T[i] = 'a';
+    wildcard_state state = wildcard_build(P, 400, WILDCARD, sigma, 2, n, 0);
+    match_sink sink = matchsink_array(malloc(n * sizeof(int)));
+    assert(wildcard_stream_block(&state, T, n, &sink) == n);
+    assert(sink.count == n - 399);
+    assert(state.most_held <= state.num_fragments);
+    free(sink.data);
+    wildcard_free(&state);
+    wildcard_test(P, 400, T, 2000, sigma, 2);
+    free(T);
+}
+
+/*
+    gap_test
+    A short fragment that recurs irregularly ahead of a long gap is the worst case for the queues. Checks that the
+    progressions held stay within the sum over the queues of d / p + 1, for d the characters a candidate waits in the
+    queue and p the period of its fragment. Returns the most held.
+*/
+int gap_test(int gap, int n) {
+    symbol sigma[2] = {'a', 'b'}, *P = malloc((gap + 6) * sizeof(symbol)), *T = malloc(n * sizeof(symbol));
+    int i, j, m = gap + 6, p, d, bound = 0;
+    for (i = 0; i < m; i++) P[i] = WILDCARD;
+    P[0] = P[1] = P[m - 3] = 'a';
+    P[2] = P[m - 2] = P[m - 1] = 'b';
+    for (i = 0; i < n; i++) T[i] = sigma[rand() % 2];
+    wildcard_state state = wildcard_build(P, m, WILDCARD, sigma, 2, n, 0);
+    for (j = 0; j < state.num_fragments; j++) {
+        wildcard_fragment *fragment = &state.fragments[j];
+        for (p = 1; p <= fragment->end - fragment->offset; p++) {
+            for (i = fragment->offset + p; (i <= fragment->end) && (P[i] == P[i - p]); i++);
+            if (i > fragment->end) break;
+        }
+        d = (j + 1 < state.num_fragments) ? state.fragments[j + 1].end - fragment->end : m - 1 - fragment->end;
+        bound += d / p + 1;
+    }
+    match_sink sink = matchsink_array(malloc(n * sizeof(int)));
+    assert(wildcard_stream_block(&state, T, n, &sink) == n);
+    assert(state.most_held <= bound);
+    free(sink.data);
+    i = state.most_held;
+    wildcard_free(&state);
+    wildcard_test(P, m, T, n, sigma, 2);
+    free(P);
+    free(T);
+    return i;
+}
+
+void string_test(char *P, char *T, symbol *sigma, int s_sigma) {
+    int m = strlen(P), n = strlen(T), i;
+    symbol *P_s = malloc(m * sizeof(symbol)), *T_s = malloc(n * sizeof(symbol));
+    for (i = 0; i < m; i++) P_s[i] = P[i];
+    for (i = 0; i < n; i++) T_s[i] = T[i];
+    wildcard_test(P_s, m, T_s, n, sigma, s_sigma);
+    free(P_s);
+    free(T_s);
+}
+
+void edge_test() {
+    symbol sigma[2] = {'a', 'b'};
+    char *T = "abaabbabaaabbbababababaabbabbaabbbabaaba";
+    string_test("????", T, sigma, 2);
+    string_test("a", T, sigma, 2);
+    string_test("?b?", T, sigma, 2);
+    string_test("ab?a", T, sigma, 2);
+    string_test("??ab?ab??", T, sigma, 2);
+    string_test("aba?b?aba", T, sigma, 2);
+}
+
+/*
+    Times both ways of matching a signature of fixed framing around fields of wildcards.
+*/
+void wildcard_benchmark(int n, int fields) {
+    symbol sigma[26], *P, *T;
+    int i, j, m = 40 * fields + 32, location, matches, bitmap_matches = 0;
+    for (i = 0; i < 26; i++) sigma[i] = 'a' + i;
+    P = malloc(m * sizeof(symbol));
+    for (i = 0; i < m; i++) P[i] = ((i % 40 >= 32) && (i < 40 * fields)) ? WILDCARD : sigma[rand() % 26];
+    T = make_text(n, P, m, sigma, 26);
+
+    wildcard_state state = wildcard_build(P, m, WILDCARD, sigma, 26, n, 0);
+    match_sink sink = matchsink_array(malloc(n * sizeof(int)));
+    double start = now();
+    wildcard_stream_block(&state, T, n, &sink);
+    double stream_time = now() - start;
+    matches = sink.count;
+    free(sink.data);
+
+    match_sink *bitmaps = malloc(state.num_fragments * sizeof(match_sink));
+    start = now();
+    for (j = 0; j < state.num_fragments; j++) {
+        wildcard_fragment *fragment = &state.fragments[j];
+        exactmatch_state matcher = exactmatch_build(&P[fragment->offset], fragment->end - fragment->offset + 1, sigma, 26, n, 0);
+        bitmaps[j] = matchsink_bitmap();
+        exactmatch_stream_block(&matcher, T, n, &bitmaps[j]);
+        exactmatch_free(&matcher);
+    }
+    for (location = m - 1; location < n; location++) {
+        for (j = 0; (j < state.num_fragments) && (bitmapsink_test(&bitmaps[j], location - (m - 1 - state.fragments[j].end))); j++);
+        if (j == state.num_fragments) bitmap_matches++;
+    }
+    double bitmap_time = now() - start;
+    assert(bitmap_matches == matches);
+    long bitmap_bytes = 0;
+    for (j = 0; j < state.num_fragments; j++) {
+        bitmap_bytes += ((bitmap_sink*)bitmaps[j].data)->words * sizeof(unsigned long);
+        matchsink_free(&bitmaps[j]);
+    }
+    free(bitmaps);
+
+    printf("m = %d, %d fragments, %d matches in %d characters: streaming %.1f ns/char in %d bytes (at most %d progressions queued), fragment and correlate %.1f ns/char in %ld bytes of bitmaps\n", m, state.num_fragments, matches, n, stream_time * 1e9 / n, wildcard_size(state), state.most_held, bitmap_time * 1e9 / n, bitmap_bytes);
+    wildcard_free(&state);
+    free(P);
+    free(T);
+}
+
+int main(int argc, char **argv) {
+    int n = (argc > 1) ? atoi(argv[1]) : 1 << 20, fields = (argc > 2) ? atoi(argv[2]) : 4, i;
+    srand(17);
+    edge_test();
+    periodic_test(100000);
+    gap_test(100, 20000);
+    gap_test(1000, 20000);
+    for (i = 0; i < 200; i++) random_test(1 + rand() % 80, 2 + rand() % 3, 3000);
+    random_test(2000, 2, 50000);
+    wildcard_benchmark(n, fields);
+    wildcard_benchmark(n, 4 * fields);
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*
+    wildcard_matching.h
+    Stream-based matching of patterns with wildcards, positions that match any character, such as the variable fields of
+    a signature inside fixed framing.
+    The pattern is split into its solid fragments, the maximal runs without a wildcard. Each fragment is matched with its
+    own exact matching stream, so in O(log) space per fragment, and each occurance of fragment j names the one location at
+    which the whole pattern could end. Those candidates wait in a queue until fragment j + 1 is due to confirm them, and
+    the candidates that survive every fragment are reported as the text reaches their location.
+    A candidate of fragment j waits d characters, from the end of fragment j to the end of fragment j + 1, and occurances
+    of a fragment are at least its period p apart, so the queue of fragment j holds at most d / p + 1 candidates. Those
+    closer than half the fragment are exactly p apart, and the queues hold candidates as arithmetic progressions, so on
+    periodic text or where the gaps are short next to the fragments a queue holds O(1) progressions.
+    That is the best case. The worst is a short fragment that recurs irregularly ahead of a long gap, where the queue
+    holds Theta(d / p) progressions, little better than one per candidate: for "aab", a gap of g wildcards and "abb" on
+    random text over {a, b}, at most 12, 73, 634 and 6022 progressions were held for g = 100, 1000, 10000 and 100000.
+    Space is O(k log(m)) plus the progressions held, which is O(k log(m)) only in the best case, and time per character
+    is O(k) plus that of the fragment streams. In the benchmark in wildcard_matching.c this is no faster than matching
+    every fragment into a bitmap and correlating the bitmaps, and has run up to 15% slower, so the saving is in space
+    alone, and only when the gaps are short.
+*/
+
+#ifndef WILDCARD_MATCHING
+#define WILDCARD_MATCHING
+
+#include "exact_matching.h"
+
+#define WILDCARD_SHORT 3
+
+/*
+    typedef struct wildcard_progression
+    Structure for candidate locations first, first + stride, ..., first + (count - 1) * stride.
+    Components:
+        int first  - The first location
+        int stride - The distance between locations, 0 if count is 1
+        int count  - The number of locations
+*/
+typedef struct {
+    int first, stride, count;
+} wildcard_progression;
+
+/*
+    typedef struct wildcard_queue
+    Structure for a first-in first-out queue of increasing candidate locations.
+    Components:
+        wildcard_progression *progressions - Ring buffer of progressions
+        int                  capacity      - Number of progressions allocated
+        int                  head          - Index of the oldest progression
+        int                  size          - Number of progressions held
+*/
+typedef struct {
+    wildcard_progression *progressions;
+    int capacity, head, size;
+} wildcard_queue;
+
+/*
+    typedef struct wildcard_fragment
+    Structure for one solid fragment of a pattern.
+    Components:
+        int              offset  - Index in the pattern of the first character of the fragment
+        int              end     - Index in the pattern of the last character of the fragment
+        int              exact   - 1 if the fragment is matched by exact matching, 0 if by KMP
+        exactmatch_state matcher - Exact matching, for fragments of at least WILDCARD_SHORT characters
+        kmp_state        kmp     - KMP, for shorter fragments
+        wildcard_queue   queue   - Candidates confirmed by this and every earlier fragment, awaiting the next
+*/
+typedef struct {
+    int offset, end, exact;
+    exactmatch_state matcher;
+    kmp_state kmp;
+    wildcard_queue queue;
+} wildcard_fragment;
+
+/*
+    typedef struct wildcard_state
+    Structure for the current state of wildcard matching.
+    Components:
+        int               m              - Length of the pattern
+        int               num_fragments  - Number of solid fragments
+        wildcard_fragment *fragments     - The fragments, in order
+        int               text_index     - Index of the text
+        int               most_held      - Largest number of progressions held at once across all queues
+*/
+typedef struct {
+    int m, num_fragments;
+    wildcard_fragment *fragments;
+    int text_index, most_held;
+} wildcard_state;
+
+/*
+    wildcardqueue_push
+    Adds a candidate to the back of a queue.
+    Parameters:
+        wildcard_queue *queue    - The queue
+        int            location  - The candidate, greater than any already held
+    Returns void:
+        Parameter queue modified by reference. The candidate extends the last progression if it is the next term, or if
+        that progression holds one location.
+*/
+void wildcardqueue_push(wildcard_queue *queue, int location) {
+    wildcard_progression *last;
+    int j;
+    if (queue->size > 0) {
+        last = &queue->progressions[(queue->head + queue->size - 1) % queue->capacity];
+        if (last->count == 1) {
+            last->stride = location - last->first;
+            last->count++;
+            return;
+        }
+        if (location == last->first + last->stride * last->count) {
+            last->count++;
+            return;
+        }
+    }
+    if (queue->size == queue->capacity) {
+        queue->progressions = realloc(queue->progressions, (queue->capacity << 1) * sizeof(wildcard_progression));
+        for (j = 0; j < queue->head; j++) queue->progressions[queue->capacity + j] = queue->progressions[j];
+        queue->capacity <<= 1;
+    }
+    last = &queue->progressions[(queue->head + queue->size) % queue->capacity];
+    last->first = location;
+    last->stride = 0;
+    last->count = 1;
+    queue->size++;
+}
+
+/*
+    wildcardqueue_take
+    Drops every candidate below a location from the front of a queue, then takes the location itself if it is held.
+    Parameters:
+        wildcard_queue *queue    - The queue
+        int            location  - The location
+    Returns int:
+        1 if location was held, and has been removed
+        0 otherwise
+*/
+int wildcardqueue_take(wildcard_queue *queue, int location) {
+    wildcard_progression *head;
+    int skip;
+    while (queue->size > 0) {
+        head = &queue->progressions[queue->head];
+        if (head->first > location) return 0;
+        if (head->first < location) {
+            if (head->first + head->stride * (head->count - 1) < location) {
+                if (++queue->head == queue->capacity) queue->head = 0;
+                queue->size--;
+                continue;
+            }
+            skip = (location - head->first + head->stride - 1) / head->stride;
+            head->first += skip * head->stride;
+            head->count -= skip;
+            if (head->first != location) return 0;
+        }
+        if (--head->count == 0) {
+            if (++queue->head == queue->capacity) queue->head = 0;
+            queue->size--;
+        } else head->first += head->stride;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    wildcard_build
+    Constructs matching for a pattern with wildcards.
+    Parameters:
+        symbol *P        - The pattern
+        int    m         - Length of the pattern
+        symbol wildcard  - The character standing for a wildcard in P
+        symbol *sigma    - The alphabet, without the wildcard
+        int    s_sigma   - The size of the alphabet
+        int    n         - The length of the text
+        int    alpha     - The level of accuracy desired
+    Returns wildcard_state:
+        The initial state
+*/
+wildcard_state wildcard_build(symbol *P, int m, symbol wildcard, symbol *sigma, int s_sigma, int n, int alpha) {
+    wildcard_state state;
+    wildcard_fragment *fragment;
+    int i, j, length;
+    state.m = m;
+    state.text_index = 0;
+    state.most_held = 0;
+    state.num_fragments = 0;
+    for (i = 0; i < m; i++) if ((P[i] != wildcard) && ((i == 0) || (P[i - 1] == wildcard))) state.num_fragments++;
+    state.fragments = malloc((state.num_fragments + 1) * sizeof(wildcard_fragment));
+
+    for (i = 0, j = 0; i < m; i++) {
+        if (P[i] == wildcard) continue;
+        fragment = &state.fragments[j++];
+        fragment->offset = i;
+        while ((i + 1 < m) && (P[i + 1] != wildcard)) i++;
+        fragment->end = i;
+        length = fragment->end - fragment->offset + 1;
+        fragment->exact = (length >= WILDCARD_SHORT);
+        if (fragment->exact) fragment->matcher = exactmatch_build(&P[fragment->offset], length, sigma, s_sigma, n, alpha);
+        else fragment->kmp = kmp_build(&P[fragment->offset], length, length, sigma, s_sigma);
+        fragment->queue.capacity = 4;
+        fragment->queue.progressions = malloc(fragment->queue.capacity * sizeof(wildcard_progression));
+        fragment->queue.head = 0;
+        fragment->queue.size = 0;
+    }
+    return state;
+}
+
+/*
+    wildcard_stream
+    Performs the next round of wildcard matching.
+    Parameters:
+        wildcard_state *state - The current state
+        symbol         T_i    - The next character of the text
+    Returns int:
+        i if the pattern ends at index T[i]
+        -1 otherwise
+        Parameter state modified by reference to the next state.
+*/
+int wildcard_stream(wildcard_state *state, symbol T_i) {
+    wildcard_fragment *fragment = state->fragments;
+    int i = state->text_index++, j, found, location, held = 0;
+    if (state->num_fragments == 0) return (i >= state->m - 1) ? i : -1;
+
+    for (j = 0; j < state->num_fragments; j++, fragment++) {
+        found = (fragment->exact) ? exactmatch_stream(&fragment->matcher, T_i) : kmp_stream(&fragment->kmp, T_i, i);
+        location = i + state->m - 1 - fragment->end;
+        if (j > 0) found = wildcardqueue_take(&fragment[-1].queue, location) && (found != -1);
+        else found = (found != -1) && (location >= state->m - 1);
+        if (found) wildcardqueue_push(&fragment->queue, location);
+        held += fragment->queue.size;
+    }
+    if (held > state->most_held) state->most_held = held;
+    return (wildcardqueue_take(&fragment[-1].queue, i)) ? i : -1;
+}
+
+/*
+    wildcard_stream_block
+    Performs wildcard matching on the next block of the text.
+    Parameters:
+        wildcard_state *state - The current state
+        symbol         *T     - The next block of the text
+        int            l      - Length of the block
+        match_sink     *sink  - Destination for the location of each match
+    Returns int:
+        Number of characters of T consumed. Less than l only if the sink reported it was full.
+        Parameter state modified by reference to the next state.
+*/
+int wildcard_stream_block(wildcard_state *state, symbol *T, int l, match_sink *sink) {
+    int i, result;
+    if (matchsink_full(sink)) return 0;
+    for (i = 0; i < l; i++) {
+        result = wildcard_stream(state, T[i]);
+        if ((result != -1) && (matchsink_emit(sink, result))) return i + 1;
+    }
+    return l;
+}
+
+/*
+    wildcard_size
+    Returns the number of bytes used by wildcard matching.
+    Parameters:
+        wildcard_state state - The state
+    Returns int:
+        The size, counting the progressions allocated for the queues
+*/
+int wildcard_size(wildcard_state state) {
+    int result = sizeof(wildcard_state), j;
+    wildcard_fragment *fragment;
+    for (j = 0; j < state.num_fragments; j++) {
+        fragment = &state.fragments[j];
+        result += sizeof(wildcard_fragment) + fragment->queue.capacity * sizeof(wildcard_progression);
+        result += (fragment->exact) ? exactmatch_size(fragment->matcher) : kmp_size(fragment->kmp);
+    }
+    return result;
+}
+
+/*
+    wildcard_free
+    Frees wildcard matching.
+    Parameters:
+        wildcard_state *state - The state to free
+*/
+void wildcard_free(wildcard_state *state) {
+    int j;
+    for (j = 0; j < state->num_fragments; j++) {
+        if (state->fragments[j].exact) exactmatch_free(&state->fragments[j].matcher);
+        else kmp_free(&state->fragments[j].kmp);
+        free(state->fragments[j].queue.progressions);
+    }
+    free(state->fragments);
+}
+
+#endif